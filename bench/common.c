@@ -0,0 +1,704 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * common.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#if HAVE_DLSYM
+#include <dlfcn.h>
+#endif
+#include <sys/resource.h>
+#include <sys/socket.h>
+#if USE_MEMFD
+#include <gio/gunixfdlist.h>
+#endif
+#include "common.h"
+
+#define _UNUSED_                __attribute__ ((unused))
+
+static const gchar watcher_xml[] =
+    "<node>"
+    "   <interface name='org.kde.StatusNotifierWatcher'>"
+    "       <property name='IsStatusNotifierHostRegistered' type='b' access='read' />"
+    "       <method name='RegisterStatusNotifierItem'>"
+    "           <arg name='service' type='s' direction='in' />"
+    "       </method>"
+    "       <signal name='StatusNotifierHostRegistered' />"
+    "       <signal name='StatusNotifierHostUnregistered' />"
+    "   </interface>"
+    "</node>";
+
+static void
+watcher_method_call (GDBusConnection        *conn _UNUSED_,
+                     const gchar            *sender,
+                     const gchar            *object _UNUSED_,
+                     const gchar            *interface _UNUSED_,
+                     const gchar            *method,
+                     GVariant               *params,
+                     GDBusMethodInvocation  *invocation,
+                     gpointer                data)
+{
+    struct bus *bus = data;
+    const gchar *service;
+
+    if (g_strcmp0 (method, "RegisterStatusNotifierItem"))
+    {
+        g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR,
+                G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method);
+        return;
+    }
+
+    g_variant_get (params, "(&s)", &service);
+    g_free (bus->last_item.name);
+    g_free (bus->last_item.path);
+    /* as KDE's: items sharing a connection register with their object path,
+     * others with their bus name (on the usual path) */
+    if (*service == '/')
+    {
+        bus->last_item.name = g_strdup (sender);
+        bus->last_item.path = g_strdup (service);
+    }
+    else
+    {
+        bus->last_item.name = g_strdup (service);
+        bus->last_item.path = g_strdup (ITEM_OBJECT);
+    }
+    ++bus->nb_registered;
+    g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static GVariant *
+watcher_get_prop (GDBusConnection        *conn _UNUSED_,
+                  const gchar            *sender _UNUSED_,
+                  const gchar            *object _UNUSED_,
+                  const gchar            *interface _UNUSED_,
+                  const gchar            *property _UNUSED_,
+                  GError                **error _UNUSED_,
+                  gpointer                data _UNUSED_)
+{
+    /* IsStatusNotifierHostRegistered */
+    return g_variant_new_boolean (TRUE);
+}
+
+/* stand-in for logind, only what's needed for session.c: any session we're
+ * asked about is ours, and can be (un)locked */
+#define LOGIN1_NAME         "org.freedesktop.login1"
+#define LOGIN1_OBJECT       "/org/freedesktop/login1"
+#define LOGIN1_SESSION      "/org/freedesktop/login1/session/bench"
+
+static const gchar login1_xml[] =
+    "<node>"
+    "   <interface name='org.freedesktop.login1.Manager'>"
+    "       <method name='GetSession'>"
+    "           <arg name='session_id' type='s' direction='in' />"
+    "           <arg name='object_path' type='o' direction='out' />"
+    "       </method>"
+    "       <method name='GetSessionByPID'>"
+    "           <arg name='pid' type='u' direction='in' />"
+    "           <arg name='object_path' type='o' direction='out' />"
+    "       </method>"
+    "   </interface>"
+    "   <interface name='org.freedesktop.login1.Session'>"
+    "       <property name='LockedHint' type='b' access='read' />"
+    "       <property name='IdleHint' type='b' access='read' />"
+    "   </interface>"
+    "</node>";
+
+static void
+login1_method_call (GDBusConnection        *conn _UNUSED_,
+                    const gchar            *sender _UNUSED_,
+                    const gchar            *object _UNUSED_,
+                    const gchar            *interface _UNUSED_,
+                    const gchar            *method _UNUSED_,
+                    GVariant               *params _UNUSED_,
+                    GDBusMethodInvocation  *invocation,
+                    gpointer                data _UNUSED_)
+{
+    /* GetSession or GetSessionByPID */
+    g_dbus_method_invocation_return_value (invocation,
+            g_variant_new ("(o)", LOGIN1_SESSION));
+}
+
+static GVariant *
+login1_get_prop (GDBusConnection        *conn _UNUSED_,
+                 const gchar            *sender _UNUSED_,
+                 const gchar            *object _UNUSED_,
+                 const gchar            *interface _UNUSED_,
+                 const gchar            *property,
+                 GError                **error _UNUSED_,
+                 gpointer                data)
+{
+    struct bus *bus = data;
+
+    if (!g_strcmp0 (property, "LockedHint"))
+        return g_variant_new_boolean (bus->locked);
+    /* IdleHint */
+    return g_variant_new_boolean (FALSE);
+}
+
+/* as GTestDBus', but with the limits of a session bus (session.conf):
+ * dbus-daemon's built-in ones are the system bus', e.g. 128 pending replies
+ * and 512 names per connection, which items registering by the hundreds from
+ * one process would hit */
+static const gchar bus_config[] =
+    "<busconfig>\n"
+    "  <type>session</type>\n"
+    "  <listen>unix:tmpdir=/tmp</listen>\n"
+    "  <policy context=\"default\">\n"
+    "    <allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+    "    <allow eavesdrop=\"true\"/>\n"
+    "    <allow own=\"*\"/>\n"
+    "  </policy>\n"
+    "  <limit name=\"max_incoming_bytes\">1000000000</limit>\n"
+    "  <limit name=\"max_outgoing_bytes\">1000000000</limit>\n"
+    "  <limit name=\"max_message_size\">1000000000</limit>\n"
+    "  <limit name=\"max_connections_per_user\">100000</limit>\n"
+    "  <limit name=\"max_names_per_connection\">50000</limit>\n"
+    "  <limit name=\"max_match_rules_per_connection\">50000</limit>\n"
+    "  <limit name=\"max_replies_per_connection\">50000</limit>\n"
+    "</busconfig>\n";
+
+static gboolean
+daemon_up (struct bus *bus, GError **error)
+{
+    const gchar *argv[] = { "dbus-daemon", NULL, "--nofork", "--print-address",
+        NULL };
+    GDataInputStream *in;
+    gchar *arg;
+    gint fd;
+
+    fd = g_file_open_tmp ("sn-bench-XXXXXX.conf", &bus->config, error);
+    if (fd < 0)
+        return FALSE;
+    close (fd);
+    if (!g_file_set_contents (bus->config, bus_config, -1, error))
+        return FALSE;
+
+    arg = g_strconcat ("--config-file=", bus->config, NULL);
+    argv[1] = arg;
+    bus->daemon = g_subprocess_newv (argv, G_SUBPROCESS_FLAGS_STDOUT_PIPE, error);
+    g_free (arg);
+    if (!bus->daemon)
+        return FALSE;
+
+    in = g_data_input_stream_new (g_subprocess_get_stdout_pipe (bus->daemon));
+    bus->address = g_data_input_stream_read_line_utf8 (in, NULL, NULL, error);
+    g_object_unref (in);
+    if (!bus->address)
+    {
+        if (error && !*error)
+            g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                    "dbus-daemon did not print its address");
+        return FALSE;
+    }
+
+    /* so items will use it */
+    g_setenv ("DBUS_SESSION_BUS_ADDRESS", bus->address, TRUE);
+    return TRUE;
+}
+
+static GDBusConnection *
+bus_connect (struct bus *bus, GError **error)
+{
+    return g_dbus_connection_new_for_address_sync (
+            bus->address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+            NULL, NULL, error);
+}
+
+gboolean
+bus_up (struct bus *bus, GError **error)
+{
+    GDBusInterfaceVTable interface_vtable = {
+        .method_call = watcher_method_call,
+        .get_property = watcher_get_prop,
+        .set_property = NULL
+    };
+    GDBusNodeInfo *info;
+    GVariant *variant;
+
+    memset (bus, 0, sizeof (*bus));
+
+    if (!daemon_up (bus, error))
+        return FALSE;
+
+    bus->watcher_conn = bus_connect (bus, error);
+    if (!bus->watcher_conn)
+        return FALSE;
+
+    info = g_dbus_node_info_new_for_xml (watcher_xml, NULL);
+    bus->watcher_reg_id = g_dbus_connection_register_object (bus->watcher_conn,
+            WATCHER_OBJECT,
+            info->interfaces[0],
+            &interface_vtable,
+            bus, NULL,
+            error);
+    g_dbus_node_info_unref (info);
+    if (bus->watcher_reg_id == 0)
+        return FALSE;
+
+    variant = g_dbus_connection_call_sync (bus->watcher_conn,
+            "org.freedesktop.DBus",
+            "/org/freedesktop/DBus",
+            "org.freedesktop.DBus",
+            "RequestName",
+            g_variant_new ("(su)", WATCHER_NAME, 0x4 /* DO_NOT_QUEUE */),
+            G_VARIANT_TYPE ("(u)"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, error);
+    if (!variant)
+        return FALSE;
+    g_variant_unref (variant);
+
+    bus->host_conn = bus_connect (bus, error);
+    return bus->host_conn != NULL;
+}
+
+/* Exports the stand-in logind (on the watcher's connection), and makes
+ * statusnotifier use it */
+gboolean
+login1_up (struct bus *bus, GError **error)
+{
+    GDBusInterfaceVTable interface_vtable = {
+        .method_call = login1_method_call,
+        .get_property = login1_get_prop,
+        .set_property = NULL
+    };
+    GDBusNodeInfo *info;
+    GVariant *variant;
+
+    if (bus->login1_reg_ids[0] > 0)
+        return TRUE;
+
+    info = g_dbus_node_info_new_for_xml (login1_xml, NULL);
+    bus->login1_reg_ids[0] = g_dbus_connection_register_object (bus->watcher_conn,
+            LOGIN1_OBJECT,
+            info->interfaces[0],
+            &interface_vtable,
+            bus, NULL,
+            error);
+    if (bus->login1_reg_ids[0] > 0)
+        bus->login1_reg_ids[1] = g_dbus_connection_register_object (bus->watcher_conn,
+                LOGIN1_SESSION,
+                info->interfaces[1],
+                &interface_vtable,
+                bus, NULL,
+                error);
+    g_dbus_node_info_unref (info);
+    if (bus->login1_reg_ids[1] == 0)
+        return FALSE;
+
+    variant = g_dbus_connection_call_sync (bus->watcher_conn,
+            "org.freedesktop.DBus",
+            "/org/freedesktop/DBus",
+            "org.freedesktop.DBus",
+            "RequestName",
+            g_variant_new ("(su)", LOGIN1_NAME, 0x4 /* DO_NOT_QUEUE */),
+            G_VARIANT_TYPE ("(u)"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, error);
+    if (!variant)
+        return FALSE;
+    g_variant_unref (variant);
+
+    /* see src/session.h */
+    g_setenv ("STATUS_NOTIFIER_LOGIND_BUS", "session", TRUE);
+    return TRUE;
+}
+
+void
+login1_set_locked (struct bus *bus, gboolean locked)
+{
+    GVariantBuilder changed;
+
+    if (bus->locked == locked)
+        return;
+    bus->locked = locked;
+
+    g_variant_builder_init (&changed, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&changed, "{sv}", "LockedHint",
+            g_variant_new_boolean (locked));
+    g_dbus_connection_emit_signal (bus->watcher_conn,
+            NULL,
+            LOGIN1_SESSION,
+            "org.freedesktop.DBus.Properties",
+            "PropertiesChanged",
+            g_variant_new ("(sa{sv}as)", "org.freedesktop.login1.Session",
+                &changed, NULL),
+            NULL);
+}
+
+void
+bus_down (struct bus *bus)
+{
+    guint i;
+
+    if (bus->host_conn)
+        g_object_unref (bus->host_conn);
+    for (i = 0; i < G_N_ELEMENTS (bus->login1_reg_ids); ++i)
+        if (bus->login1_reg_ids[i] > 0)
+            g_dbus_connection_unregister_object (bus->watcher_conn,
+                    bus->login1_reg_ids[i]);
+    if (bus->watcher_reg_id > 0)
+        g_dbus_connection_unregister_object (bus->watcher_conn, bus->watcher_reg_id);
+    if (bus->watcher_conn)
+        g_object_unref (bus->watcher_conn);
+    g_free (bus->last_item.name);
+    g_free (bus->last_item.path);
+    if (bus->daemon)
+    {
+        g_subprocess_force_exit (bus->daemon);
+        g_subprocess_wait (bus->daemon, NULL, NULL);
+        g_object_unref (bus->daemon);
+    }
+    if (bus->config)
+    {
+        unlink (bus->config);
+        g_free (bus->config);
+    }
+    g_free (bus->address);
+}
+
+struct wait
+{
+    GMainLoop *loop;
+    guint left;
+};
+
+static void
+state_changed (StatusNotifierItem *sn, GParamSpec *pspec _UNUSED_, struct wait *w)
+{
+    StatusNotifierState state = status_notifier_item_get_state (sn);
+
+    if (state == STATUS_NOTIFIER_STATE_REGISTERED
+            || state == STATUS_NOTIFIER_STATE_FAILED)
+        if (--w->left == 0)
+            g_main_loop_quit (w->loop);
+}
+
+static gboolean
+wait_timeout (struct wait *w)
+{
+    g_main_loop_quit (w->loop);
+    return G_SOURCE_REMOVE;
+}
+
+/* runs the main loop until all @items have been registered, or @timeout
+ * (seconds) expired */
+gboolean
+bus_wait_registered (StatusNotifierItem **items, guint nb, guint timeout)
+{
+    struct wait w;
+    gulong *sids;
+    guint tid;
+    guint i;
+
+    w.loop = g_main_loop_new (NULL, FALSE);
+    w.left = 0;
+    sids = g_new0 (gulong, nb);
+    for (i = 0; i < nb; ++i)
+        if (status_notifier_item_get_state (items[i]) == STATUS_NOTIFIER_STATE_REGISTERING)
+        {
+            sids[i] = g_signal_connect (items[i], "notify::state",
+                    (GCallback) state_changed, &w);
+            ++w.left;
+        }
+
+    if (w.left > 0)
+    {
+        tid = g_timeout_add_seconds (timeout, (GSourceFunc) wait_timeout, &w);
+        g_main_loop_run (w.loop);
+        if (w.left > 0)
+            g_warning ("Timeout waiting for %u items to register", w.left);
+        else
+            g_source_remove (tid);
+    }
+
+    for (i = 0; i < nb; ++i)
+    {
+        if (sids[i] > 0)
+            g_signal_handler_disconnect (items[i], sids[i]);
+        if (status_notifier_item_get_state (items[i]) != STATUS_NOTIFIER_STATE_REGISTERED)
+            w.left = 1;
+    }
+    g_free (sids);
+    g_main_loop_unref (w.loop);
+    return w.left == 0;
+}
+
+struct host
+{
+    struct bus *bus;
+    HostFunc func;
+    gpointer data;
+    GMainLoop *loop;
+};
+
+static gboolean
+host_done (GMainLoop *loop)
+{
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+}
+
+static gpointer
+host_thread (struct host *host)
+{
+    host->func (host->bus, host->data);
+    g_main_context_invoke (NULL, (GSourceFunc) host_done, host->loop);
+    return NULL;
+}
+
+/* Calls @func from another thread, acting as host, while the main loop runs
+ * (for items to serve the calls); Returns once @func did */
+void
+bus_run_host (struct bus *bus, HostFunc func, gpointer data)
+{
+    struct host host = { bus, func, data, NULL };
+    GThread *thread;
+
+    host.loop = g_main_loop_new (NULL, FALSE);
+    thread = g_thread_new ("host", (GThreadFunc) host_thread, &host);
+    g_main_loop_run (host.loop);
+    g_thread_join (thread);
+    g_main_loop_unref (host.loop);
+}
+
+GVariant *
+host_get_property (struct bus          *bus,
+                   const struct item   *item,
+                   const gchar         *property,
+                   GError             **error)
+{
+    return g_dbus_connection_call_sync (bus->host_conn,
+            item->name,
+            item->path,
+            "org.freedesktop.DBus.Properties",
+            "Get",
+            g_variant_new ("(ss)", ITEM_INTERFACE, property),
+            G_VARIANT_TYPE ("(v)"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, error);
+}
+
+GVariant *
+host_get_all (struct bus *bus, const struct item *item, GError **error)
+{
+    return g_dbus_connection_call_sync (bus->host_conn,
+            item->name,
+            item->path,
+            "org.freedesktop.DBus.Properties",
+            "GetAll",
+            g_variant_new ("(s)", ITEM_INTERFACE),
+            G_VARIANT_TYPE ("(a{sv})"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, error);
+}
+
+#if USE_MEMFD
+/* stand-in for a host using GetIconPixmapFd: maps (read-only, no copy) the
+ * pixels of @property of item @name; Returns them (unmapped once freed), with
+ * @layout set to the width, height & offset of each size (a(iit)), and
+ * @reply_size to the size of the reply, i.e. what went over the bus */
+GBytes *
+host_map_pixmap_fd (struct bus          *bus,
+                    const struct item   *item,
+                    const gchar         *property,
+                    GVariant           **layout,
+                    gsize               *reply_size,
+                    GError             **error)
+{
+    GUnixFDList *fd_list = NULL;
+    GMappedFile *file;
+    GVariant *variant;
+    GBytes *bytes;
+    gint32 idx;
+    gint fd;
+
+    variant = g_dbus_connection_call_with_unix_fd_list_sync (bus->host_conn,
+            item->name,
+            item->path,
+            "org.statusnotifier.Extension1",
+            "GetIconPixmapFd",
+            g_variant_new ("(s)", property),
+            G_VARIANT_TYPE ("(ha(iit))"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, &fd_list, NULL, error);
+    if (!variant)
+        return NULL;
+
+    g_variant_get (variant, "(h@a(iit))", &idx, layout);
+    *reply_size = g_variant_get_size (variant);
+    g_variant_unref (variant);
+
+    fd = g_unix_fd_list_get (fd_list, idx, error);
+    g_object_unref (fd_list);
+    if (fd < 0)
+    {
+        g_variant_unref (*layout);
+        return NULL;
+    }
+    file = g_mapped_file_new_from_fd (fd, FALSE, error);
+    close (fd);
+    if (!file)
+    {
+        g_variant_unref (*layout);
+        return NULL;
+    }
+    bytes = g_mapped_file_get_bytes (file);
+    g_mapped_file_unref (file);
+    return bytes;
+}
+#endif
+
+/* CPU time of the process (all threads, i.e. including GDBus' worker) */
+guint64
+process_cpu_us (void)
+{
+    struct rusage ru;
+
+    if (getrusage (RUSAGE_SELF, &ru) < 0)
+        return 0;
+    return (guint64) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * G_USEC_PER_SEC
+        + (guint64) (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+guint64
+process_rss_kb (void)
+{
+    gchar *contents;
+    gchar *s;
+    guint64 kb = 0;
+
+    if (!g_file_get_contents ("/proc/self/status", &contents, NULL, NULL))
+        return 0;
+    s = strstr (contents, "\nVmRSS:");
+    if (s)
+    {
+        for (s += strlen ("\nVmRSS:"); *s == ' ' || *s == '\t'; ++s)
+            ;
+        kb = g_ascii_strtoull (s, NULL, 10);
+    }
+    g_free (contents);
+    return kb;
+}
+
+/* shared libraries loaded, i.e. mapped */
+guint
+process_nb_libs (void)
+{
+    GHashTable *libs;
+    gchar *contents;
+    gchar **lines;
+    gchar **l;
+    guint nb;
+
+    if (!g_file_get_contents ("/proc/self/maps", &contents, NULL, NULL))
+        return 0;
+    libs = g_hash_table_new (g_str_hash, g_str_equal);
+    lines = g_strsplit (contents, "\n", -1);
+    for (l = lines; *l; ++l)
+    {
+        gchar *path = strchr (*l, '/');
+
+        if (path && strstr (path, ".so"))
+            g_hash_table_add (libs, path);
+    }
+    nb = g_hash_table_size (libs);
+    g_hash_table_unref (libs);
+    g_strfreev (lines);
+    g_free (contents);
+    return nb;
+}
+
+/* Socket writes: GDBus writes messages with send()/sendmsg(), which (unlike
+ * write()) aren't accounted for in /proc/self/io's syscw, so we count them
+ * ourself, by wrapping those calls (as our definitions take precedence over
+ * libc's). Without dlsym() they're not counted, and process_sends() is 0 */
+
+static guint nb_sends = 0;
+
+#if HAVE_DLSYM
+
+#define REAL_FN(fn, real)   G_STMT_START {                              \
+    if (!g_atomic_pointer_get (&real))                                  \
+        g_atomic_pointer_set (&real, dlsym (RTLD_NEXT, fn));            \
+    g_atomic_int_inc (&nb_sends);                                       \
+} G_STMT_END
+
+ssize_t
+send (gint fd, const void *buf, size_t len, gint flags)
+{
+    static gpointer real = NULL;
+
+    REAL_FN ("send", real);
+    return ((ssize_t (*) (gint, const void *, size_t, gint)) real) (fd, buf, len, flags);
+}
+
+ssize_t
+sendto (gint fd, const void *buf, size_t len, gint flags,
+        const struct sockaddr *addr, socklen_t addr_len)
+{
+    static gpointer real = NULL;
+
+    REAL_FN ("sendto", real);
+    return ((ssize_t (*) (gint, const void *, size_t, gint,
+                    const struct sockaddr *, socklen_t)) real)
+        (fd, buf, len, flags, addr, addr_len);
+}
+
+ssize_t
+sendmsg (gint fd, const struct msghdr *msg, gint flags)
+{
+    static gpointer real = NULL;
+
+    REAL_FN ("sendmsg", real);
+    return ((ssize_t (*) (gint, const struct msghdr *, gint)) real) (fd, msg, flags);
+}
+#endif /* HAVE_DLSYM */
+
+guint
+process_sends (void)
+{
+    return (guint) g_atomic_int_get (&nb_sends);
+}
+
+/* one JSON object per line, so runs can easily be compared */
+void
+report (const gchar    *bench,
+        const gchar    *param,
+        guint           iterations,
+        gint64          elapsed_us,
+        guint64         bytes)
+{
+    g_print ("{\"bench\": \"%s\", \"param\": \"%s\", \"iterations\": %u, "
+            "\"total_us\": %" G_GINT64_FORMAT ", \"ns_per_op\": %.1f, "
+            "\"ops_per_sec\": %.1f, \"bytes\": %" G_GUINT64_FORMAT "}\n",
+            bench, (param) ? param : "",
+            iterations,
+            elapsed_us,
+            (iterations > 0) ? (gdouble) elapsed_us * 1000. / iterations : 0.,
+            (elapsed_us > 0) ? (gdouble) iterations * G_USEC_PER_SEC / elapsed_us : 0.,
+            bytes);
+}
@@ -0,0 +1,110 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * common.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __BENCH_COMMON_H__
+#define __BENCH_COMMON_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <statusnotifier.h>
+#include "testpixbuf.h"
+
+G_BEGIN_DECLS
+
+#define WATCHER_NAME        "org.kde.StatusNotifierWatcher"
+#define WATCHER_OBJECT      "/StatusNotifierWatcher"
+#define WATCHER_INTERFACE   "org.kde.StatusNotifierWatcher"
+
+#define ITEM_OBJECT         "/StatusNotifierItem"
+#define ITEM_INTERFACE      "org.kde.StatusNotifierItem"
+
+/* an item as registered on the watcher, i.e. where to reach it */
+struct item
+{
+    gchar *name;
+    gchar *path;
+};
+
+/* A throwaway session bus (private dbus-daemon) with a stand-in
+ * StatusNotifierWatcher (always claiming a host is registered), and a separate
+ * connection to act as StatusNotifierHost */
+struct bus
+{
+    GSubprocess *daemon;
+    gchar *config;
+    gchar *address;
+    GDBusConnection *watcher_conn;
+    guint watcher_reg_id;
+    GDBusConnection *host_conn;
+    /* last item registered on the watcher */
+    struct item last_item;
+    guint nb_registered;
+    /* stand-in logind (Manager & Session), see login1_up() */
+    guint login1_reg_ids[2];
+    gboolean locked;
+};
+
+typedef void (*HostFunc) (struct bus *bus, gpointer data);
+
+gboolean        bus_up                  (struct bus         *bus,
+                                         GError            **error);
+void            bus_down                (struct bus         *bus);
+gboolean        bus_wait_registered     (StatusNotifierItem **items,
+                                         guint               nb,
+                                         guint               timeout);
+void            bus_run_host            (struct bus         *bus,
+                                         HostFunc            func,
+                                         gpointer            data);
+gboolean        login1_up               (struct bus         *bus,
+                                         GError            **error);
+void            login1_set_locked       (struct bus         *bus,
+                                         gboolean            locked);
+GVariant *      host_get_property       (struct bus         *bus,
+                                         const struct item  *item,
+                                         const gchar        *property,
+                                         GError            **error);
+GVariant *      host_get_all            (struct bus         *bus,
+                                         const struct item  *item,
+                                         GError            **error);
+#if USE_MEMFD
+GBytes *        host_map_pixmap_fd      (struct bus         *bus,
+                                         const struct item  *item,
+                                         const gchar        *property,
+                                         GVariant          **layout,
+                                         gsize              *reply_size,
+                                         GError            **error);
+#endif
+
+guint64         process_cpu_us          (void);
+guint64         process_rss_kb          (void);
+guint           process_nb_libs         (void);
+guint           process_sends           (void);
+
+void            report                  (const gchar        *bench,
+                                         const gchar        *param,
+                                         guint               iterations,
+                                         gint64              elapsed_us,
+                                         guint64             bytes);
+
+G_END_DECLS
+
+#endif /* __BENCH_COMMON_H__ */
@@ -0,0 +1,55 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * mkbenchpng.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+/* Writes the benchmarks' test pixbuf (see pixbuf_new_test()) of the given size
+ * as PNG, for what needs an image file: the startup benchmark, and its
+ * pixmaps compiled in with statusnotifier-mkpixmaps */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include "testpixbuf.h"
+
+gint
+main (gint argc, gchar *argv[])
+{
+    GError *err = NULL;
+    GdkPixbuf *pixbuf;
+    gint size;
+
+    if (argc != 3 || (size = atoi (argv[1])) <= 0)
+    {
+        g_printerr ("Usage: %s SIZE FILE\n", argv[0]);
+        return 1;
+    }
+
+    pixbuf = pixbuf_new_test (size);
+    if (!gdk_pixbuf_save (pixbuf, argv[2], "png", &err, NULL))
+    {
+        g_printerr ("%s: %s\n", argv[2], err->message);
+        g_clear_error (&err);
+        g_object_unref (pixbuf);
+        return 1;
+    }
+    g_object_unref (pixbuf);
+    return 0;
+}
@@ -0,0 +1,1426 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * sn-bench.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#if USE_DBUSMENU
+#include <gmodule.h>
+#include "dbusmenu.h"
+#endif
+
+#define _UNUSED_                __attribute__ ((unused))
+
+static gint opt_iterations = 1000;
+static gint64 opt_footprint_child = 0;
+static guint iterations;
+static gchar *self;
+static gint64 main_time;
+static gchar **only = NULL;
+
+static gboolean
+wanted (const gchar *bench)
+{
+    return !only || g_strv_contains ((const gchar * const *) only, bench);
+}
+
+static StatusNotifierItem *
+item_new_registered (struct bus *bus, GdkPixbuf *pixbuf)
+{
+    StatusNotifierItem *sn;
+
+    sn = g_object_new (STATUS_NOTIFIER_TYPE_ITEM,
+            "id",               "sn-bench",
+            "title",            "Benchmark",
+            "status",           STATUS_NOTIFIER_STATUS_ACTIVE,
+            "tooltip-title",    "Benchmark",
+            "tooltip-body",     "Benchmarking <b>statusnotifier</b>",
+            NULL);
+    if (pixbuf)
+        status_notifier_item_set_from_pixbuf (sn, STATUS_NOTIFIER_ICON, pixbuf);
+    else
+        status_notifier_item_set_from_icon_name (sn, STATUS_NOTIFIER_ICON, "sn-bench");
+
+    status_notifier_item_register (sn);
+    if (!bus_wait_registered (&sn, 1, 10))
+    {
+        g_printerr ("Failed to register item\n");
+        exit (1);
+    }
+    return sn;
+}
+
+/* pixmap serialization: Get IconPixmap for various icon sizes */
+
+struct get
+{
+    const gchar *bench;
+    const gchar *param;
+    const gchar *property;
+    guint iterations;
+};
+
+static void
+host_get (struct bus *bus, struct get *get)
+{
+    GError *err = NULL;
+    guint64 bytes = 0;
+    gint64 start;
+    guint i;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < get->iterations; ++i)
+    {
+        GVariant *variant;
+
+        if (get->property)
+            variant = host_get_property (bus, &bus->last_item, get->property, &err);
+        else
+            variant = host_get_all (bus, &bus->last_item, &err);
+        if (!variant)
+        {
+            g_printerr ("%s: %s\n", get->bench, err->message);
+            exit (1);
+        }
+        bytes += g_variant_get_size (variant);
+        g_variant_unref (variant);
+    }
+    report (get->bench, get->param, get->iterations,
+            g_get_monotonic_time () - start, bytes);
+}
+
+static void
+bench_pixmap (struct bus *bus)
+{
+    const gint sizes[] = { 16, 22, 32, 48, 64, 128, 256, 512 };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (sizes); ++i)
+    {
+        StatusNotifierItem *sn;
+        GdkPixbuf *pixbuf;
+        gchar param[16];
+        struct get get;
+
+        pixbuf = pixbuf_new_test (sizes[i]);
+        sn = item_new_registered (bus, pixbuf);
+        g_object_unref (pixbuf);
+
+        g_snprintf (param, sizeof (param), "%dx%d", sizes[i], sizes[i]);
+        get.bench = "pixmap-get";
+        get.param = param;
+        get.property = "IconPixmap";
+        get.iterations = MAX (10, iterations * 32 * 32 / (guint) (sizes[i] * sizes[i]));
+        bus_run_host (bus, (HostFunc) host_get, &get);
+
+        g_object_unref (sn);
+    }
+}
+
+/* property Get/GetAll throughput */
+
+static void
+bench_get (struct bus *bus)
+{
+    const gchar *props[] = { "Id", "Title", "Status", "IconName", "ToolTip" };
+    StatusNotifierItem *sn;
+    struct get get;
+    guint i;
+
+    sn = item_new_registered (bus, NULL);
+
+    get.bench = "get";
+    get.iterations = iterations;
+    for (i = 0; i < G_N_ELEMENTS (props); ++i)
+    {
+        get.param = get.property = props[i];
+        bus_run_host (bus, (HostFunc) host_get, &get);
+    }
+
+    get.bench = "getall";
+    get.param = NULL;
+    get.property = NULL;
+    bus_run_host (bus, (HostFunc) host_get, &get);
+
+    g_object_unref (sn);
+}
+
+/* signal emission rate: time to emit N NewTitle, and until a host got them */
+
+struct signals
+{
+    struct bus *bus;
+    GMutex mutex;
+    GCond cond;
+    gboolean ready;
+    guint received;
+    gint64 end;
+};
+
+static void
+host_new_title (GDBusConnection *conn _UNUSED_,
+                const gchar     *sender _UNUSED_,
+                const gchar     *object _UNUSED_,
+                const gchar     *interface _UNUSED_,
+                const gchar     *signal _UNUSED_,
+                GVariant        *params _UNUSED_,
+                struct signals  *s)
+{
+    if (++s->received == iterations)
+        s->end = g_get_monotonic_time ();
+}
+
+static gpointer
+host_signals (struct signals *s)
+{
+    GMainContext *context;
+    GVariant *variant;
+    gint64 timeout;
+    guint id;
+
+    context = g_main_context_new ();
+    g_main_context_push_thread_default (context);
+    id = g_dbus_connection_signal_subscribe (s->bus->host_conn,
+            s->bus->last_item.name,
+            ITEM_INTERFACE,
+            "NewTitle",
+            s->bus->last_item.path,
+            NULL,
+            G_DBUS_SIGNAL_FLAGS_NONE,
+            (GDBusSignalCallback) host_new_title,
+            s, NULL);
+    /* make sure the match rule was processed by the bus */
+    variant = g_dbus_connection_call_sync (s->bus->host_conn,
+            "org.freedesktop.DBus", "/org/freedesktop/DBus",
+            "org.freedesktop.DBus", "GetId",
+            NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    if (variant)
+        g_variant_unref (variant);
+
+    g_mutex_lock (&s->mutex);
+    s->ready = TRUE;
+    g_cond_signal (&s->cond);
+    g_mutex_unlock (&s->mutex);
+
+    timeout = g_get_monotonic_time () + 30 * G_USEC_PER_SEC;
+    while (s->received < iterations && g_get_monotonic_time () < timeout)
+        g_main_context_iteration (context, TRUE);
+
+    g_dbus_connection_signal_unsubscribe (s->bus->host_conn, id);
+    g_main_context_pop_thread_default (context);
+    g_main_context_unref (context);
+    return NULL;
+}
+
+static void
+bench_signals (struct bus *bus)
+{
+    StatusNotifierItem *sn;
+    struct signals s = { bus, };
+    GThread *thread;
+    gchar title[32];
+    gint64 start, emitted;
+    guint i;
+
+    sn = item_new_registered (bus, NULL);
+
+    g_mutex_init (&s.mutex);
+    g_cond_init (&s.cond);
+    thread = g_thread_new ("host", (GThreadFunc) host_signals, &s);
+    g_mutex_lock (&s.mutex);
+    while (!s.ready)
+        g_cond_wait (&s.cond, &s.mutex);
+    g_mutex_unlock (&s.mutex);
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; ++i)
+    {
+        g_snprintf (title, sizeof (title), "Title %u", i);
+        status_notifier_item_set_title (sn, title);
+    }
+    emitted = g_get_monotonic_time ();
+    g_thread_join (thread);
+
+    report ("signal-emit", "NewTitle", iterations, emitted - start, 0);
+    if (s.received < iterations)
+        g_printerr ("signal-receive: only got %u/%u signals\n", s.received, iterations);
+    else
+        report ("signal-receive", "NewTitle", iterations, s.end - start, 0);
+
+    g_mutex_clear (&s.mutex);
+    g_cond_clear (&s.cond);
+    g_object_unref (sn);
+}
+
+/* signals batching: the same updates, of items sharing a connection, emitted
+ * as they come or batched; Also reports the socket writes (send() & co) and CPU
+ * time (all threads, so including GDBus' worker) they took */
+
+#define NB_BATCH_ITEMS      50
+
+static void
+bench_batch (struct bus *bus)
+{
+    const gchar *params[] = { "off", "on" };
+    StatusNotifierItem *items[NB_BATCH_ITEMS];
+    GDBusConnection *conn;
+    gchar title[32];
+    guint n = MAX (1, iterations / 10);
+    guint b, i, j;
+
+    conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+    for (b = 0; b < G_N_ELEMENTS (params); ++b)
+    {
+        gint64 start;
+#if HAVE_DLSYM
+        guint64 cpu;
+        guint sends;
+#endif
+
+        for (i = 0; i < NB_BATCH_ITEMS; ++i)
+        {
+            items[i] = item_new_registered (bus, NULL);
+            status_notifier_item_set_batch_signals (items[i], b == 1);
+        }
+        g_dbus_connection_flush_sync (conn, NULL, NULL);
+
+#if HAVE_DLSYM
+        sends = process_sends ();
+        cpu = process_cpu_us ();
+#endif
+        start = g_get_monotonic_time ();
+        for (j = 0; j < n; ++j)
+        {
+            /* 3 signals per item, the 2 NewTitle can be coalesced */
+            for (i = 0; i < NB_BATCH_ITEMS; ++i)
+            {
+                g_snprintf (title, sizeof (title), "Title %u", j);
+                status_notifier_item_set_title (items[i], title);
+                status_notifier_item_set_tooltip_body (items[i], title);
+                g_snprintf (title, sizeof (title), "Title %u.5", j);
+                status_notifier_item_set_title (items[i], title);
+            }
+            while (g_main_context_iteration (NULL, FALSE))
+                ;
+        }
+        g_dbus_connection_flush_sync (conn, NULL, NULL);
+
+        report ("batch-emit", params[b], 3 * n * NB_BATCH_ITEMS,
+                g_get_monotonic_time () - start, 0);
+#if HAVE_DLSYM
+        /* iterations: socket writes; total_us: CPU time */
+        report ("batch-sends", params[b], process_sends () - sends,
+                (gint64) (process_cpu_us () - cpu), 0);
+#endif
+
+        for (i = 0; i < NB_BATCH_ITEMS; ++i)
+            g_object_unref (items[i]);
+    }
+    g_object_unref (conn);
+}
+
+/* cold registration latency for 1/100/1000 items */
+
+static void
+bench_register (struct bus *bus _UNUSED_)
+{
+    const guint nbs[] = { 1, 100, 1000 };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (nbs); ++i)
+    {
+        StatusNotifierItem **items;
+        gchar param[16];
+        gint64 start;
+        guint j;
+
+        items = g_new (StatusNotifierItem *, nbs[i]);
+        for (j = 0; j < nbs[i]; ++j)
+            items[j] = status_notifier_item_new_from_icon_name ("sn-bench",
+                    STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, "sn-bench");
+
+        start = g_get_monotonic_time ();
+        for (j = 0; j < nbs[i]; ++j)
+            status_notifier_item_register (items[j]);
+        if (!bus_wait_registered (items, nbs[i], 60))
+            g_printerr ("register: not all items registered\n");
+        g_snprintf (param, sizeof (param), "%u", nbs[i]);
+        report ("register", param, nbs[i], g_get_monotonic_time () - start, 0);
+
+        for (j = 0; j < nbs[i]; ++j)
+            g_object_unref (items[j]);
+        g_free (items);
+    }
+}
+
+/* signal dispatch cost per call: activate/scroll emitted in-process, with one
+ * handler connected (i.e. what's done on each Activate/Scroll method call) */
+
+static gboolean
+on_activate (StatusNotifierItem *sn _UNUSED_, gint x _UNUSED_, gint y _UNUSED_,
+             guint *count)
+{
+    ++*count;
+    return TRUE;
+}
+
+static gboolean
+on_scroll (StatusNotifierItem                 *sn _UNUSED_,
+           gint                                delta _UNUSED_,
+           StatusNotifierScrollOrientation     orientation _UNUSED_,
+           guint                              *count)
+{
+    ++*count;
+    return TRUE;
+}
+
+static void
+bench_dispatch (struct bus *bus _UNUSED_)
+{
+    StatusNotifierItem *sn;
+    guint n = iterations * 100;
+    guint signal;
+    guint count = 0;
+    gboolean ret;
+    gint64 start;
+    guint i;
+
+    sn = status_notifier_item_new_from_icon_name ("sn-bench",
+            STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, "sn-bench");
+    g_signal_connect (sn, "activate", (GCallback) on_activate, &count);
+    g_signal_connect (sn, "scroll", (GCallback) on_scroll, &count);
+
+    signal = g_signal_lookup ("activate", STATUS_NOTIFIER_TYPE_ITEM);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n; ++i)
+        g_signal_emit (sn, signal, 0, (gint) i, 42, &ret);
+    report ("dispatch", "activate", n, g_get_monotonic_time () - start, 0);
+
+    signal = g_signal_lookup ("scroll", STATUS_NOTIFIER_TYPE_ITEM);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n; ++i)
+        g_signal_emit (sn, signal, 0, (gint) (i & 0xf) - 8,
+                (i & 1) ? STATUS_NOTIFIER_SCROLL_ORIENTATION_VERTICAL
+                : STATUS_NOTIFIER_SCROLL_ORIENTATION_HORIZONTAL, &ret);
+    report ("dispatch", "scroll", n, g_get_monotonic_time () - start, 0);
+
+    if (count != 2 * n)
+        g_printerr ("dispatch: handlers called %u times instead of %u\n", count, 2 * n);
+    g_object_unref (sn);
+}
+
+static guint64
+global_counter (const gchar *name)
+{
+    GVariant *counters;
+    guint64 value = 0;
+
+    counters = status_notifier_item_get_global_counters ();
+    g_variant_lookup (counters, name, "t", &value);
+    g_variant_unref (counters);
+    return value;
+}
+
+/* 500 items registered & updated individually vs as a group */
+
+#define NB_GROUP_ITEMS      500
+
+static void
+update_tooltip (StatusNotifierItem *sn, gpointer data)
+{
+    status_notifier_item_freeze_tooltip (sn);
+    status_notifier_item_set_tooltip_title (sn, "Group");
+    status_notifier_item_set_tooltip_body (sn, data);
+    status_notifier_item_thaw_tooltip (sn);
+    status_notifier_item_set_title (sn, data);
+}
+
+static void
+bench_group (struct bus *bus _UNUSED_)
+{
+    StatusNotifierItem *items[NB_GROUP_ITEMS];
+    StatusNotifierItemGroup *group;
+    gchar body[32];
+    guint64 frozen;
+    gint64 start;
+    guint n = MAX (1, iterations / 100);
+    guint i, j;
+
+    /* individually */
+    for (i = 0; i < NB_GROUP_ITEMS; ++i)
+        items[i] = status_notifier_item_new_from_icon_name ("sn-bench",
+                STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, "sn-bench");
+    start = g_get_monotonic_time ();
+    for (i = 0; i < NB_GROUP_ITEMS; ++i)
+        status_notifier_item_register (items[i]);
+    if (!bus_wait_registered (items, NB_GROUP_ITEMS, 60))
+        g_printerr ("group: not all items registered\n");
+    report ("group-register", "individual", NB_GROUP_ITEMS,
+            g_get_monotonic_time () - start, 0);
+
+    start = g_get_monotonic_time ();
+    for (j = 0; j < n; ++j)
+    {
+        g_snprintf (body, sizeof (body), "Update %u", j);
+        for (i = 0; i < NB_GROUP_ITEMS; ++i)
+            update_tooltip (items[i], body);
+    }
+    report ("group-update", "individual", n * NB_GROUP_ITEMS,
+            g_get_monotonic_time () - start, 0);
+
+    for (i = 0; i < NB_GROUP_ITEMS; ++i)
+        g_object_unref (items[i]);
+
+    /* as a group */
+    group = status_notifier_item_group_new ();
+    for (i = 0; i < NB_GROUP_ITEMS; ++i)
+    {
+        items[i] = status_notifier_item_new_from_icon_name ("sn-bench",
+                STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, "sn-bench");
+        status_notifier_item_group_add (group, items[i]);
+    }
+    start = g_get_monotonic_time ();
+    status_notifier_item_group_register (group);
+    if (!bus_wait_registered (items, NB_GROUP_ITEMS, 60))
+        g_printerr ("group: not all items registered\n");
+    report ("group-register", "group", NB_GROUP_ITEMS,
+            g_get_monotonic_time () - start, 0);
+
+    frozen = global_counter ("signals-frozen");
+    start = g_get_monotonic_time ();
+    for (j = 0; j < n; ++j)
+    {
+        g_snprintf (body, sizeof (body), "Update %u", j);
+        status_notifier_item_group_update (group, update_tooltip, body);
+    }
+    report ("group-update", "group", n * NB_GROUP_ITEMS,
+            g_get_monotonic_time () - start, 0);
+    /* signals held back until the end of an update */
+    report ("group-frozen", "group",
+            (guint) (global_counter ("signals-frozen") - frozen), 0, 0);
+
+    for (i = 0; i < NB_GROUP_ITEMS; ++i)
+        g_object_unref (items[i]);
+    g_object_unref (group);
+}
+
+/* procedural icons: rendering (or not, when cached), graph samples, and Get of
+ * the result, to compare with pixmap-get */
+
+#define RENDER_SIZE         32
+
+static void
+bench_render (struct bus *bus)
+{
+    StatusNotifierItem *sn;
+    gchar text[16];
+    gchar param[16];
+    struct get get;
+    gint64 start;
+    guint i;
+
+    sn = item_new_registered (bus, NULL);
+
+    /* all different, so always rendered */
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; ++i)
+    {
+        g_snprintf (text, sizeof (text), "%u", 1000 + i);
+        status_notifier_item_set_from_text (sn, STATUS_NOTIFIER_ICON, text,
+                0xffffffff, 0xff204a87, RENDER_SIZE);
+    }
+    report ("render-set", "rendered", iterations,
+            g_get_monotonic_time () - start, 0);
+
+    /* counts going round, from the frame cache once warm */
+    for (i = 0; i < 64; ++i)
+        status_notifier_item_set_from_badge (sn, STATUS_NOTIFIER_ICON, i,
+                0xffffffff, 0xffcc0000, RENDER_SIZE);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; ++i)
+        status_notifier_item_set_from_badge (sn, STATUS_NOTIFIER_ICON, i % 64,
+                0xffffffff, 0xffcc0000, RENDER_SIZE);
+    report ("render-set", "cached", iterations,
+            g_get_monotonic_time () - start, 0);
+
+    /* a sample is one column drawn, signals are rate-limited */
+    status_notifier_item_set_graph (sn, STATUS_NOTIFIER_ICON, 0., 100.,
+            0xff73d216, 0xff2e3436, RENDER_SIZE, 1000);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; ++i)
+        status_notifier_item_push_sample (sn, STATUS_NOTIFIER_ICON,
+                (gdouble) ((i * 37) % 101));
+    report ("render-set", "graph", iterations,
+            g_get_monotonic_time () - start, 0);
+
+    g_snprintf (param, sizeof (param), "%dx%d", RENDER_SIZE, RENDER_SIZE);
+    get.bench = "render-get";
+    get.param = param;
+    get.property = "IconPixmap";
+    get.iterations = iterations;
+    bus_run_host (bus, (HostFunc) host_get, &get);
+
+    g_object_unref (sn);
+}
+
+/* icon store: items using the same few icons (from distinct pixbufs, with the
+ * same pixels) on main & tooltip, then Get of both from each item; Reports the
+ * conversions actually done, and bytes held in the store */
+
+#define STORE_NB_ITEMS      50
+#define STORE_NB_ICONS      5
+
+struct store
+{
+    struct item items[STORE_NB_ITEMS];
+    gint64 elapsed;
+    guint64 bytes;
+};
+
+static void
+host_store (struct bus *bus, struct store *store)
+{
+    const gchar *props[] = { "IconPixmap", "ToolTip" };
+    GError *err = NULL;
+    gint64 start;
+    guint i, j;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < STORE_NB_ITEMS; ++i)
+        for (j = 0; j < G_N_ELEMENTS (props); ++j)
+        {
+            GVariant *variant;
+
+            variant = host_get_property (bus, &store->items[i], props[j], &err);
+            if (!variant)
+            {
+                g_printerr ("store-get: %s\n", err->message);
+                exit (1);
+            }
+            store->bytes += g_variant_get_size (variant);
+            g_variant_unref (variant);
+        }
+    store->elapsed = g_get_monotonic_time () - start;
+}
+
+static void
+bench_store (struct bus *bus)
+{
+    StatusNotifierItem *items[STORE_NB_ITEMS];
+    struct store store = { { { NULL, NULL }, }, };
+    gchar param[16];
+    guint64 conversions;
+    guint i;
+
+    for (i = 0; i < STORE_NB_ITEMS; ++i)
+    {
+        GdkPixbuf *pixbuf;
+
+        /* a new pixbuf each time, only the pixels are the same */
+        pixbuf = pixbuf_new_test (16 << (i % STORE_NB_ICONS));
+        items[i] = item_new_registered (bus, pixbuf);
+        status_notifier_item_set_from_pixbuf (items[i], STATUS_NOTIFIER_TOOLTIP_ICON,
+                pixbuf);
+        g_object_unref (pixbuf);
+        store.items[i].name = g_strdup (bus->last_item.name);
+        store.items[i].path = g_strdup (bus->last_item.path);
+    }
+
+    conversions = global_counter ("pixmap-conversions");
+    bus_run_host (bus, (HostFunc) host_store, &store);
+    conversions = global_counter ("pixmap-conversions") - conversions;
+
+    g_snprintf (param, sizeof (param), "%ux%u", STORE_NB_ITEMS, STORE_NB_ICONS);
+    report ("store-get", param, 2 * STORE_NB_ITEMS, store.elapsed, store.bytes);
+    /* bytes: held in the store */
+    report ("store-conversions", param, (guint) conversions, 0,
+            global_counter ("icon-store.bytes"));
+
+    for (i = 0; i < STORE_NB_ITEMS; ++i)
+    {
+        g_object_unref (items[i]);
+        g_free (store.items[i].name);
+        g_free (store.items[i].path);
+    }
+}
+
+/* session locked: how many signals a host gets for the same updates, and how
+ * many times its main loop had to wake up for them, with throttle-when-inactive,
+ * while the session is active vs locked (then unlocked, for the catch-up) */
+
+#define SESSION_SETTLE_MS   200
+
+struct wakeups
+{
+    struct bus *bus;
+    GMutex mutex;
+    GCond cond;
+    gboolean ready;
+    gboolean done;
+    guint received;
+    guint wakeups;
+};
+
+static gboolean
+quit_loop (GMainLoop *loop)
+{
+    g_main_loop_quit (loop);
+    return G_SOURCE_REMOVE;
+}
+
+/* runs the main loop for a bit, for the item to process (un)locking */
+static void
+settle (void)
+{
+    GMainLoop *loop;
+
+    loop = g_main_loop_new (NULL, FALSE);
+    g_timeout_add (SESSION_SETTLE_MS, (GSourceFunc) quit_loop, loop);
+    g_main_loop_run (loop);
+    g_main_loop_unref (loop);
+}
+
+static void
+host_wakeup (GDBusConnection *conn _UNUSED_,
+             const gchar     *sender _UNUSED_,
+             const gchar     *object _UNUSED_,
+             const gchar     *interface _UNUSED_,
+             const gchar     *signal,
+             GVariant        *params _UNUSED_,
+             struct wakeups  *w)
+{
+    /* NewStatus marks the end */
+    if (!g_strcmp0 (signal, "NewStatus"))
+        w->done = TRUE;
+    else
+        ++w->received;
+}
+
+static gpointer
+host_wakeups (struct wakeups *w)
+{
+    GMainContext *context;
+    GVariant *variant;
+    gint64 timeout;
+    guint id;
+
+    context = g_main_context_new ();
+    g_main_context_push_thread_default (context);
+    id = g_dbus_connection_signal_subscribe (w->bus->host_conn,
+            w->bus->last_item.name,
+            ITEM_INTERFACE,
+            NULL,
+            w->bus->last_item.path,
+            NULL,
+            G_DBUS_SIGNAL_FLAGS_NONE,
+            (GDBusSignalCallback) host_wakeup,
+            w, NULL);
+    /* make sure the match rule was processed by the bus */
+    variant = g_dbus_connection_call_sync (w->bus->host_conn,
+            "org.freedesktop.DBus", "/org/freedesktop/DBus",
+            "org.freedesktop.DBus", "GetId",
+            NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+    if (variant)
+        g_variant_unref (variant);
+
+    g_mutex_lock (&w->mutex);
+    w->ready = TRUE;
+    g_cond_signal (&w->cond);
+    g_mutex_unlock (&w->mutex);
+
+    timeout = g_get_monotonic_time () + 30 * G_USEC_PER_SEC;
+    /* each blocking iteration that dispatched something is a wakeup */
+    while (!w->done && g_get_monotonic_time () < timeout)
+        if (g_main_context_iteration (context, TRUE))
+            ++w->wakeups;
+
+    g_dbus_connection_signal_unsubscribe (w->bus->host_conn, id);
+    g_main_context_pop_thread_default (context);
+    g_main_context_unref (context);
+    return NULL;
+}
+
+static void
+bench_session (struct bus *bus)
+{
+    const StatusNotifierStatus statuses[] = {
+        STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION,
+        STATUS_NOTIFIER_STATUS_ACTIVE
+    };
+    GError *err = NULL;
+    StatusNotifierItem *sn;
+    gchar title[32];
+    guint locked;
+
+    if (!login1_up (bus, &err))
+    {
+        g_printerr ("session: %s\n", err->message);
+        g_clear_error (&err);
+        return;
+    }
+
+    sn = item_new_registered (bus, NULL);
+    status_notifier_item_set_throttle_when_inactive (sn, TRUE);
+    /* one NewIcon per sample */
+    status_notifier_item_set_graph (sn, STATUS_NOTIFIER_ICON, 0., 100.,
+            0xff73d216, 0xff2e3436, RENDER_SIZE, 0);
+
+    for (locked = 0; locked < 2; ++locked)
+    {
+        struct wakeups w = { bus, };
+        const gchar *param = (locked) ? "locked" : "active";
+        GThread *thread;
+        gint64 start, elapsed;
+        guint i;
+
+        login1_set_locked (bus, locked);
+        settle ();
+
+        g_mutex_init (&w.mutex);
+        g_cond_init (&w.cond);
+        thread = g_thread_new ("host", (GThreadFunc) host_wakeups, &w);
+        g_mutex_lock (&w.mutex);
+        while (!w.ready)
+            g_cond_wait (&w.cond, &w.mutex);
+        g_mutex_unlock (&w.mutex);
+
+        start = g_get_monotonic_time ();
+        for (i = 0; i < iterations; ++i)
+        {
+            g_snprintf (title, sizeof (title), "Title %u", i);
+            status_notifier_item_set_title (sn, title);
+            status_notifier_item_push_sample (sn, STATUS_NOTIFIER_ICON,
+                    (gdouble) ((i * 37) % 101));
+        }
+        elapsed = g_get_monotonic_time () - start;
+
+        login1_set_locked (bus, FALSE);
+        settle ();
+        status_notifier_item_set_status (sn, statuses[locked]);
+        g_thread_join (thread);
+
+        /* 2 updates per iteration; signals the host got, and the wakeups of
+         * its main loop to process them (incl. the final NewStatus) */
+        report ("session-set", param, iterations, elapsed, 0);
+        report ("session-signals", param, w.received, 0, 0);
+        report ("session-wakeups", param, w.wakeups, 0, 0);
+
+        g_mutex_clear (&w.mutex);
+        g_cond_clear (&w.cond);
+    }
+
+    g_object_unref (sn);
+}
+
+/* icon sizes: Get of a 512x512 IconPixmap, as is, then once the host said it
+ * renders at 22 pixels (SetIconSizes), and with max-icon-size instead */
+
+#define SIZES_ICON          512
+#define SIZES_HOST          22
+
+static void
+host_sizes (struct bus *bus, struct get *get)
+{
+    GError *err = NULL;
+    GVariant *variant;
+
+    variant = g_dbus_connection_call_sync (bus->host_conn,
+            bus->last_item.name,
+            bus->last_item.path,
+            "org.statusnotifier.Extension1",
+            "SetIconSizes",
+            g_variant_new_parsed ("([%i],)", SIZES_HOST),
+            NULL,
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, &err);
+    if (!variant)
+    {
+        g_printerr ("%s: %s\n", get->bench, err->message);
+        exit (1);
+    }
+    g_variant_unref (variant);
+    host_get (bus, get);
+}
+
+static void
+bench_sizes (struct bus *bus)
+{
+    StatusNotifierItem *sn;
+    GdkPixbuf *pixbuf;
+    struct get get;
+
+    pixbuf = pixbuf_new_test (SIZES_ICON);
+    sn = item_new_registered (bus, pixbuf);
+    g_object_unref (pixbuf);
+
+    get.bench = "sizes-get";
+    get.property = "IconPixmap";
+    get.iterations = MAX (10, iterations / 16);
+
+    get.param = "native";
+    bus_run_host (bus, (HostFunc) host_get, &get);
+    get.param = "host-sizes";
+    bus_run_host (bus, (HostFunc) host_sizes, &get);
+    g_object_unref (sn);
+
+    pixbuf = pixbuf_new_test (SIZES_ICON);
+    sn = item_new_registered (bus, pixbuf);
+    g_object_unref (pixbuf);
+    status_notifier_item_set_max_icon_size (sn, 64);
+    get.param = "max-64";
+    bus_run_host (bus, (HostFunc) host_get, &get);
+    g_object_unref (sn);
+}
+
+/* icon deltas: a counter ticking on a rendered icon, the host fetching it after
+ * each tick, either all of it (Get of IconPixmap) or only what changed
+ * (GetIconDelta) */
+
+#define DELTA_SIZE          64
+
+struct delta
+{
+    struct get get;
+    StatusNotifierItem *sn;
+    gboolean use_delta;
+    GMutex mutex;
+    GCond cond;
+    guint ticks;
+};
+
+static gboolean
+delta_tick (struct delta *d)
+{
+    gchar text[16];
+
+    g_snprintf (text, sizeof (text), "%u", 1000 + d->ticks);
+    status_notifier_item_set_from_text (d->sn, STATUS_NOTIFIER_ICON, text,
+            0xffffffff, 0xff204a87, DELTA_SIZE);
+    g_mutex_lock (&d->mutex);
+    ++d->ticks;
+    g_cond_signal (&d->cond);
+    g_mutex_unlock (&d->mutex);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+host_delta (struct bus *bus, struct delta *d)
+{
+    GError *err = NULL;
+    guint64 bytes = 0;
+    guint32 revision = 0;
+    gint64 start;
+    guint i;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < d->get.iterations; ++i)
+    {
+        GVariant *variant;
+
+        g_main_context_invoke (NULL, (GSourceFunc) delta_tick, d);
+        g_mutex_lock (&d->mutex);
+        while (d->ticks <= i)
+            g_cond_wait (&d->cond, &d->mutex);
+        g_mutex_unlock (&d->mutex);
+
+        if (d->use_delta)
+            variant = g_dbus_connection_call_sync (bus->host_conn,
+                    bus->last_item.name,
+                    bus->last_item.path,
+                    "org.statusnotifier.Extension1",
+                    "GetIconDelta",
+                    g_variant_new ("(su)", "IconPixmap", revision),
+                    G_VARIANT_TYPE ("(uba(iia(iiiiay)))"),
+                    G_DBUS_CALL_FLAGS_NONE,
+                    -1, NULL, &err);
+        else
+            variant = host_get_property (bus, &bus->last_item, "IconPixmap", &err);
+        if (!variant)
+        {
+            g_printerr ("%s: %s\n", d->get.bench, err->message);
+            exit (1);
+        }
+        if (d->use_delta)
+            g_variant_get_child (variant, 0, "u", &revision);
+        bytes += g_variant_get_size (variant);
+        g_variant_unref (variant);
+    }
+    report (d->get.bench, d->get.param, d->get.iterations,
+            g_get_monotonic_time () - start, bytes);
+}
+
+static void
+bench_delta (struct bus *bus)
+{
+    struct delta d;
+
+    d.get.bench = "delta-fetch";
+    d.get.iterations = iterations;
+    g_mutex_init (&d.mutex);
+    g_cond_init (&d.cond);
+
+    d.sn = item_new_registered (bus, NULL);
+    d.get.param = "property";
+    d.use_delta = FALSE;
+    d.ticks = 0;
+    bus_run_host (bus, (HostFunc) host_delta, &d);
+    g_object_unref (d.sn);
+
+    d.sn = item_new_registered (bus, NULL);
+    d.get.param = "delta";
+    d.use_delta = TRUE;
+    d.ticks = 0;
+    bus_run_host (bus, (HostFunc) host_delta, &d);
+    g_object_unref (d.sn);
+
+    g_mutex_clear (&d.mutex);
+    g_cond_clear (&d.cond);
+}
+
+/* memfd icons: a host fetching the IconPixmap, as the property or mapping it
+ * from the memfd (GetIconPixmapFd), then going over all the pixels either way;
+ * "bytes" is the size of the replies, i.e. what went through the bus daemon */
+
+struct fd
+{
+    struct get get;
+    gboolean use_fd;
+    guint64 sum;
+};
+
+static guint64
+pixels_sum (const guchar *data, gsize len)
+{
+    guint64 sum = 0;
+    gsize i;
+
+    for (i = 0; i < len; ++i)
+        sum += data[i];
+    return sum;
+}
+
+static void
+host_fd (struct bus *bus, struct fd *f)
+{
+    GError *err = NULL;
+    guint64 bytes = 0;
+    gint64 start;
+    guint i;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < f->get.iterations; ++i)
+    {
+        if (f->use_fd)
+        {
+#if USE_MEMFD
+            GVariant *layout;
+            GBytes *pixels;
+            gsize size;
+
+            pixels = host_map_pixmap_fd (bus, &bus->last_item, "IconPixmap",
+                    &layout, &size, &err);
+            if (!pixels)
+            {
+                g_printerr ("%s: %s\n", f->get.bench, err->message);
+                exit (1);
+            }
+            f->sum += pixels_sum (g_bytes_get_data (pixels, NULL),
+                    g_bytes_get_size (pixels));
+            bytes += size;
+            g_variant_unref (layout);
+            g_bytes_unref (pixels);
+#endif
+        }
+        else
+        {
+            GVariant *variant, *pixmap;
+            GVariantIter iter;
+            GVariant *pixels;
+            gint w, h;
+
+            variant = host_get_property (bus, &bus->last_item, "IconPixmap", &err);
+            if (!variant)
+            {
+                g_printerr ("%s: %s\n", f->get.bench, err->message);
+                exit (1);
+            }
+            g_variant_get (variant, "(v)", &pixmap);
+            g_variant_iter_init (&iter, pixmap);
+            while (g_variant_iter_next (&iter, "(ii@ay)", &w, &h, &pixels))
+            {
+                f->sum += pixels_sum (g_variant_get_data (pixels),
+                        g_variant_get_size (pixels));
+                g_variant_unref (pixels);
+            }
+            bytes += g_variant_get_size (variant);
+            g_variant_unref (pixmap);
+            g_variant_unref (variant);
+        }
+    }
+    report (f->get.bench, f->get.param, f->get.iterations,
+            g_get_monotonic_time () - start, bytes);
+}
+
+static void
+bench_fd (struct bus *bus)
+{
+#if USE_MEMFD
+    const gint sizes[] = { 64, 128, 256, 512 };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (sizes); ++i)
+    {
+        StatusNotifierItem *sn;
+        GdkPixbuf *pixbuf;
+        gchar param[32];
+        struct fd f;
+
+        pixbuf = pixbuf_new_test (sizes[i]);
+        sn = item_new_registered (bus, pixbuf);
+        g_object_unref (pixbuf);
+
+        f.get.bench = "fd-fetch";
+        f.get.iterations = MAX (10, iterations / 16);
+        f.sum = 0;
+
+        g_snprintf (param, sizeof (param), "property-%dx%d", sizes[i], sizes[i]);
+        f.get.param = param;
+        f.use_fd = FALSE;
+        bus_run_host (bus, (HostFunc) host_fd, &f);
+
+        g_snprintf (param, sizeof (param), "fd-%dx%d", sizes[i], sizes[i]);
+        f.use_fd = TRUE;
+        bus_run_host (bus, (HostFunc) host_fd, &f);
+
+        g_object_unref (sn);
+    }
+#else
+    g_printerr ("fd: Built without memfd support, skipped\n");
+#endif
+}
+
+/* startup: time to the first visible icon, i.e. from creating the item to a
+ * host having the IconPixmap, with the icon from the PNG file (decoded &
+ * converted), loaded asynchronously (same, in a worker thread) or from the
+ * pixmaps compiled in (see mkpixmaps). Each is only done once, as caches would
+ * make further runs meaningless; "startup-set" is the part up to the icon being
+ * set */
+
+#define STARTUP_SIZE        48
+#define STARTUP_RESOURCE    "/org/statusnotifier/bench/sn-bench.pixmap"
+
+struct startup
+{
+    const gchar *param;
+    gint64 start;
+};
+
+static void
+host_startup (struct bus *bus, struct startup *startup)
+{
+    GError *err = NULL;
+    GVariant *variant;
+    guint64 bytes;
+
+    variant = host_get_property (bus, &bus->last_item, "IconPixmap", &err);
+    if (!variant)
+    {
+        g_printerr ("startup-first-icon: %s\n", err->message);
+        exit (1);
+    }
+    bytes = g_variant_get_size (variant);
+    g_variant_unref (variant);
+    report ("startup-first-icon", startup->param, 1,
+            g_get_monotonic_time () - startup->start, bytes);
+}
+
+static void
+file_loaded (StatusNotifierItem *sn, GAsyncResult *result, GMainLoop *loop)
+{
+    GError *err = NULL;
+
+    if (!status_notifier_item_set_from_file_finish (sn, result, &err))
+    {
+        g_printerr ("startup-set: %s\n", err->message);
+        exit (1);
+    }
+    g_main_loop_quit (loop);
+}
+
+static void
+bench_startup (struct bus *bus)
+{
+    const gchar *params[] = { "pixbuf", "file", "resource" };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (params); ++i)
+    {
+        GError *err = NULL;
+        StatusNotifierItem *sn;
+        struct startup startup;
+
+        startup.param = params[i];
+        startup.start = g_get_monotonic_time ();
+        sn = g_object_new (STATUS_NOTIFIER_TYPE_ITEM,
+                "id",               "sn-bench",
+                "title",            "Benchmark",
+                "status",           STATUS_NOTIFIER_STATUS_ACTIVE,
+                NULL);
+        if (i == 0)
+        {
+            GdkPixbuf *pixbuf;
+
+            pixbuf = gdk_pixbuf_new_from_file_at_size (BENCH_PNG,
+                    STARTUP_SIZE, STARTUP_SIZE, &err);
+            if (pixbuf)
+            {
+                status_notifier_item_set_from_pixbuf (sn, STATUS_NOTIFIER_ICON, pixbuf);
+                g_object_unref (pixbuf);
+            }
+        }
+        else if (i == 1)
+        {
+            GMainLoop *loop;
+
+            loop = g_main_loop_new (NULL, FALSE);
+            status_notifier_item_set_from_file_async (sn, STATUS_NOTIFIER_ICON,
+                    BENCH_PNG, STARTUP_SIZE, NULL,
+                    (GAsyncReadyCallback) file_loaded, loop);
+            g_main_loop_run (loop);
+            g_main_loop_unref (loop);
+        }
+        else
+            status_notifier_item_set_from_resource (sn, STATUS_NOTIFIER_ICON,
+                    STARTUP_RESOURCE, &err);
+        if (err)
+        {
+            g_printerr ("startup-set: %s\n", err->message);
+            exit (1);
+        }
+        report ("startup-set", params[i], 1,
+                g_get_monotonic_time () - startup.start, 0);
+
+        status_notifier_item_register (sn);
+        if (!bus_wait_registered (&sn, 1, 10))
+        {
+            g_printerr ("Failed to register item\n");
+            exit (1);
+        }
+        bus_run_host (bus, (HostFunc) host_startup, &startup);
+
+        g_object_unref (sn);
+    }
+}
+
+/* footprint: a new process (sn-bench itself, re-spawned) registering an item;
+ * Time until main() (exec & dynamic linking) and until the item is registered,
+ * and shared libraries loaded & RSS once it is. Param is the configuration, as
+ * comparing builds with & without GDK is the point.
+ * With dbusmenu support, the dbusmenu module is then loaded, as the first
+ * status_notifier_item_set_context_menu() does, reporting the same as for a
+ * process having it linked in ("+dbusmenu") */
+
+#if USE_GDK
+#define FOOTPRINT_CONFIG    "gdk"
+#else
+#define FOOTPRINT_CONFIG    "without-gdk"
+#endif
+
+static gint
+footprint_child (void)
+{
+    StatusNotifierItem *sn;
+
+    report ("footprint-main", FOOTPRINT_CONFIG, 1, main_time - opt_footprint_child, 0);
+
+    sn = status_notifier_item_new_from_icon_name ("sn-bench",
+            STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, "sn-bench");
+    status_notifier_item_register (sn);
+    if (!bus_wait_registered (&sn, 1, 10))
+    {
+        g_printerr ("footprint: Failed to register item\n");
+        return 1;
+    }
+    report ("footprint-registered", FOOTPRINT_CONFIG, 1,
+            g_get_monotonic_time () - opt_footprint_child, 0);
+    /* iterations: shared libraries; bytes: RSS */
+    report ("footprint-mem", FOOTPRINT_CONFIG, process_nb_libs (), 0,
+            process_rss_kb () * 1024);
+
+#if USE_DBUSMENU
+    {
+        GModule *module;
+        const gchar *dir;
+        gchar *path;
+        gint64 start;
+
+        dir = g_getenv (DBUSMENU_MODULE_DIR_ENV);
+        path = g_module_build_path ((dir && *dir) ? dir : BENCH_MODULE_DIR,
+                DBUSMENU_MODULE_NAME);
+        start = g_get_monotonic_time ();
+        module = g_module_open (path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+        if (module)
+        {
+            report ("footprint-dbusmenu", FOOTPRINT_CONFIG "+dbusmenu", 1,
+                    g_get_monotonic_time () - start, 0);
+            report ("footprint-mem", FOOTPRINT_CONFIG "+dbusmenu",
+                    process_nb_libs (), 0, process_rss_kb () * 1024);
+            g_module_close (module);
+        }
+        else
+            g_printerr ("footprint: Cannot load dbusmenu module: %s\n",
+                    g_module_error ());
+        g_free (path);
+    }
+#endif
+
+    g_object_unref (sn);
+    return 0;
+}
+
+static void
+footprint_done (GSubprocess *proc, GAsyncResult *result, GMainLoop *loop)
+{
+    GError *err = NULL;
+
+    if (!g_subprocess_wait_check_finish (proc, result, &err))
+    {
+        g_printerr ("footprint: %s\n", err->message);
+        g_clear_error (&err);
+    }
+    g_main_loop_quit (loop);
+}
+
+static void
+bench_footprint (struct bus *bus _UNUSED_)
+{
+    GError *err = NULL;
+    GSubprocess *proc;
+    GMainLoop *loop;
+    gchar arg[64];
+
+    /* the child prints its own results */
+    fflush (stdout);
+    g_snprintf (arg, sizeof (arg), "--footprint-child=%" G_GINT64_FORMAT,
+            g_get_monotonic_time ());
+    proc = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &err, self, arg, NULL);
+    if (!proc)
+    {
+        g_printerr ("footprint: %s\n", err->message);
+        g_clear_error (&err);
+        return;
+    }
+
+    /* our watcher answers its registration */
+    loop = g_main_loop_new (NULL, FALSE);
+    g_subprocess_wait_check_async (proc, NULL,
+            (GAsyncReadyCallback) footprint_done, loop);
+    g_main_loop_run (loop);
+    g_main_loop_unref (loop);
+    g_object_unref (proc);
+}
+
+static struct
+{
+    const gchar *name;
+    void (*run) (struct bus *bus);
+} benches[] = {
+    { "pixmap",     bench_pixmap },
+    { "get",        bench_get },
+    { "signals",    bench_signals },
+    { "batch",      bench_batch },
+    { "register",   bench_register },
+    { "dispatch",   bench_dispatch },
+    { "group",      bench_group },
+    { "render",     bench_render },
+    { "session",    bench_session },
+    { "store",      bench_store },
+    { "startup",    bench_startup },
+    { "sizes",      bench_sizes },
+    { "delta",      bench_delta },
+    { "fd",         bench_fd },
+    { "footprint",  bench_footprint },
+};
+
+gint
+main (gint argc, gchar *argv[])
+{
+    GError *err = NULL;
+    GOptionContext *context;
+    gchar *s_only = NULL;
+    GOptionEntry entries[] =
+    {
+        { "iterations", 'n',    0, G_OPTION_ARG_INT,    &opt_iterations,
+            "Number of iterations for each benchmark (default: 1000)", "N" },
+        { "only",       'o',    0, G_OPTION_ARG_STRING, &s_only,
+            "Only run benchmarks from LIST (comma-separated) out of: "
+                "pixmap, get, signals, batch, register, dispatch, group, render, session, "
+                "store, startup, sizes, delta, fd, footprint", "LIST" },
+        { "footprint-child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_INT64,
+            &opt_footprint_child, NULL, NULL },
+        { NULL }
+    };
+    struct bus bus;
+    guint i;
+
+    main_time = g_get_monotonic_time ();
+    context = g_option_context_new ("- statusnotifier benchmarks");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &err))
+    {
+        g_printerr ("%s\n", err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+    g_option_context_free (context);
+    if (opt_footprint_child > 0)
+        return footprint_child ();
+    iterations = (guint) MAX (1, opt_iterations);
+    if (s_only)
+    {
+        only = g_strsplit (s_only, ",", -1);
+        g_free (s_only);
+    }
+
+    self = g_file_read_link ("/proc/self/exe", NULL);
+    if (!self)
+        self = g_strdup (argv[0]);
+
+    if (!bus_up (&bus, &err))
+    {
+        g_printerr ("Failed to set up private bus: %s\n", err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (benches); ++i)
+        if (wanted (benches[i].name))
+            benches[i].run (&bus);
+
+    bus_down (&bus);
+    g_strfreev (only);
+    g_free (self);
+    return 0;
+}
@@ -0,0 +1,919 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * sn-loadgen.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+/* Load generator: N items spread over P (worker) processes, updating their
+ * icon/tooltip/status at given rates, with M simulated hosts reacting to the
+ * NewX signals by reading the properties.
+ *
+ * Workers are this very program, re-spawned with --worker. Once all their items
+ * are registered they say "ready", then wait for "go" (on stdin) to start the
+ * updates, and at the end print a "result" line with their CPU/RSS usage.
+ *
+ * Updates carry a (monotonic) timestamp, in the tooltip body or the icon name,
+ * so hosts can measure the update-to-host-visible latency. Bus messages are
+ * counted via a monitor connection (BecomeMonitor) when possible, else only
+ * what the hosts see is accounted for.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+
+#define _UNUSED_                __attribute__ ((unused))
+
+#define STAMP_PREFIX            "sn-loadgen-"
+#define TICK_MS                 10
+#define CALL_TIMEOUT_MS         5000
+
+static gboolean opt_worker = FALSE;
+static gint opt_worker_index = 0;
+static gint opt_items = 100;
+static gint opt_processes = 1;
+static gint opt_hosts = 1;
+static gint opt_duration = 10;
+static gint opt_pixmap_size = 0;
+static gdouble opt_icon_rate = 0.1;
+static gdouble opt_tooltip_rate = 1.;
+static gdouble opt_status_rate = 0.05;
+static gboolean opt_private_bus = FALSE;
+static gboolean opt_batch_signals = FALSE;
+
+static GOptionEntry entries[] =
+{
+    { "items",          'n',    0, G_OPTION_ARG_INT,        &opt_items,
+        "Number of items (default: 100)", "N" },
+    { "processes",      'p',    0, G_OPTION_ARG_INT,        &opt_processes,
+        "Number of processes to spread items over (default: 1)", "P" },
+    { "hosts",          'H',    0, G_OPTION_ARG_INT,        &opt_hosts,
+        "Number of simulated hosts (default: 1)", "M" },
+    { "duration",       'd',    0, G_OPTION_ARG_INT,        &opt_duration,
+        "Duration of the updates, in seconds (default: 10)", "SECS" },
+    { "icon-rate",      0,      0, G_OPTION_ARG_DOUBLE,     &opt_icon_rate,
+        "Icon updates per second per item (default: 0.1)", "RATE" },
+    { "tooltip-rate",   0,      0, G_OPTION_ARG_DOUBLE,     &opt_tooltip_rate,
+        "Tooltip updates per second per item (default: 1)", "RATE" },
+    { "status-rate",    0,      0, G_OPTION_ARG_DOUBLE,     &opt_status_rate,
+        "Status updates per second per item (default: 0.05)", "RATE" },
+    { "pixmap-size",    's',    0, G_OPTION_ARG_INT,        &opt_pixmap_size,
+        "Use pixbufs of SIZE for icons instead of icon names (no latency "
+            "measured for icon updates then)", "SIZE" },
+    { "batch-signals",  'b',    0, G_OPTION_ARG_NONE,       &opt_batch_signals,
+        "Have items batch their DBus signals", NULL },
+    { "private-bus",    0,      0, G_OPTION_ARG_NONE,       &opt_private_bus,
+        "Run on a private bus (with a stand-in watcher) instead of the "
+            "session bus", NULL },
+    { "worker",         0,      G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE,
+        &opt_worker, NULL, NULL },
+    { "worker-index",   0,      G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_INT,
+        &opt_worker_index, NULL, NULL },
+    { NULL }
+};
+
+
+/* worker: the items */
+
+enum
+{
+    UPD_ICON = 0,
+    UPD_TOOLTIP,
+    UPD_STATUS,
+    NB_UPD
+};
+
+struct load
+{
+    GMainLoop *loop;
+    StatusNotifierItem **items;
+    guint nb;
+    GdkPixbuf *pixbufs[2];
+    gdouble rates[NB_UPD];
+    guint64 done[NB_UPD];
+    guint next[NB_UPD];
+    gint64 start;
+    gint64 end;
+    guint64 cpu_start;
+    gboolean started;
+};
+
+static void
+update (struct load *l, guint upd)
+{
+    StatusNotifierItem *sn = l->items[l->next[upd]];
+    gchar buf[64];
+
+    g_snprintf (buf, sizeof (buf), STAMP_PREFIX "%" G_GINT64_FORMAT,
+            g_get_monotonic_time ());
+    switch (upd)
+    {
+        case UPD_ICON:
+            if (l->pixbufs[0])
+                /* flip every round so it does change */
+                status_notifier_item_set_from_pixbuf (sn, STATUS_NOTIFIER_ICON,
+                        l->pixbufs[(l->done[upd] / l->nb) & 1]);
+            else
+                status_notifier_item_set_from_icon_name (sn, STATUS_NOTIFIER_ICON, buf);
+            break;
+
+        case UPD_TOOLTIP:
+            status_notifier_item_set_tooltip_body (sn, buf);
+            break;
+
+        case UPD_STATUS:
+            status_notifier_item_set_status (sn,
+                    (status_notifier_item_get_status (sn) == STATUS_NOTIFIER_STATUS_ACTIVE)
+                    ? STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION
+                    : STATUS_NOTIFIER_STATUS_ACTIVE);
+            break;
+    }
+
+    ++l->done[upd];
+    if (++l->next[upd] >= l->nb)
+        l->next[upd] = 0;
+}
+
+/* a single timer for all items: each tick catches up on the updates due so far,
+ * so any rate works regardless of the number of items */
+static gboolean
+tick (struct load *l)
+{
+    gint64 now = g_get_monotonic_time ();
+    guint upd;
+
+    if (now >= l->end)
+    {
+        g_main_loop_quit (l->loop);
+        return G_SOURCE_REMOVE;
+    }
+
+    for (upd = 0; upd < NB_UPD; ++upd)
+    {
+        guint64 due;
+
+        due = (guint64) (l->rates[upd] * l->nb * (gdouble) (now - l->start)
+                / G_USEC_PER_SEC);
+        while (l->done[upd] < due)
+            update (l, upd);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+worker_stdin (GIOChannel *channel, GIOCondition cond _UNUSED_, struct load *l)
+{
+    gchar *line = NULL;
+    GIOStatus status;
+
+    status = g_io_channel_read_line (channel, &line, NULL, NULL, NULL);
+    if (status == G_IO_STATUS_AGAIN)
+        return G_SOURCE_CONTINUE;
+    if (status != G_IO_STATUS_NORMAL)
+    {
+        /* parent is gone */
+        if (!l->started)
+            exit (1);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (!l->started && g_str_has_prefix (line, "go"))
+    {
+        l->started = TRUE;
+        l->cpu_start = process_cpu_us ();
+        l->start = g_get_monotonic_time ();
+        l->end = l->start + opt_duration * G_USEC_PER_SEC;
+        g_timeout_add (TICK_MS, (GSourceFunc) tick, l);
+    }
+    g_free (line);
+    return G_SOURCE_CONTINUE;
+}
+
+static gint
+worker_main (void)
+{
+    struct load l = { NULL, };
+    GIOChannel *channel;
+    guint64 rss_base;
+    guint64 updates;
+    guint i;
+
+    rss_base = process_rss_kb ();
+
+    l.nb = (guint) opt_items;
+    l.rates[UPD_ICON] = opt_icon_rate;
+    l.rates[UPD_TOOLTIP] = opt_tooltip_rate;
+    l.rates[UPD_STATUS] = opt_status_rate;
+    if (opt_pixmap_size > 0)
+    {
+        l.pixbufs[0] = pixbuf_new_test (opt_pixmap_size);
+        l.pixbufs[1] = gdk_pixbuf_flip (l.pixbufs[0], TRUE);
+    }
+
+    l.items = g_new (StatusNotifierItem *, l.nb);
+    for (i = 0; i < l.nb; ++i)
+    {
+        gchar id[64];
+
+        g_snprintf (id, sizeof (id), "sn-loadgen-%d-%u", opt_worker_index, i);
+        if (l.pixbufs[0])
+            l.items[i] = status_notifier_item_new_from_pixbuf (id,
+                    STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, l.pixbufs[0]);
+        else
+            l.items[i] = status_notifier_item_new_from_icon_name (id,
+                    STATUS_NOTIFIER_CATEGORY_APPLICATION_STATUS, STAMP_PREFIX "0");
+        status_notifier_item_set_title (l.items[i], id);
+        status_notifier_item_set_status (l.items[i], STATUS_NOTIFIER_STATUS_ACTIVE);
+        status_notifier_item_set_batch_signals (l.items[i], opt_batch_signals);
+        status_notifier_item_register (l.items[i]);
+    }
+    if (!bus_wait_registered (l.items, l.nb, 120))
+    {
+        g_printerr ("worker %d: Failed to register items\n", opt_worker_index);
+        return 1;
+    }
+
+    l.loop = g_main_loop_new (NULL, FALSE);
+    channel = g_io_channel_unix_new (STDIN_FILENO);
+    g_io_add_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+            (GIOFunc) worker_stdin, &l);
+
+    printf ("ready\n");
+    fflush (stdout);
+    g_main_loop_run (l.loop);
+
+    updates = l.done[UPD_ICON] + l.done[UPD_TOOLTIP] + l.done[UPD_STATUS];
+    printf ("result %u %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+            " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT "\n",
+            l.nb, updates, process_cpu_us () - l.cpu_start, process_rss_kb (), rss_base);
+    fflush (stdout);
+
+    for (i = 0; i < l.nb; ++i)
+        g_object_unref (l.items[i]);
+    g_free (l.items);
+    if (l.pixbufs[0])
+    {
+        g_object_unref (l.pixbufs[0]);
+        g_object_unref (l.pixbufs[1]);
+    }
+    g_io_channel_unref (channel);
+    g_main_loop_unref (l.loop);
+    return 0;
+}
+
+
+/* parent: hosts, bus monitor & workers */
+
+struct loadgen;
+
+struct host
+{
+    struct loadgen *lg;
+    GThread *thread;
+    GMainContext *context;
+    GDBusConnection *conn;
+    GArray *latencies;
+    /* items (sender & object path) signals were seen from */
+    GHashTable *seen;
+    guint64 signals;
+    guint64 calls;
+    guint64 errors;
+    gint pending;
+};
+
+struct worker
+{
+    struct loadgen *lg;
+    GSubprocess *proc;
+    GDataInputStream *out;
+    gboolean ready;
+    gboolean done;
+    guint items;
+    guint64 updates;
+    guint64 cpu_us;
+    guint64 rss_kb;
+    guint64 rss_base_kb;
+};
+
+struct loadgen
+{
+    gchar *address;
+    GMainLoop *loop;
+    gboolean failed;
+
+    GMutex mutex;
+    GCond cond;
+    guint hosts_ready;
+    gint stop;
+
+    /* set while measuring; read from host & GDBus worker threads */
+    gint measuring;
+    gint64 start;
+    gint64 end;
+
+    GDBusConnection *monitor;
+    gboolean monitoring;
+    gint nb_msgs;
+
+    struct host *hosts;
+    struct worker *workers;
+    guint nb_ready;
+    guint nb_done;
+};
+
+static const gchar *
+property_for_signal (const gchar *signal)
+{
+    if (!g_strcmp0 (signal, "NewIcon"))
+        return (opt_pixmap_size > 0) ? "IconPixmap" : "IconName";
+    else if (!g_strcmp0 (signal, "NewToolTip"))
+        return "ToolTip";
+    else if (!g_strcmp0 (signal, "NewStatus"))
+        return "Status";
+    else if (!g_strcmp0 (signal, "NewTitle"))
+        return "Title";
+    else if (!g_strcmp0 (signal, "NewAttentionIcon"))
+        return "AttentionIconName";
+    else if (!g_strcmp0 (signal, "NewOverlayIcon"))
+        return "OverlayIconName";
+    return NULL;
+}
+
+static void
+host_got_prop (GDBusConnection *conn, GAsyncResult *result, struct host *host)
+{
+    struct loadgen *lg = host->lg;
+    gint64 now = g_get_monotonic_time ();
+    GVariant *ret;
+    GVariant *value;
+    const gchar *s = NULL;
+
+    --host->pending;
+    ret = g_dbus_connection_call_finish (conn, result, NULL);
+    if (!ret)
+    {
+        if (g_atomic_int_get (&lg->measuring))
+            ++host->errors;
+        return;
+    }
+
+    g_variant_get (ret, "(v)", &value);
+    if (g_variant_is_of_type (value, G_VARIANT_TYPE ("(sa(iiay)ss)")))
+        g_variant_get_child (value, 3, "&s", &s);
+    else if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+        s = g_variant_get_string (value, NULL);
+
+    if (s && g_str_has_prefix (s, STAMP_PREFIX) && g_atomic_int_get (&lg->measuring))
+    {
+        gint64 stamp = g_ascii_strtoll (s + strlen (STAMP_PREFIX), NULL, 10);
+
+        if (stamp > 0)
+        {
+            gint64 latency = now - stamp;
+
+            g_array_append_val (host->latencies, latency);
+        }
+    }
+
+    g_variant_unref (value);
+    g_variant_unref (ret);
+}
+
+static void
+host_signal (GDBusConnection *conn,
+             const gchar     *sender,
+             const gchar     *object,
+             const gchar     *interface _UNUSED_,
+             const gchar     *signal,
+             GVariant        *params _UNUSED_,
+             struct host     *host)
+{
+    const gchar *property;
+
+    if (!g_atomic_int_get (&host->lg->measuring))
+        return;
+
+    ++host->signals;
+    g_hash_table_add (host->seen, g_strconcat (sender, object, NULL));
+    property = property_for_signal (signal);
+    if (!property)
+        return;
+
+    ++host->calls;
+    ++host->pending;
+    g_dbus_connection_call (conn,
+            sender,
+            object,
+            "org.freedesktop.DBus.Properties",
+            "Get",
+            g_variant_new ("(ss)", ITEM_INTERFACE, property),
+            G_VARIANT_TYPE ("(v)"),
+            G_DBUS_CALL_FLAGS_NONE,
+            CALL_TIMEOUT_MS, NULL,
+            (GAsyncReadyCallback) host_got_prop,
+            host);
+}
+
+static gpointer
+host_thread (struct host *host)
+{
+    struct loadgen *lg = host->lg;
+    GError *err = NULL;
+    GVariant *variant;
+    gint64 deadline;
+    guint id = 0;
+
+    g_main_context_push_thread_default (host->context);
+    host->conn = g_dbus_connection_new_for_address_sync (lg->address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+            NULL, NULL, &err);
+    if (host->conn)
+    {
+        /* any path, as items sharing a connection use their own */
+        id = g_dbus_connection_signal_subscribe (host->conn,
+                NULL,
+                ITEM_INTERFACE,
+                NULL,
+                NULL,
+                NULL,
+                G_DBUS_SIGNAL_FLAGS_NONE,
+                (GDBusSignalCallback) host_signal,
+                host, NULL);
+        /* make sure the match rule was processed by the bus */
+        variant = g_dbus_connection_call_sync (host->conn,
+                "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                "org.freedesktop.DBus", "GetId",
+                NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+        if (variant)
+            g_variant_unref (variant);
+    }
+    else
+    {
+        g_printerr ("host: Failed to connect: %s\n", err->message);
+        g_clear_error (&err);
+    }
+
+    g_mutex_lock (&lg->mutex);
+    ++lg->hosts_ready;
+    g_cond_signal (&lg->cond);
+    g_mutex_unlock (&lg->mutex);
+
+    while (!g_atomic_int_get (&lg->stop))
+        g_main_context_iteration (host->context, TRUE);
+
+    /* let in-flight calls complete (or time out) */
+    deadline = g_get_monotonic_time () + (CALL_TIMEOUT_MS + 1000) * 1000;
+    while (host->pending > 0 && g_get_monotonic_time () < deadline)
+        g_main_context_iteration (host->context, TRUE);
+
+    if (host->conn)
+    {
+        g_dbus_connection_signal_unsubscribe (host->conn, id);
+        g_object_unref (host->conn);
+    }
+    g_main_context_pop_thread_default (host->context);
+    return NULL;
+}
+
+/* called from GDBus' worker thread; we never let any message through once
+ * monitoring, as a monitor must not reply to anything */
+static GDBusMessage *
+monitor_filter (GDBusConnection *conn _UNUSED_,
+                GDBusMessage    *message,
+                gboolean         incoming,
+                struct loadgen  *lg)
+{
+    if (!incoming)
+        return message;
+    if (!g_atomic_int_get (&lg->monitoring))
+    {
+        if (g_dbus_message_get_message_type (message) == G_DBUS_MESSAGE_TYPE_METHOD_CALL)
+        {
+            g_object_unref (message);
+            return NULL;
+        }
+        return message;
+    }
+
+    if (g_atomic_int_get (&lg->measuring))
+        g_atomic_int_inc (&lg->nb_msgs);
+    g_object_unref (message);
+    return NULL;
+}
+
+static gboolean
+monitor_up (struct loadgen *lg)
+{
+    GError *err = NULL;
+    GVariant *variant;
+
+    lg->monitor = g_dbus_connection_new_for_address_sync (lg->address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+            | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+            NULL, NULL, &err);
+    if (!lg->monitor)
+        goto err;
+
+    g_dbus_connection_add_filter (lg->monitor,
+            (GDBusMessageFilterFunction) monitor_filter, lg, NULL);
+    variant = g_dbus_connection_call_sync (lg->monitor,
+            "org.freedesktop.DBus",
+            "/org/freedesktop/DBus",
+            "org.freedesktop.DBus.Monitoring",
+            "BecomeMonitor",
+            g_variant_new ("(asu)", NULL, 0),
+            NULL,
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL, &err);
+    if (!variant)
+        goto err;
+    g_variant_unref (variant);
+    g_atomic_int_set (&lg->monitoring, TRUE);
+    return TRUE;
+
+err:
+    g_printerr ("Cannot monitor the bus, only messages seen by hosts will be "
+            "counted: %s\n", err->message);
+    g_clear_error (&err);
+    g_clear_object (&lg->monitor);
+    return FALSE;
+}
+
+static void
+start_measuring (struct loadgen *lg)
+{
+    guint i;
+
+    g_atomic_int_set (&lg->nb_msgs, 0);
+    lg->start = g_get_monotonic_time ();
+    g_atomic_int_set (&lg->measuring, TRUE);
+
+    for (i = 0; i < (guint) opt_processes; ++i)
+    {
+        GOutputStream *in = g_subprocess_get_stdin_pipe (lg->workers[i].proc);
+        GError *err = NULL;
+
+        if (!g_output_stream_write_all (in, "go\n", 3, NULL, NULL, &err))
+        {
+            g_printerr ("worker %u: %s\n", i, err->message);
+            g_clear_error (&err);
+            lg->failed = TRUE;
+            g_main_loop_quit (lg->loop);
+            return;
+        }
+    }
+}
+
+static void
+worker_line (GDataInputStream *out, GAsyncResult *result, struct worker *w)
+{
+    struct loadgen *lg = w->lg;
+    gchar *line;
+
+    line = g_data_input_stream_read_line_finish_utf8 (out, result, NULL, NULL);
+    if (!line)
+    {
+        if (!w->done)
+        {
+            g_printerr ("worker %u exited prematurely\n", (guint) (w - lg->workers));
+            lg->failed = TRUE;
+            g_main_loop_quit (lg->loop);
+        }
+        return;
+    }
+
+    if (!strcmp (line, "ready"))
+    {
+        w->ready = TRUE;
+        if (++lg->nb_ready == (guint) opt_processes)
+            start_measuring (lg);
+    }
+    else if (g_str_has_prefix (line, "result "))
+    {
+        if (sscanf (line, "result %u %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                    " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+                    &w->items, &w->updates, &w->cpu_us,
+                    &w->rss_kb, &w->rss_base_kb) != 5)
+            g_printerr ("worker %u: Invalid result: %s\n",
+                    (guint) (w - lg->workers), line);
+        w->done = TRUE;
+        if (++lg->nb_done == (guint) opt_processes)
+        {
+            lg->end = g_get_monotonic_time ();
+            g_atomic_int_set (&lg->measuring, FALSE);
+            g_main_loop_quit (lg->loop);
+        }
+    }
+    else
+        g_printerr ("%s\n", line);
+    g_free (line);
+
+    g_data_input_stream_read_line_async (out, G_PRIORITY_DEFAULT, NULL,
+            (GAsyncReadyCallback) worker_line, w);
+}
+
+static gboolean
+spawn_worker (struct loadgen *lg, guint i, const gchar *self, GError **error)
+{
+    struct worker *w = &lg->workers[i];
+    GPtrArray *args;
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    guint nb;
+
+    nb = (guint) opt_items / (guint) opt_processes
+        + ((i < (guint) opt_items % (guint) opt_processes) ? 1 : 0);
+
+    args = g_ptr_array_new_with_free_func (g_free);
+    g_ptr_array_add (args, g_strdup (self));
+    g_ptr_array_add (args, g_strdup ("--worker"));
+    g_ptr_array_add (args, g_strdup_printf ("--worker-index=%u", i));
+    g_ptr_array_add (args, g_strdup_printf ("--items=%u", nb));
+    g_ptr_array_add (args, g_strdup_printf ("--duration=%d", opt_duration));
+    g_ptr_array_add (args, g_strdup_printf ("--pixmap-size=%d", opt_pixmap_size));
+    g_ptr_array_add (args, g_strconcat ("--icon-rate=",
+                g_ascii_dtostr (buf, sizeof (buf), opt_icon_rate), NULL));
+    g_ptr_array_add (args, g_strconcat ("--tooltip-rate=",
+                g_ascii_dtostr (buf, sizeof (buf), opt_tooltip_rate), NULL));
+    g_ptr_array_add (args, g_strconcat ("--status-rate=",
+                g_ascii_dtostr (buf, sizeof (buf), opt_status_rate), NULL));
+    if (opt_batch_signals)
+        g_ptr_array_add (args, g_strdup ("--batch-signals"));
+    g_ptr_array_add (args, NULL);
+
+    w->lg = lg;
+    /* DBUS_SESSION_BUS_ADDRESS is inherited, hence the private bus if any */
+    w->proc = g_subprocess_newv ((const gchar * const *) args->pdata,
+            G_SUBPROCESS_FLAGS_STDIN_PIPE | G_SUBPROCESS_FLAGS_STDOUT_PIPE,
+            error);
+    g_ptr_array_unref (args);
+    if (!w->proc)
+        return FALSE;
+
+    w->out = g_data_input_stream_new (g_subprocess_get_stdout_pipe (w->proc));
+    g_data_input_stream_read_line_async (w->out, G_PRIORITY_DEFAULT, NULL,
+            (GAsyncReadyCallback) worker_line, w);
+    return TRUE;
+}
+
+static gboolean
+timed_out (struct loadgen *lg)
+{
+    g_printerr ("Timeout: %u/%d workers ready, %u/%d done\n",
+            lg->nb_ready, opt_processes, lg->nb_done, opt_processes);
+    lg->failed = TRUE;
+    g_main_loop_quit (lg->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static gint
+cmp_gint64 (gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64 *) a;
+    gint64 y = *(const gint64 *) b;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* nearest-rank */
+static gint64
+percentile (GArray *arr, guint p)
+{
+    guint rank;
+
+    if (arr->len == 0)
+        return 0;
+    rank = (guint) (((guint64) p * arr->len + 99) / 100);
+    return g_array_index (arr, gint64, CLAMP (rank, 1, arr->len) - 1);
+}
+
+static void
+report_loadgen (struct loadgen *lg)
+{
+    GArray *latencies;
+    guint64 signals = 0, calls = 0, errors = 0;
+    guint seen = G_MAXUINT;
+    guint64 items = 0, updates = 0, cpu_us = 0, rss_kb = 0, rss_delta_kb = 0;
+    guint64 msgs;
+    gdouble secs;
+    guint i;
+
+    latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    for (i = 0; i < (guint) opt_hosts; ++i)
+    {
+        struct host *host = &lg->hosts[i];
+
+        g_array_append_vals (latencies, host->latencies->data, host->latencies->len);
+        signals += host->signals;
+        calls += host->calls;
+        errors += host->errors;
+        seen = MIN (seen, g_hash_table_size (host->seen));
+    }
+    g_array_sort (latencies, cmp_gint64);
+
+    for (i = 0; i < (guint) opt_processes; ++i)
+    {
+        struct worker *w = &lg->workers[i];
+
+        items += w->items;
+        updates += w->updates;
+        cpu_us += w->cpu_us;
+        rss_kb += w->rss_kb;
+        if (w->rss_kb > w->rss_base_kb)
+            rss_delta_kb += w->rss_kb - w->rss_base_kb;
+    }
+
+    /* without a monitor: the signals, plus each Get & its reply */
+    msgs = (lg->monitor) ? (guint64) g_atomic_int_get (&lg->nb_msgs) : signals + 2 * calls;
+    secs = (gdouble) (lg->end - lg->start) / G_USEC_PER_SEC;
+    if (secs <= 0.)
+        secs = 1.;
+
+    g_print ("{\"bench\": \"loadgen\", \"items\": %" G_GUINT64_FORMAT
+            ", \"processes\": %d, \"hosts\": %d, \"total_us\": %" G_GINT64_FORMAT
+            ", \"updates\": %" G_GUINT64_FORMAT ", \"updates_per_sec\": %.1f"
+            ", \"bus_msgs\": %" G_GUINT64_FORMAT ", \"bus_msgs_per_sec\": %.1f"
+            ", \"bus_msgs_source\": \"%s\""
+            ", \"host_items_seen\": %u"
+            ", \"host_signals\": %" G_GUINT64_FORMAT
+            ", \"host_calls\": %" G_GUINT64_FORMAT
+            ", \"host_errors\": %" G_GUINT64_FORMAT
+            ", \"latency_samples\": %u"
+            ", \"latency_us_p50\": %" G_GINT64_FORMAT
+            ", \"latency_us_p90\": %" G_GINT64_FORMAT
+            ", \"latency_us_p99\": %" G_GINT64_FORMAT
+            ", \"latency_us_max\": %" G_GINT64_FORMAT
+            ", \"cpu_pct_per_item\": %.4f"
+            ", \"rss_kb_total\": %" G_GUINT64_FORMAT
+            ", \"rss_kb_per_item\": %.2f}\n",
+            items, opt_processes, opt_hosts, lg->end - lg->start,
+            updates, (gdouble) updates / secs,
+            msgs, (gdouble) msgs / secs,
+            (lg->monitor) ? "monitor" : "hosts",
+            seen, signals, calls, errors,
+            latencies->len,
+            percentile (latencies, 50),
+            percentile (latencies, 90),
+            percentile (latencies, 99),
+            percentile (latencies, 100),
+            (items > 0) ? (gdouble) cpu_us * 100. / (secs * G_USEC_PER_SEC) / items : 0.,
+            rss_kb,
+            (items > 0) ? (gdouble) rss_delta_kb / items : 0.);
+
+    g_array_unref (latencies);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    GError *err = NULL;
+    GOptionContext *context;
+    struct loadgen lg = { NULL, };
+    struct bus bus;
+    gchar *self;
+    guint tid;
+    guint i;
+
+    context = g_option_context_new ("- statusnotifier load generator");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &err))
+    {
+        g_printerr ("%s\n", err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+    g_option_context_free (context);
+    opt_items = MAX (1, opt_items);
+    opt_processes = CLAMP (opt_processes, 1, opt_items);
+    opt_hosts = MAX (0, opt_hosts);
+    opt_duration = MAX (1, opt_duration);
+
+    if (opt_worker)
+        return worker_main ();
+
+    if (opt_private_bus)
+    {
+        if (!bus_up (&bus, &err))
+        {
+            g_printerr ("Failed to set up private bus: %s\n", err->message);
+            g_clear_error (&err);
+            return 1;
+        }
+        lg.address = g_strdup (bus.address);
+    }
+    else
+    {
+        lg.address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION, NULL, &err);
+        if (!lg.address)
+        {
+            g_printerr ("No session bus: %s\n", err->message);
+            g_clear_error (&err);
+            return 1;
+        }
+    }
+
+    lg.loop = g_main_loop_new (NULL, FALSE);
+    g_mutex_init (&lg.mutex);
+    g_cond_init (&lg.cond);
+    monitor_up (&lg);
+
+    lg.hosts = g_new0 (struct host, (guint) opt_hosts);
+    for (i = 0; i < (guint) opt_hosts; ++i)
+    {
+        lg.hosts[i].lg = &lg;
+        lg.hosts[i].context = g_main_context_new ();
+        lg.hosts[i].latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+        lg.hosts[i].seen = g_hash_table_new_full (g_str_hash, g_str_equal,
+                g_free, NULL);
+        lg.hosts[i].thread = g_thread_new ("host",
+                (GThreadFunc) host_thread, &lg.hosts[i]);
+    }
+    g_mutex_lock (&lg.mutex);
+    while (lg.hosts_ready < (guint) opt_hosts)
+        g_cond_wait (&lg.cond, &lg.mutex);
+    g_mutex_unlock (&lg.mutex);
+
+    self = g_file_read_link ("/proc/self/exe", NULL);
+    if (!self)
+        self = g_strdup (argv[0]);
+    lg.workers = g_new0 (struct worker, (guint) opt_processes);
+    for (i = 0; i < (guint) opt_processes; ++i)
+        if (!spawn_worker (&lg, i, self, &err))
+        {
+            g_printerr ("Failed to spawn worker: %s\n", err->message);
+            g_clear_error (&err);
+            lg.failed = TRUE;
+            break;
+        }
+    g_free (self);
+
+    if (!lg.failed)
+    {
+        tid = g_timeout_add_seconds ((guint) opt_duration + 180,
+                (GSourceFunc) timed_out, &lg);
+        g_main_loop_run (lg.loop);
+        if (!lg.failed)
+            g_source_remove (tid);
+    }
+    g_atomic_int_set (&lg.measuring, FALSE);
+
+    g_atomic_int_set (&lg.stop, TRUE);
+    for (i = 0; i < (guint) opt_hosts; ++i)
+    {
+        g_main_context_wakeup (lg.hosts[i].context);
+        g_thread_join (lg.hosts[i].thread);
+    }
+
+    if (!lg.failed)
+        report_loadgen (&lg);
+
+    for (i = 0; i < (guint) opt_processes; ++i)
+    {
+        struct worker *w = &lg.workers[i];
+
+        if (!w->proc)
+            continue;
+        if (!w->done)
+            g_subprocess_force_exit (w->proc);
+        g_subprocess_wait (w->proc, NULL, NULL);
+        g_object_unref (w->out);
+        g_object_unref (w->proc);
+    }
+    g_free (lg.workers);
+    for (i = 0; i < (guint) opt_hosts; ++i)
+    {
+        g_array_unref (lg.hosts[i].latencies);
+        g_hash_table_unref (lg.hosts[i].seen);
+        g_main_context_unref (lg.hosts[i].context);
+    }
+    g_free (lg.hosts);
+
+    g_clear_object (&lg.monitor);
+    g_mutex_clear (&lg.mutex);
+    g_cond_clear (&lg.cond);
+    g_main_loop_unref (lg.loop);
+    g_free (lg.address);
+    if (opt_private_bus)
+        bus_down (&bus);
+    return (lg.failed) ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * testpixbuf.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include "testpixbuf.h"
+
+/* a @size x @size RGBA pixbuf, with a gradient & varying alpha so nothing can
+ * be optimized away */
+GdkPixbuf *
+pixbuf_new_test (gint size)
+{
+    GdkPixbuf *pixbuf;
+    guchar *pixels;
+    gint rowstride;
+    gint x, y;
+
+    pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    for (y = 0; y < size; ++y)
+        for (x = 0; x < size; ++x)
+        {
+            guchar *p = pixels + y * rowstride + x * 4;
+
+            p[0] = (guchar) (x * 255 / size);
+            p[1] = (guchar) (y * 255 / size);
+            p[2] = (guchar) ((x + y) * 127 / size);
+            p[3] = (guchar) (255 - ((x ^ y) & 0x7f));
+        }
+    return pixbuf;
+}
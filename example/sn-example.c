@@ -23,9 +23,11 @@
 #include "config.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <statusnotifier.h>
 #include <string.h>
+#include <unistd.h>
 
 #define streq(s1, s2)           (((s1) == NULL && (s2) == NULL) ? 1 \
         : ((s1) == NULL || (s2) == NULL) ? 0 : strcmp  ((s1), (s2)) == 0)
@@ -34,7 +36,8 @@
 enum rc
 {
     RC_OK = 0,
-    RC_CMDLINE
+    RC_CMDLINE,
+    RC_ICON
 };
 
 struct config
@@ -46,7 +49,8 @@ struct config
         gboolean has_pixbuf;
         union {
             gchar *icon_name;
-            GdkPixbuf *pixbuf;
+            /* loaded asynchronously, see icon_loaded() */
+            gchar *filename;
         };
     } icon[_NB_STATUS_NOTIFIER_ICONS];
     gchar *tooltip_title;
@@ -159,6 +163,20 @@ sn_reg_failed (StatusNotifierItem *sn, GError *error, GMainLoop *loop)
     g_main_loop_quit (loop);
 }
 
+static void
+icon_loaded (StatusNotifierItem *sn, GAsyncResult *result, GMainLoop *loop)
+{
+    GError *err = NULL;
+
+    if (!status_notifier_item_set_from_file_finish (sn, result, &err))
+    {
+        fprintf (stderr, "Failed to load pixbuf: %s\n", err->message);
+        g_clear_error (&err);
+        g_object_set_data ((GObject *) sn, "sn-rc", GUINT_TO_POINTER (RC_ICON));
+        g_main_loop_quit (loop);
+    }
+}
+
 static gboolean
 cmdline_category (const gchar   *option,
                   const gchar   *value,
@@ -211,10 +229,7 @@ static void
 free_icon (struct config *cfg, StatusNotifierIcon icon)
 {
     if (cfg->icon[icon].has_pixbuf)
-    {
-        if (cfg->icon[icon].pixbuf)
-            g_object_unref (cfg->icon[icon].pixbuf);
-    }
+        g_free (cfg->icon[icon].filename);
     else
         g_free (cfg->icon[icon].icon_name);
     cfg->icon[icon].has_pixbuf = FALSE;
@@ -250,7 +265,6 @@ cmdline_icon_pixbuf (const gchar    *option,
                      GError        **error)
 {
     StatusNotifierIcon icon;
-    GdkPixbuf *pixbuf;
 
     if (streq (option, "-I") || streq (option, "--pixbuf"))
         icon = STATUS_NOTIFIER_ICON;
@@ -261,15 +275,16 @@ cmdline_icon_pixbuf (const gchar    *option,
     else /* if (streq (option, "-L") || streq (option, "--tooltip-pixbuf")) */
         icon = STATUS_NOTIFIER_TOOLTIP_ICON;
 
-    pixbuf = gdk_pixbuf_new_from_file (value, error);
-    if (!pixbuf)
+    /* loaded once the item exists, without blocking; So only checked here */
+    if (!g_file_test (value, G_FILE_TEST_IS_REGULAR)
+            || g_access (value, R_OK) < 0)
     {
-        g_prefix_error (error, "Failed to load pixbuf from '%s': ", value);
+        g_set_error (error, EXAMPLE_ERROR, RC_CMDLINE,
+                "Cannot read pixbuf from '%s'", value);
         return FALSE;
     }
-
     free_icon (cfg, icon);
-    cfg->icon[icon].pixbuf = pixbuf;
+    cfg->icon[icon].filename = g_strdup (value);
     cfg->icon[icon].has_pixbuf = TRUE;
     return TRUE;
 }
@@ -335,18 +350,13 @@ main (gint argc, gchar *argv[])
     GMainLoop *loop;
     StatusNotifierItem *sn;
     struct config cfg = { 0, };
+    enum rc rc;
     const gchar *prop_name_from_icon[_NB_STATUS_NOTIFIER_ICONS] = {
         "main-icon-name",
         "attention-icon-name",
         "overlay-icon-name",
         "tooltip-icon-name"
     };
-    const gchar *prop_pixbuf_from_icon[_NB_STATUS_NOTIFIER_ICONS] = {
-        "main-icon-pixbuf",
-        "attention-icon-pixbuf",
-        "overlay-icon-pixbuf",
-        "tooltip-icon-pixbuf"
-    };
     guint i;
 
     gtk_init (&argc, &argv);
@@ -369,7 +379,8 @@ main (gint argc, gchar *argv[])
     for (i = 0; i < _NB_STATUS_NOTIFIER_ICONS; ++i)
     {
         if (cfg.icon[i].has_pixbuf)
-            g_object_set (sn, prop_pixbuf_from_icon[i], cfg.icon[i].pixbuf, NULL);
+            status_notifier_item_set_from_file_async (sn, i, cfg.icon[i].filename,
+                    -1, NULL, (GAsyncReadyCallback) icon_loaded, loop);
         else if (cfg.icon[i].icon_name)
             g_object_set (sn, prop_name_from_icon[i], cfg.icon[i].icon_name, NULL);
     }
@@ -390,6 +401,7 @@ main (gint argc, gchar *argv[])
     status_notifier_item_register (sn);
     g_main_loop_run (loop);
 
+    rc = GPOINTER_TO_UINT (g_object_get_data ((GObject *) sn, "sn-rc"));
     g_object_unref (sn);
-    return RC_OK;
+    return (gint) rc;
 }
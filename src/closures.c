@@ -20,6 +20,11 @@
  * statusnotifier. If not, see http://www.gnu.org/licenses/
  */
 
+/* generated code (see closures): valist marshallers do not use all their
+ * parameters, and enums are peeked as long */
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wconversion"
+
 #include	<glib-object.h>
 #include "closures.h"
 
@@ -112,3 +117,140 @@ g_cclosure_user_marshal_BOOLEAN__INT_INT (GClosure     *closure,
   g_value_set_boolean (return_value, v_return);
 }
 
+void
+g_cclosure_user_marshal_BOOLEAN__INT_INTv (GClosure     *closure,
+                                           GValue       *return_value,
+                                           gpointer      instance,
+                                           va_list       args,
+                                           gpointer      marshal_data,
+                                           int           n_params,
+                                           GType        *param_types)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__INT_INT) (gpointer     instance,
+                                                     gint         arg_0,
+                                                     gint         arg_1,
+                                                     gpointer     data);
+  GCClosure *cc = (GCClosure*) closure;
+  gpointer data1, data2;
+  GMarshalFunc_BOOLEAN__INT_INT callback;
+  gboolean v_return;
+  gint arg0;
+  gint arg1;
+  va_list args_copy;
+
+  G_VA_COPY (args_copy, args);
+  arg0 = (gint) va_arg (args_copy, gint);
+  arg1 = (gint) va_arg (args_copy, gint);
+  va_end (args_copy);
+
+  g_return_if_fail (return_value != NULL);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = instance;
+    }
+  else
+    {
+      data1 = instance;
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__INT_INT) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       arg0,
+                       arg1,
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
+/* BOOLEAN:INT,ENUM (closures.def:2) */
+void
+g_cclosure_user_marshal_BOOLEAN__INT_ENUM (GClosure     *closure,
+                                           GValue       *return_value G_GNUC_UNUSED,
+                                           guint         n_param_values,
+                                           const GValue *param_values,
+                                           gpointer      invocation_hint G_GNUC_UNUSED,
+                                           gpointer      marshal_data)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__INT_ENUM) (gpointer     data1,
+                                                      gint         arg_1,
+                                                      gint         arg_2,
+                                                      gpointer     data2);
+  register GMarshalFunc_BOOLEAN__INT_ENUM callback;
+  register GCClosure *cc = (GCClosure*) closure;
+  register gpointer data1, data2;
+  gboolean v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 3);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__INT_ENUM) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       g_marshal_value_peek_int (param_values + 1),
+                       g_marshal_value_peek_enum (param_values + 2),
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
+void
+g_cclosure_user_marshal_BOOLEAN__INT_ENUMv (GClosure     *closure,
+                                            GValue       *return_value,
+                                            gpointer      instance,
+                                            va_list       args,
+                                            gpointer      marshal_data,
+                                            int           n_params,
+                                            GType        *param_types)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__INT_ENUM) (gpointer     instance,
+                                                      gint         arg_0,
+                                                      gint         arg_1,
+                                                      gpointer     data);
+  GCClosure *cc = (GCClosure*) closure;
+  gpointer data1, data2;
+  GMarshalFunc_BOOLEAN__INT_ENUM callback;
+  gboolean v_return;
+  gint arg0;
+  gint arg1;
+  va_list args_copy;
+
+  G_VA_COPY (args_copy, args);
+  arg0 = (gint) va_arg (args_copy, gint);
+  arg1 = (gint) va_arg (args_copy, gint);
+  va_end (args_copy);
+
+  g_return_if_fail (return_value != NULL);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = instance;
+    }
+  else
+    {
+      data1 = instance;
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__INT_ENUM) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       arg0,
+                       arg1,
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
@@ -34,6 +34,28 @@ extern void g_cclosure_user_marshal_BOOLEAN__INT_INT (GClosure     *closure,
                                                       const GValue *param_values,
                                                       gpointer      invocation_hint,
                                                       gpointer      marshal_data);
+extern void g_cclosure_user_marshal_BOOLEAN__INT_INTv (GClosure     *closure,
+                                                       GValue       *return_value,
+                                                       gpointer      instance,
+                                                       va_list       args,
+                                                       gpointer      marshal_data,
+                                                       int           n_params,
+                                                       GType        *param_types);
+
+/* BOOLEAN:INT,ENUM (closures.def:2) */
+extern void g_cclosure_user_marshal_BOOLEAN__INT_ENUM (GClosure     *closure,
+                                                       GValue       *return_value,
+                                                       guint         n_param_values,
+                                                       const GValue *param_values,
+                                                       gpointer      invocation_hint,
+                                                       gpointer      marshal_data);
+extern void g_cclosure_user_marshal_BOOLEAN__INT_ENUMv (GClosure     *closure,
+                                                        GValue       *return_value,
+                                                        gpointer      instance,
+                                                        va_list       args,
+                                                        gpointer      marshal_data,
+                                                        int           n_params,
+                                                        GType        *param_types);
 
 G_END_DECLS
 
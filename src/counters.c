@@ -0,0 +1,161 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * counters.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include "counters.h"
+#include "iconstore.h"
+
+/* names as exposed (via GVariant a{st}); for get_prop() ones, what follows the
+ * prefix "get-prop." is the DBus property name */
+static const gchar * const counter_names[NB_COUNTERS] = {
+    "get-prop.Id",
+    "get-prop.Category",
+    "get-prop.Title",
+    "get-prop.Status",
+    "get-prop.WindowId",
+    "get-prop.IconName",
+    "get-prop.IconPixmap",
+    "get-prop.OverlayIconName",
+    "get-prop.OverlayIconPixmap",
+    "get-prop.AttentionIconName",
+    "get-prop.AttentionIconPixmap",
+    "get-prop.AttentionMovieName",
+    "get-prop.ToolTip",
+    "get-prop.ItemIsMenu",
+    "get-prop.Menu",
+    "pixmap-conversions",
+    "pixmap-bytes",
+    "icon-store-hits",
+    "disk-cache-hits",
+    "disk-cache-writes",
+    "pixmap-background",
+    "pixmap-cancelled",
+    "file-decodes",
+    "file-cache-hits",
+    "resource-icons",
+    "render-frames",
+    "render-cache-hits",
+    "render-glyphs",
+    "overlay-composites",
+    "overlay-cache-hits",
+    "fit-downscales",
+    "fit-cache-hits",
+    "delta-requests",
+    "delta-full",
+    "delta-bytes",
+    "fd-exports",
+    "fd-cache-hits",
+    "fd-bytes",
+    "graph-samples",
+    "graph-coalesced",
+    "status-icon-switches",
+    "animation-frames",
+    "signal.NewTitle",
+    "signal.NewIcon",
+    "signal.NewAttentionIcon",
+    "signal.NewOverlayIcon",
+    "signal.NewToolTip",
+    "signal.NewStatus",
+    "signals-dropped",
+    "signals-batched",
+    "signals-coalesced",
+    "signals-deferred",
+    "signals-deferred-coalesced",
+    "signals-deferred-sent",
+    "signals-suppressed",
+    "signals-suppressed-coalesced",
+    "session-catch-ups",
+    "signals-frozen",
+    "registration-attempts",
+    "registration-failures",
+    "scroll-calls",
+    "scroll-emitted",
+    "time-us.get-prop",
+    "time-us.pixmap",
+    "time-us.render",
+    "time-us.file-decode",
+    "time-us.signals",
+    "time-us.registration"
+};
+
+#define GET_PROP_PREFIX_LEN     (sizeof ("get-prop.") - 1)
+
+static guint64 global_counters[NB_COUNTERS] = { 0, };
+
+/* adds @value to @counter for an item (@counters) and process-wide */
+void
+counters_add (guint64 *counters, Counter counter, guint64 value)
+{
+    counters[counter] += value;
+    global_counters[counter] += value;
+}
+
+/* returns the counter for DBus property @property, or NB_COUNTERS */
+Counter
+counters_get_prop (const gchar *property)
+{
+    Counter c;
+
+    for (c = 0; c < NB_COUNTERS_GET_PROP; ++c)
+        if (!g_strcmp0 (property, counter_names[c] + GET_PROP_PREFIX_LEN))
+            return c;
+    return NB_COUNTERS;
+}
+
+static void
+counters_add_to_builder (GVariantBuilder *builder, const guint64 *counters)
+{
+    Counter c;
+
+    for (c = 0; c < NB_COUNTERS; ++c)
+        g_variant_builder_add (builder, "{st}", counter_names[c], counters[c]);
+}
+
+/* returns a floating GVariant of type a{st} */
+GVariant *
+counters_to_variant (const guint64 *counters)
+{
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+    counters_add_to_builder (&builder, counters);
+    return g_variant_builder_end (&builder);
+}
+
+/* same, plus the current state of the icon store (not counters, as those can
+ * go down) */
+GVariant *
+counters_global_to_variant (void)
+{
+    GVariantBuilder builder;
+    guint entries, refs;
+    guint64 bytes;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+    counters_add_to_builder (&builder, global_counters);
+    icon_store_get_totals (&entries, &refs, &bytes);
+    g_variant_builder_add (&builder, "{st}", "icon-store.entries", (guint64) entries);
+    g_variant_builder_add (&builder, "{st}", "icon-store.refs", (guint64) refs);
+    g_variant_builder_add (&builder, "{st}", "icon-store.bytes", bytes);
+    return g_variant_builder_end (&builder);
+}
@@ -0,0 +1,157 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * counters.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __COUNTERS_H__
+#define __COUNTERS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Performance counters, kept per item and process-wide. They're only ever
+ * updated from the main thread. */
+typedef enum
+{
+    /* get_prop() calls, per DBus property (same order as in item_xml) */
+    COUNTER_GET_ID = 0,
+    COUNTER_GET_CATEGORY,
+    COUNTER_GET_TITLE,
+    COUNTER_GET_STATUS,
+    COUNTER_GET_WINDOW_ID,
+    COUNTER_GET_ICON_NAME,
+    COUNTER_GET_ICON_PIXMAP,
+    COUNTER_GET_OVERLAY_ICON_NAME,
+    COUNTER_GET_OVERLAY_ICON_PIXMAP,
+    COUNTER_GET_ATTENTION_ICON_NAME,
+    COUNTER_GET_ATTENTION_ICON_PIXMAP,
+    COUNTER_GET_ATTENTION_MOVIE_NAME,
+    COUNTER_GET_TOOLTIP,
+    COUNTER_GET_ITEM_IS_MENU,
+    COUNTER_GET_MENU,
+    /* pixbufs converted to pixmaps, and bytes (of pixel data) produced */
+    COUNTER_PIXMAP_CONVERSIONS,
+    COUNTER_PIXMAP_BYTES,
+    /* pixbufs not converted, as the same pixels were already in the icon store
+     * (e.g. same icon on another slot/item) */
+    COUNTER_ICON_STORE_HITS,
+    /* pixbufs not converted as mapped from the disk cache instead, and icons
+     * written to it (see disk-cache) */
+    COUNTER_DISK_CACHE_HITS,
+    COUNTER_DISK_CACHE_WRITES,
+    /* pixbufs converted in background threads (see background-conversion),
+     * and conversions skipped/dropped as the icon had changed since */
+    COUNTER_PIXMAP_BACKGROUND,
+    COUNTER_PIXMAP_CANCELLED,
+    /* images decoded for status_notifier_item_set_from_file_async(), and
+     * those found in the cache instead */
+    COUNTER_FILE_DECODES,
+    COUNTER_FILE_CACHE_HITS,
+    /* icons set from pre-compiled pixmaps (see
+     * status_notifier_item_set_from_resource()) */
+    COUNTER_RESOURCE_ICONS,
+    /* icons rendered (see render.c), found in the frame cache instead, and
+     * glyphs blitted */
+    COUNTER_RENDER_FRAMES,
+    COUNTER_RENDER_CACHE_HITS,
+    COUNTER_RENDER_GLYPHS,
+    /* main icons composited with the overlay (see composite-overlay), and
+     * those found in the cache instead */
+    COUNTER_OVERLAY_COMPOSITES,
+    COUNTER_OVERLAY_CACHE_HITS,
+    /* icons downscaled for a host's sizes (see SetIconSizes) or
+     * max-icon-size, and those found in the cache instead */
+    COUNTER_FIT_DOWNSCALES,
+    COUNTER_FIT_CACHE_HITS,
+    /* GetIconDelta calls, those that had to send everything, and bytes (of
+     * pixel data) sent */
+    COUNTER_DELTA_REQUESTS,
+    COUNTER_DELTA_FULL,
+    COUNTER_DELTA_BYTES,
+    /* icons written to memfds (see GetIconPixmapFd), those found in the cache
+     * instead, and bytes (of pixel data) written */
+    COUNTER_FD_EXPORTS,
+    COUNTER_FD_CACHE_HITS,
+    COUNTER_FD_BYTES,
+    /* samples added to graphs, and those that didn't get their own DBus
+     * signal (rate-limited) */
+    COUNTER_GRAPH_SAMPLES,
+    COUNTER_GRAPH_COALESCED,
+    /* main icon switched to the one pre-serialized for the new status */
+    COUNTER_STATUS_ICON_SWITCHES,
+    /* frames shown by the animation timer */
+    COUNTER_ANIMATION_FRAMES,
+    /* DBus signals emitted from dbus_notify() */
+    COUNTER_SIGNAL_NEW_TITLE,
+    COUNTER_SIGNAL_NEW_ICON,
+    COUNTER_SIGNAL_NEW_ATTENTION_ICON,
+    COUNTER_SIGNAL_NEW_OVERLAY_ICON,
+    COUNTER_SIGNAL_NEW_TOOLTIP,
+    COUNTER_SIGNAL_NEW_STATUS,
+    /* dbus_notify() calls while not registered */
+    COUNTER_SIGNALS_DROPPED,
+    /* signals queued for batching, and those replaced by a later one before
+     * being sent */
+    COUNTER_SIGNALS_BATCHED,
+    COUNTER_SIGNALS_COALESCED,
+    /* signals held back while Passive (see defer-when-passive), those already
+     * pending, and those eventually sent; The difference was avoided (as were
+     * the Get calls from hosts) */
+    COUNTER_SIGNALS_DEFERRED,
+    COUNTER_SIGNALS_DEFERRED_COALESCED,
+    COUNTER_SIGNALS_DEFERRED_SENT,
+    /* signals held back while the session was locked/idle (see
+     * throttle-when-inactive), those already pending, and catch-up updates
+     * sent once it wasn't */
+    COUNTER_SIGNALS_SUPPRESSED,
+    COUNTER_SIGNALS_SUPPRESSED_COALESCED,
+    COUNTER_SESSION_CATCH_UPS,
+    /* signals held back while the item's group was frozen, see
+     * status_notifier_item_group_freeze_notify() */
+    COUNTER_SIGNALS_FROZEN,
+    COUNTER_REGISTRATION_ATTEMPTS,
+    COUNTER_REGISTRATION_FAILURES,
+    /* Scroll method calls, and scroll signals emitted (fewer when coalescing) */
+    COUNTER_SCROLL_CALLS,
+    COUNTER_SCROLL_EMITTED,
+    /* time spent, in microseconds */
+    COUNTER_TIME_GET_PROP,
+    COUNTER_TIME_PIXMAP,
+    COUNTER_TIME_RENDER,
+    COUNTER_TIME_FILE_DECODE,
+    COUNTER_TIME_SIGNALS,
+    COUNTER_TIME_REGISTRATION,
+
+    NB_COUNTERS
+} Counter;
+
+#define NB_COUNTERS_GET_PROP    (COUNTER_GET_MENU + 1)
+
+void            counters_add            (guint64            *counters,
+                                         Counter             counter,
+                                         guint64             value);
+Counter         counters_get_prop       (const gchar        *property);
+GVariant *      counters_to_variant     (const guint64      *counters);
+GVariant *      counters_global_to_variant (void);
+
+G_END_DECLS
+
+#endif /* __COUNTERS_H__ */
@@ -0,0 +1,60 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * dbusmenu.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <gmodule.h>
+#include <gtk/gtk.h>
+#include <libdbusmenu-glib/menuitem.h>
+#include <libdbusmenu-glib/server.h>
+#include <libdbusmenu-gtk/parser.h>
+#include "dbusmenu.h"
+
+G_MODULE_EXPORT gboolean    sn_dbusmenu_is_menu         (GObject        *menu);
+G_MODULE_EXPORT GObject *   sn_dbusmenu_server_new      (const gchar    *object);
+G_MODULE_EXPORT void        sn_dbusmenu_server_set_menu (GObject        *server,
+                                                         GObject        *menu);
+
+G_MODULE_EXPORT gboolean
+sn_dbusmenu_is_menu (GObject *menu)
+{
+    return GTK_IS_MENU (menu);
+}
+
+G_MODULE_EXPORT GObject *
+sn_dbusmenu_server_new (const gchar *object)
+{
+    return (GObject *) dbusmenu_server_new (object);
+}
+
+G_MODULE_EXPORT void
+sn_dbusmenu_server_set_menu (GObject *server, GObject *menu)
+{
+    DbusmenuMenuitem *root;
+
+    root = dbusmenu_gtk_parse_menu_structure (GTK_WIDGET (menu));
+    dbusmenu_server_set_root ((DbusmenuServer *) server, root);
+
+    /* Drop our local ref as set_root should get it's own. */
+    if (root != NULL)
+        g_object_unref (root);
+}
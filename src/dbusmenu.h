@@ -0,0 +1,52 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * dbusmenu.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __DBUSMENU_H__
+#define __DBUSMENU_H__
+
+G_BEGIN_DECLS
+
+/* The dbusmenu backend is built as a module, only loaded (via GModule) the
+ * first time a context menu is set, so items not using one don't have to load
+ * libdbusmenu & GTK+ */
+
+#define DBUSMENU_MODULE_NAME        "statusnotifier-dbusmenu"
+/* to use the module from the build tree */
+#define DBUSMENU_MODULE_DIR_ENV     "STATUS_NOTIFIER_MODULE_DIR"
+
+#define DBUSMENU_OBJECT             "/MenuBar"
+/* DBUSMENU_SERVER_PROP_DBUS_OBJECT */
+#define DBUSMENU_PROP_DBUS_OBJECT   "dbus-object"
+
+/* symbols exported by the module */
+#define DBUSMENU_SYM_IS_MENU        "sn_dbusmenu_is_menu"
+#define DBUSMENU_SYM_SERVER_NEW     "sn_dbusmenu_server_new"
+#define DBUSMENU_SYM_SET_MENU       "sn_dbusmenu_server_set_menu"
+
+typedef gboolean    (*DbusmenuIsMenuFunc)       (GObject        *menu);
+typedef GObject *   (*DbusmenuServerNewFunc)    (const gchar    *object);
+typedef void        (*DbusmenuSetMenuFunc)      (GObject        *server,
+                                                 GObject        *menu);
+
+G_END_DECLS
+
+#endif /* __DBUSMENU_H__ */
@@ -0,0 +1,161 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * iconfile.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include "iconfile.h"
+
+/* icons by key, most recently used first */
+#define ICON_FILE_CACHE_MAX     32
+
+typedef struct
+{
+    gchar *key;
+    GdkPixbuf *pixbuf;
+    GList link;
+} Entry;
+
+static GHashTable *entries = NULL;
+static GQueue entries_lru = G_QUEUE_INIT;
+G_LOCK_DEFINE_STATIC (cache);
+
+static void
+entry_free (Entry *entry)
+{
+    g_free (entry->key);
+    g_object_unref (entry->pixbuf);
+    g_free (entry);
+}
+
+/* "path\nmtime (us)\nfile size\nsize", or NULL if the file can't be stat-ed */
+static gchar *
+get_key (const gchar    *filename,
+         gint            size,
+         GCancellable   *cancellable,
+         GError        **error)
+{
+    GFile *file;
+    GFileInfo *info;
+    guint64 mtime;
+    gchar *key;
+
+    file = g_file_new_for_path (filename);
+    info = g_file_query_info (file,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+            G_FILE_QUERY_INFO_NONE,
+            cancellable,
+            error);
+    g_object_unref (file);
+    if (!info)
+        return NULL;
+
+    mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+        * G_USEC_PER_SEC
+        + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    key = g_strdup_printf ("%s\n%" G_GUINT64_FORMAT "\n%" G_GOFFSET_FORMAT "\n%d",
+            filename, mtime, g_file_info_get_size (info), size);
+    g_object_unref (info);
+    return key;
+}
+
+/* Returns a new reference to the icon in @filename, scaled to fit in a square
+ * of @size (keeping aspect ratio), or as is if @size is -1 */
+GdkPixbuf *
+icon_file_load (const gchar    *filename,
+                gint            size,
+                GCancellable   *cancellable,
+                IconFileStats  *stats,
+                GError        **error)
+{
+    Entry *entry;
+    GdkPixbuf *pixbuf;
+    gchar *key;
+    gint64 start;
+
+    stats->cached = FALSE;
+    stats->decode_us = 0;
+
+    key = get_key (filename, size, cancellable, error);
+    if (!key)
+        return NULL;
+
+    G_LOCK (cache);
+    if (entries && (entry = g_hash_table_lookup (entries, key)))
+    {
+        g_queue_unlink (&entries_lru, &entry->link);
+        g_queue_push_head_link (&entries_lru, &entry->link);
+        pixbuf = g_object_ref (entry->pixbuf);
+        G_UNLOCK (cache);
+
+        g_free (key);
+        stats->cached = TRUE;
+        return pixbuf;
+    }
+    G_UNLOCK (cache);
+
+    /* decoding without the lock, if another thread does the same meanwhile the
+     * last one in wins */
+    start = g_get_monotonic_time ();
+    if (size > 0)
+        pixbuf = gdk_pixbuf_new_from_file_at_size (filename, size, size, error);
+    else
+        pixbuf = gdk_pixbuf_new_from_file (filename, error);
+    if (!pixbuf)
+    {
+        g_free (key);
+        return NULL;
+    }
+    stats->decode_us = g_get_monotonic_time () - start;
+
+    entry = g_new0 (Entry, 1);
+    entry->key = key;
+    entry->pixbuf = g_object_ref (pixbuf);
+    entry->link.data = entry;
+
+    G_LOCK (cache);
+    if (!entries)
+        entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                NULL, (GDestroyNotify) entry_free);
+    else
+    {
+        Entry *old = g_hash_table_lookup (entries, key);
+
+        if (old)
+        {
+            g_queue_unlink (&entries_lru, &old->link);
+            g_hash_table_remove (entries, key);
+        }
+        else if (entries_lru.length >= ICON_FILE_CACHE_MAX)
+        {
+            GList *l = g_queue_pop_tail_link (&entries_lru);
+
+            g_hash_table_remove (entries, ((Entry *) l->data)->key);
+        }
+    }
+    g_queue_push_head_link (&entries_lru, &entry->link);
+    g_hash_table_insert (entries, entry->key, entry);
+    G_UNLOCK (cache);
+
+    return pixbuf;
+}
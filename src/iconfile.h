@@ -0,0 +1,54 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * iconfile.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __ICON_FILE_H__
+#define __ICON_FILE_H__
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* Icons decoded from files, cached (process-wide, most recently used kept) by
+ * path, modification time, file size and requested size; So a modified file is
+ * decoded again, while switching between a few icons never is.
+ *
+ * Meant to be used from worker threads. */
+
+typedef struct
+{
+    /* whether it came from the cache, i.e. not decoded */
+    gboolean cached;
+    /* time spent decoding, in microseconds (0 when cached) */
+    gint64 decode_us;
+} IconFileStats;
+
+GdkPixbuf *         icon_file_load              (const gchar        *filename,
+                                                 gint                size,
+                                                 GCancellable       *cancellable,
+                                                 IconFileStats      *stats,
+                                                 GError            **error);
+
+G_END_DECLS
+
+#endif /* __ICON_FILE_H__ */
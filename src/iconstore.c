@@ -0,0 +1,465 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * iconstore.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include "iconstore.h"
+#include "pixmap.h"
+
+typedef struct
+{
+    guint64 hash;
+    gint width;
+    gint height;
+    gint n_channels;
+    /* only on lookup keys, compared against the pixel data of stored entries
+     * (which do not keep the pixbuf around) */
+    GdkPixbuf *pixbuf;
+    /* a(iiay), NULL on lookup keys */
+    GVariant *pixmap;
+    gsize bytes;
+    guint refs;
+} Entry;
+
+/* entries are both keys (hashed & compared by content) & values; by_pixmap is
+ * for icon_store_unref() */
+static GHashTable *entries = NULL;
+static GHashTable *by_pixmap = NULL;
+static guint total_refs = 0;
+static guint64 total_bytes = 0;
+/* pixbufs can be stored from any thread */
+G_LOCK_DEFINE_STATIC (store);
+
+/* bytes in the disk cache as of the last disk_prune(), plus what we wrote
+ * since (-1 before the first write); and writes since */
+static gint64 disk_total = -1;
+static guint disk_writes = 0;
+G_LOCK_DEFINE_STATIC (disk);
+
+#define MIX(h,w)    ((h) = ((h) ^ (w)) * G_GUINT64_CONSTANT (0x9e3779b97f4a7c15), \
+                     (h) ^= (h) >> 29)
+
+/* one multiply per 8 bytes of pixels, padding at the end of rows excluded */
+static guint64
+pixbuf_hash (GdkPixbuf *pixbuf)
+{
+    const guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+    gint width = gdk_pixbuf_get_width (pixbuf);
+    gint height = gdk_pixbuf_get_height (pixbuf);
+    gint n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    gsize len = (gsize) width * (gsize) n_channels;
+    guint64 h = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+    gint y;
+
+    MIX (h, ((guint64) width << 40) | ((guint64) height << 8) | (guint64) n_channels);
+    for (y = 0; y < height; ++y)
+    {
+        const guchar *row = pixels + (gsize) y * (gsize) rowstride;
+        guint64 w;
+        gsize i;
+
+        for (i = 0; i + sizeof (w) <= len; i += sizeof (w))
+        {
+            memcpy (&w, row + i, sizeof (w));
+            MIX (h, w);
+        }
+        if (i < len)
+        {
+            w = 0;
+            memcpy (&w, row + i, len - i);
+            MIX (h, w);
+        }
+    }
+    return h;
+}
+
+static guint
+entry_hash (gconstpointer key)
+{
+    const Entry *entry = key;
+
+    return (guint) (entry->hash ^ (entry->hash >> 32));
+}
+
+/* returns the "ay" of the pixel data of a stored entry */
+static GVariant *
+entry_get_data (const Entry *entry)
+{
+    GVariant *child, *data;
+
+    child = g_variant_get_child_value (entry->pixmap, 0);
+    data = g_variant_get_child_value (child, 2);
+    g_variant_unref (child);
+    return data;
+}
+
+static gboolean
+entry_equal (gconstpointer a, gconstpointer b)
+{
+    const Entry *e1 = a;
+    const Entry *e2 = b;
+    GVariant *d1, *d2;
+    const guchar *p1, *p2;
+    gsize l1, l2;
+    gboolean equal;
+
+    if (e1->hash != e2->hash || e1->width != e2->width
+            || e1->height != e2->height || e1->n_channels != e2->n_channels)
+        return FALSE;
+    if (e1->pixmap == e2->pixmap)
+        return TRUE;
+
+    /* a lookup key against a stored entry */
+    if (!e1->pixmap || !e2->pixmap)
+    {
+        const Entry *key = (e1->pixmap) ? e2 : e1;
+
+        d1 = entry_get_data ((e1->pixmap) ? e1 : e2);
+        p1 = g_variant_get_fixed_array (d1, &l1, sizeof (guchar));
+        equal = pixmap_data_equals_pixbuf (p1, l1, key->pixbuf);
+        g_variant_unref (d1);
+        return equal;
+    }
+
+    d1 = entry_get_data (e1);
+    d2 = entry_get_data (e2);
+    p1 = g_variant_get_fixed_array (d1, &l1, sizeof (guchar));
+    p2 = g_variant_get_fixed_array (d2, &l2, sizeof (guchar));
+    equal = l1 == l2 && !memcmp (p1, p2, l1);
+    g_variant_unref (d1);
+    g_variant_unref (d2);
+    return equal;
+}
+
+static void
+entry_free (Entry *entry)
+{
+    g_variant_unref (entry->pixmap);
+    g_slice_free (Entry, entry);
+}
+
+static gchar *
+disk_path (const Entry *key)
+{
+    gchar name[64];
+
+    g_snprintf (name, sizeof (name), "%016" G_GINT64_MODIFIER "x-%dx%d-%d",
+            key->hash, key->width, key->height, key->n_channels);
+    return g_build_filename (g_get_user_cache_dir (), ICON_STORE_DIR, name, NULL);
+}
+
+/* returns a floating "ay" mapped from @path, or NULL. Files are named after
+ * a (non-cryptographic) hash only, so the content is checked against @pixbuf
+ * before being trusted */
+static GVariant *
+disk_load (const gchar *path, gsize len, GdkPixbuf *pixbuf)
+{
+    GMappedFile *file;
+    GBytes *bytes;
+    GVariant *data;
+    struct stat st;
+    gint fd;
+
+    fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+    /* accessing a mapping beyond the end of the file is a SIGBUS */
+    if (fstat (fd, &st) < 0 || !S_ISREG (st.st_mode) || st.st_size < 0
+            || (gsize) st.st_size != len)
+    {
+        close (fd);
+        return NULL;
+    }
+    file = g_mapped_file_new_from_fd (fd, FALSE, NULL);
+    close (fd);
+    if (!file)
+        return NULL;
+    if (g_mapped_file_get_length (file) != len
+            || !pixmap_data_equals_pixbuf ((const guchar *) g_mapped_file_get_contents (file),
+                len, pixbuf))
+    {
+        g_mapped_file_unref (file);
+        return NULL;
+    }
+    /* most recently used, for disk_prune() */
+    g_utime (path, NULL);
+
+    /* the variant keeps the mapping alive, no copy involved */
+    bytes = g_mapped_file_get_bytes (file);
+    g_mapped_file_unref (file);
+    data = g_variant_new_from_bytes (G_VARIANT_TYPE ("ay"), bytes, TRUE);
+    g_bytes_unref (bytes);
+    return data;
+}
+
+typedef struct
+{
+    gchar *name;
+    time_t mtime;
+    guint64 size;
+} DiskFile;
+
+static gint
+disk_file_cmp (gconstpointer a, gconstpointer b)
+{
+    const DiskFile *f1 = a;
+    const DiskFile *f2 = b;
+
+    return (f1->mtime > f2->mtime) - (f1->mtime < f2->mtime);
+}
+
+/* removes the least recently used files of @dir, until it holds no more than
+ * ICON_STORE_DISK_MAX bytes; Returns how many it holds */
+static guint64
+disk_prune (const gchar *dir)
+{
+    GArray *files;
+    GDir *gdir;
+    const gchar *name;
+    guint64 total = 0;
+    guint i;
+
+    gdir = g_dir_open (dir, 0, NULL);
+    if (!gdir)
+        return 0;
+
+    files = g_array_new (FALSE, FALSE, sizeof (DiskFile));
+    while ((name = g_dir_read_name (gdir)))
+    {
+        gchar *path = g_build_filename (dir, name, NULL);
+        GStatBuf st;
+
+        if (g_stat (path, &st) == 0 && S_ISREG (st.st_mode))
+        {
+            DiskFile file = { g_strdup (name), st.st_mtime, (guint64) st.st_size };
+
+            g_array_append_val (files, file);
+            total += file.size;
+        }
+        g_free (path);
+    }
+    g_dir_close (gdir);
+
+    if (total > ICON_STORE_DISK_MAX)
+    {
+        g_array_sort (files, disk_file_cmp);
+        for (i = 0; i < files->len && total > ICON_STORE_DISK_MAX; ++i)
+        {
+            DiskFile *file = &g_array_index (files, DiskFile, i);
+            gchar *path = g_build_filename (dir, file->name, NULL);
+
+            /* another process might have removed it already */
+            if (g_unlink (path) == 0 || errno == ENOENT)
+                total -= file->size;
+            g_free (path);
+        }
+    }
+
+    for (i = 0; i < files->len; ++i)
+        g_free (g_array_index (files, DiskFile, i).name);
+    g_array_free (files, TRUE);
+    return total;
+}
+
+/* written to a temporary file then renamed, so other processes never see it
+ * partially written */
+static gboolean
+disk_save (const gchar *path, GVariant *data)
+{
+    gchar *dir;
+    gboolean ret, prune = FALSE;
+
+    dir = g_path_get_dirname (path);
+    ret = g_mkdir_with_parents (dir, 0700) == 0
+        && g_file_set_contents (path, g_variant_get_data (data),
+                (gssize) g_variant_get_size (data), NULL);
+    /* not enumerating the directory on each write */
+    if (ret)
+    {
+        G_LOCK (disk);
+        if (disk_total >= 0)
+            disk_total += (gint64) g_variant_get_size (data);
+        prune = disk_total < 0 || disk_total > ICON_STORE_DISK_MAX
+            || ++disk_writes >= ICON_STORE_DISK_PRUNE;
+        if (prune)
+            disk_writes = 0;
+        G_UNLOCK (disk);
+    }
+    if (prune)
+    {
+        guint64 total = disk_prune (dir);
+
+        G_LOCK (disk);
+        disk_total = (gint64) total;
+        G_UNLOCK (disk);
+    }
+    g_free (dir);
+    return ret;
+}
+
+/* Returns the a(iiay) for @pixbuf, converting it only if not already in the
+ * store (nor, if @disk_cache, on disk). The caller owns a reference on the
+ * stored icon, to be released with icon_store_unref() (and not
+ * g_variant_unref()) */
+GVariant *
+icon_store_ref (GdkPixbuf *pixbuf, gboolean disk_cache, IconStoreStats *stats)
+{
+    Entry key, *entry;
+    GVariant *data = NULL, *child;
+    gchar *path = NULL;
+    gint64 start;
+
+    g_return_val_if_fail (gdk_pixbuf_get_bits_per_sample (pixbuf) == 8, NULL);
+
+    key.hash = pixbuf_hash (pixbuf);
+    key.width = gdk_pixbuf_get_width (pixbuf);
+    key.height = gdk_pixbuf_get_height (pixbuf);
+    key.n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    key.pixbuf = pixbuf;
+    key.pixmap = NULL;
+
+    G_LOCK (store);
+    if (G_UNLIKELY (!entries))
+    {
+        entries = g_hash_table_new (entry_hash, entry_equal);
+        by_pixmap = g_hash_table_new (NULL, NULL);
+    }
+
+    entry = g_hash_table_lookup (entries, &key);
+    if (entry)
+    {
+        ++entry->refs;
+        ++total_refs;
+        G_UNLOCK (store);
+
+        stats->hit = TRUE;
+        stats->mapped = FALSE;
+        stats->written = FALSE;
+        stats->bytes = entry->bytes;
+        stats->convert_us = 0;
+        return entry->pixmap;
+    }
+    G_UNLOCK (store);
+
+    stats->hit = FALSE;
+    stats->mapped = FALSE;
+    stats->written = FALSE;
+    stats->convert_us = 0;
+    if (disk_cache)
+    {
+        path = disk_path (&key);
+        data = disk_load (path,
+                (gsize) key.width * (gsize) key.height * PIXMAP_BPP, pixbuf);
+        stats->mapped = data != NULL;
+    }
+
+    /* converting without the lock, another thread might do the same, in which
+     * case the first one in wins */
+    if (!data)
+    {
+        start = g_get_monotonic_time ();
+        data = pixmap_data_from_pixbuf (pixbuf);
+        stats->convert_us = g_get_monotonic_time () - start;
+        if (path && g_variant_get_size (data)
+                == (gsize) key.width * (gsize) key.height * PIXMAP_BPP)
+            stats->written = disk_save (path, data);
+    }
+    g_free (path);
+    child = g_variant_new ("(ii@ay)", key.width, key.height, data);
+
+    entry = g_slice_new (Entry);
+    *entry = key;
+    entry->pixbuf = NULL;
+    entry->pixmap = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("(iiay)"),
+                &child, 1));
+    entry->bytes = g_variant_get_size (data);
+    entry->refs = 1;
+    stats->bytes = entry->bytes;
+
+    G_LOCK (store);
+    {
+        Entry *other = g_hash_table_lookup (entries, &key);
+
+        if (G_UNLIKELY (other))
+        {
+            ++other->refs;
+            ++total_refs;
+            G_UNLOCK (store);
+            entry_free (entry);
+            return other->pixmap;
+        }
+    }
+    g_hash_table_add (entries, entry);
+    g_hash_table_insert (by_pixmap, entry->pixmap, entry);
+    ++total_refs;
+    total_bytes += entry->bytes;
+    G_UNLOCK (store);
+
+    return entry->pixmap;
+}
+
+void
+icon_store_unref (GVariant *pixmap)
+{
+    Entry *entry;
+
+    G_LOCK (store);
+    entry = (by_pixmap) ? g_hash_table_lookup (by_pixmap, pixmap) : NULL;
+    if (G_UNLIKELY (!entry))
+    {
+        G_UNLOCK (store);
+        g_return_if_reached ();
+    }
+
+    --total_refs;
+    if (--entry->refs > 0)
+    {
+        G_UNLOCK (store);
+        return;
+    }
+    g_hash_table_remove (entries, entry);
+    g_hash_table_remove (by_pixmap, pixmap);
+    total_bytes -= entry->bytes;
+    G_UNLOCK (store);
+
+    entry_free (entry);
+}
+
+/* icons in the store, references on them (i.e. slots sharing them), and bytes
+ * of pixel data actually held */
+void
+icon_store_get_totals (guint *entries_nb, guint *refs, guint64 *bytes)
+{
+    G_LOCK (store);
+    *entries_nb = (entries) ? g_hash_table_size (entries) : 0;
+    *refs = total_refs;
+    *bytes = total_bytes;
+    G_UNLOCK (store);
+}
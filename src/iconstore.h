@@ -0,0 +1,73 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * iconstore.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __ICON_STORE_H__
+#define __ICON_STORE_H__
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* Process-wide store of icons in wire format, content-addressed: pixbufs with
+ * the same pixels (whichever GdkPixbuf they are, and whichever slot/item they
+ * are set on) share a single a(iiay), converted only once, and kept as long
+ * as anything references it.
+ *
+ * Optionally, icons are also cached on disk (under ICON_STORE_DIR in the
+ * user's cache dir), one file of pixel data in wire format per icon, named
+ * after its content hash & size. Those are mapped (read-only) instead of
+ * converting, once checked to match the pixbuf, so processes using the same
+ * icons share the memory, and don't convert them again on each start. Least
+ * recently used files are removed past ICON_STORE_DISK_MAX bytes; That's
+ * checked on the first write, then only once what we wrote since would go
+ * past it, or every ICON_STORE_DISK_PRUNE writes (for other processes'). */
+
+#define ICON_STORE_DIR          "statusnotifier/pixmaps"
+#define ICON_STORE_DISK_MAX     (32 * 1024 * 1024)
+#define ICON_STORE_DISK_PRUNE   256
+
+typedef struct
+{
+    /* whether it was found in the store, i.e. not converted */
+    gboolean hit;
+    /* whether it was mapped from the disk cache, i.e. not converted either;
+     * and whether it was written to it */
+    gboolean mapped;
+    gboolean written;
+    /* bytes of pixel data (of the stored icon) */
+    gsize bytes;
+    /* time spent converting, in microseconds (0 on hit) */
+    gint64 convert_us;
+} IconStoreStats;
+
+GVariant *          icon_store_ref              (GdkPixbuf          *pixbuf,
+                                                 gboolean            disk_cache,
+                                                 IconStoreStats     *stats);
+void                icon_store_unref            (GVariant           *pixmap);
+void                icon_store_get_totals       (guint              *entries_nb,
+                                                 guint              *refs,
+                                                 guint64            *bytes);
+
+G_END_DECLS
+
+#endif /* __ICON_STORE_H__ */
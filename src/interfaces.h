@@ -33,6 +33,11 @@ G_BEGIN_DECLS
 #define ITEM_OBJECT         "/StatusNotifierItem"
 #define ITEM_INTERFACE      "org.kde.StatusNotifierItem"
 
+#define DEBUG_INTERFACE     "org.statusnotifier.Debug"
+#define DEBUG_INTERFACE_ENV "STATUS_NOTIFIER_DEBUG_INTERFACE"
+
+#define EXTENSION_INTERFACE "org.statusnotifier.Extension1"
+
 static const gchar watcher_xml[] =
     "<node>"
     "   <interface name='org.kde.StatusNotifierWatcher'>"
@@ -91,6 +96,42 @@ static const gchar item_xml[] =
     "   </interface>"
     "</node>";
 
+/* opt-in (via DEBUG_INTERFACE_ENV), exported next to the item, on its object
+ * path */
+static const gchar debug_xml[] =
+    "<node>"
+    "   <interface name='org.statusnotifier.Debug'>"
+    "       <method name='GetCounters'>"
+    "           <arg name='counters' type='a{st}' direction='out' />"
+    "       </method>"
+    "       <method name='GetGlobalCounters'>"
+    "           <arg name='counters' type='a{st}' direction='out' />"
+    "       </method>"
+    "   </interface>"
+    "</node>";
+
+/* for cooperating hosts, exported next to the item, on its object path */
+static const gchar extension_xml[] =
+    "<node>"
+    "   <interface name='org.statusnotifier.Extension1'>"
+    "       <method name='SetIconSizes'>"
+    "           <arg name='sizes' type='ai' direction='in' />"
+    "       </method>"
+    "       <method name='GetIconDelta'>"
+    "           <arg name='property' type='s' direction='in' />"
+    "           <arg name='since' type='u' direction='in' />"
+    "           <arg name='revision' type='u' direction='out' />"
+    "           <arg name='full' type='b' direction='out' />"
+    "           <arg name='sizes' type='a(iia(iiiiay))' direction='out' />"
+    "       </method>"
+    "       <method name='GetIconPixmapFd'>"
+    "           <arg name='property' type='s' direction='in' />"
+    "           <arg name='pixels' type='h' direction='out' />"
+    "           <arg name='sizes' type='a(iit)' direction='out' />"
+    "       </method>"
+    "   </interface>"
+    "</node>";
+
 G_END_DECLS
 
 #endif /* __INTERFACES_H__ */
@@ -0,0 +1,240 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * mkpixmaps.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+/* Build-time icon compiler, installed as statusnotifier-mkpixmaps: converts
+ * images (anything gdk-pixbuf loads, e.g. PNG or SVG) at the given sizes into
+ * the a(iiay) sent over DBus, serialized so
+ * status_notifier_item_set_from_resource() can publish them as is.
+ *
+ * For each FILE, OUTDIR/NAME.pixmap is written (NAME being the file's basename
+ * without extension) holding all sizes, as well as OUTDIR/pixmaps.gresource.xml
+ * listing them under PREFIX, to be fed to glib-compile-resources (with
+ * --sourcedir=OUTDIR). Blobs are always little-endian; the library swaps them
+ * on big-endian systems. Usage & blob format are documented in the reference
+ * manual (docs/reference/statusnotifier-mkpixmaps.xml). */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "pixmap.h"
+
+#define XML_NAME        "pixmaps.gresource.xml"
+
+static gchar *opt_sizes = NULL;
+static gchar *opt_prefix = NULL;
+static gchar *opt_output = NULL;
+
+static gboolean
+parse_sizes (const gchar *s, GArray *sizes, GError **error)
+{
+    gchar **list, **l;
+
+    list = g_strsplit (s, ",", -1);
+    for (l = list; *l; ++l)
+    {
+        gchar *e;
+        gint64 size;
+        gint val;
+
+        size = g_ascii_strtoll (*l, &e, 10);
+        if (e == *l || *e != '\0' || size <= 0 || size > 1024)
+        {
+            g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                    "Invalid size: %s", *l);
+            g_strfreev (list);
+            return FALSE;
+        }
+        val = (gint) size;
+        g_array_append_val (sizes, val);
+    }
+    g_strfreev (list);
+    return TRUE;
+}
+
+/* returns the (floating) a(iiay) with @file at all @sizes */
+static GVariant *
+compile (const gchar *file, GArray *sizes, GError **error)
+{
+    GVariantBuilder builder;
+    guint i;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+    for (i = 0; i < sizes->len; ++i)
+    {
+        GdkPixbuf *pixbuf;
+        gint size = g_array_index (sizes, gint, i);
+
+        pixbuf = gdk_pixbuf_new_from_file_at_size (file, size, size, error);
+        if (!pixbuf)
+        {
+            g_variant_builder_clear (&builder);
+            return NULL;
+        }
+        g_variant_builder_add (&builder, "(ii@ay)",
+                gdk_pixbuf_get_width (pixbuf),
+                gdk_pixbuf_get_height (pixbuf),
+                pixmap_data_from_pixbuf (pixbuf));
+        g_object_unref (pixbuf);
+    }
+    return g_variant_builder_end (&builder);
+}
+
+static gboolean
+write_pixmap (const gchar *file, const gchar *name, GArray *sizes,
+              GError **error)
+{
+    GVariant *pixmaps;
+    gchar *basename, *path;
+    gboolean ret;
+
+    pixmaps = compile (file, sizes, error);
+    if (!pixmaps)
+        return FALSE;
+    g_variant_ref_sink (pixmaps);
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    {
+        GVariant *swapped = g_variant_byteswap (pixmaps);
+
+        g_variant_unref (pixmaps);
+        pixmaps = swapped;
+    }
+#endif
+
+    basename = g_strdup_printf ("%s.pixmap", name);
+    path = g_build_filename (opt_output, basename, NULL);
+    g_free (basename);
+    ret = g_file_set_contents (path,
+            g_variant_get_data (pixmaps),
+            (gssize) g_variant_get_size (pixmaps),
+            error);
+    g_free (path);
+    g_variant_unref (pixmaps);
+    return ret;
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    GError *err = NULL;
+    GOptionContext *context;
+    GOptionEntry entries[] =
+    {
+        { "sizes",      's',    0, G_OPTION_ARG_STRING, &opt_sizes,
+            "Sizes to include (comma-separated, default: 16,22,24,32,48)", "LIST" },
+        { "prefix",     'p',    0, G_OPTION_ARG_STRING, &opt_prefix,
+            "Resource path prefix (default: /)", "PREFIX" },
+        { "output",     'o',    0, G_OPTION_ARG_FILENAME, &opt_output,
+            "Directory to write pixmaps & " XML_NAME " to (default: .)", "OUTDIR" },
+        { NULL }
+    };
+    GArray *sizes;
+    GHashTable *names;
+    GString *xml;
+    gchar *escaped;
+    gchar *path;
+    gint i;
+
+    context = g_option_context_new ("FILE... - compile icons into pixmaps");
+    g_option_context_set_summary (context,
+            "Writes OUTDIR/NAME.pixmap for each FILE (NAME being its basename\n"
+            "without extension, so those must all differ), and OUTDIR/" XML_NAME "\n"
+            "to compile them into resources with glib-compile-resources.");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &err))
+    {
+        g_printerr ("%s\n", err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+    g_option_context_free (context);
+    if (argc < 2)
+    {
+        g_printerr ("No files specified\n");
+        return 1;
+    }
+    if (!opt_output)
+        opt_output = g_strdup (".");
+
+    sizes = g_array_new (FALSE, FALSE, sizeof (gint));
+    if (!parse_sizes ((opt_sizes) ? opt_sizes : "16,22,24,32,48", sizes, &err))
+    {
+        g_printerr ("%s\n", err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+
+    xml = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<gresources>\n");
+    escaped = g_markup_printf_escaped ("  <gresource prefix=\"%s\">\n",
+            (opt_prefix) ? opt_prefix : "/");
+    g_string_append (xml, escaped);
+    g_free (escaped);
+    /* name -> file, as a name is also the file written */
+    names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (i = 1; i < argc; ++i)
+    {
+        const gchar *other;
+        gchar *name, *dot;
+
+        name = g_path_get_basename (argv[i]);
+        dot = strrchr (name, '.');
+        if (dot && dot != name)
+            *dot = '\0';
+
+        other = g_hash_table_lookup (names, name);
+        if (other)
+        {
+            g_printerr ("%s: Same name (%s) as %s\n", argv[i], name, other);
+            g_free (name);
+            return 1;
+        }
+        if (!write_pixmap (argv[i], name, sizes, &err))
+        {
+            g_printerr ("%s: %s\n", argv[i], err->message);
+            g_clear_error (&err);
+            g_free (name);
+            return 1;
+        }
+        escaped = g_markup_printf_escaped ("    <file>%s.pixmap</file>\n", name);
+        g_string_append (xml, escaped);
+        g_free (escaped);
+        g_hash_table_insert (names, name, argv[i]);
+    }
+    g_string_append (xml, "  </gresource>\n</gresources>\n");
+    g_hash_table_unref (names);
+
+    path = g_build_filename (opt_output, XML_NAME, NULL);
+    if (!g_file_set_contents (path, xml->str, (gssize) xml->len, &err))
+    {
+        g_printerr ("%s: %s\n", path, err->message);
+        g_clear_error (&err);
+        return 1;
+    }
+
+    g_free (path);
+    g_string_free (xml, TRUE);
+    g_array_free (sizes, TRUE);
+    return 0;
+}
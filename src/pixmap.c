@@ -0,0 +1,227 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * pixmap.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#if USE_GDK
+#include <gdk/gdk.h>
+#endif
+#include "pixmap.h"
+
+/* same as what GDK does when painting a pixbuf onto a cairo surface, so we
+ * produce the exact same bytes with or without it */
+#define MULT(c,a,t)     ((t) = (guint) (c) * (a) + 0x80, (guchar) ((((t) >> 8) + (t)) >> 8))
+
+#if USE_GDK
+
+/* returns a floating GVariant of type "ay" with the pixel data of @pixbuf in
+ * wire format */
+GVariant *
+pixmap_data_from_pixbuf (GdkPixbuf *pixbuf)
+{
+    cairo_surface_t *surface;
+    cairo_t *cr;
+    gint width, height, stride;
+    guint *data;
+
+    width = gdk_pixbuf_get_width (pixbuf);
+    height = gdk_pixbuf_get_height (pixbuf);
+
+    surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+    cr = cairo_create (surface);
+    gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+    cairo_paint (cr);
+    cairo_destroy (cr);
+
+    stride = cairo_image_surface_get_stride (surface);
+    cairo_surface_flush (surface);
+    data = (guint *) cairo_image_surface_get_data (surface);
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    guint i, max;
+
+    max = (guint) (stride * height) / sizeof (guint);
+    for (i = 0; i < max; ++i)
+        data[i] = GUINT_TO_BE (data[i]);
+#endif
+
+    return g_variant_new_from_data (G_VARIANT_TYPE ("ay"),
+            data,
+            (gsize) (stride * height),
+            TRUE,
+            (GDestroyNotify) cairo_surface_destroy,
+            surface);
+}
+
+#else /* USE_GDK */
+
+/* returns a floating GVariant of type "ay" with the pixel data of @pixbuf in
+ * wire format */
+GVariant *
+pixmap_data_from_pixbuf (GdkPixbuf *pixbuf)
+{
+    const guchar *pixels;
+    guchar *data, *d;
+    gint width, height, rowstride, n_channels;
+    gboolean has_alpha;
+    gsize len;
+    gint x, y;
+
+    width = gdk_pixbuf_get_width (pixbuf);
+    height = gdk_pixbuf_get_height (pixbuf);
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+    len = (gsize) width * (gsize) height * PIXMAP_BPP;
+    d = data = g_malloc (len);
+
+    for (y = 0; y < height; ++y)
+    {
+        const guchar *p = pixels + y * rowstride;
+
+        if (has_alpha)
+            for (x = 0; x < width; ++x, p += n_channels, d += PIXMAP_BPP)
+            {
+                guint t;
+
+                d[0] = p[3];
+                d[1] = MULT (p[0], p[3], t);
+                d[2] = MULT (p[1], p[3], t);
+                d[3] = MULT (p[2], p[3], t);
+            }
+        else
+            for (x = 0; x < width; ++x, p += n_channels, d += PIXMAP_BPP)
+            {
+                d[0] = 0xff;
+                d[1] = p[0];
+                d[2] = p[1];
+                d[3] = p[2];
+            }
+    }
+
+    return g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data, len,
+            TRUE, g_free, data);
+}
+
+#endif /* USE_GDK */
+
+/* whether @data (pixel data in wire format, @len bytes) is what
+ * pixmap_data_from_pixbuf() would return for @pixbuf, premultiplying on the
+ * fly instead of converting it */
+gboolean
+pixmap_data_equals_pixbuf (const guchar *data, gsize len, GdkPixbuf *pixbuf)
+{
+    const guchar *pixels;
+    gint width, height, rowstride, n_channels;
+    gboolean has_alpha;
+    gint x, y;
+
+    width = gdk_pixbuf_get_width (pixbuf);
+    height = gdk_pixbuf_get_height (pixbuf);
+    if (len != (gsize) width * (gsize) height * PIXMAP_BPP)
+        return FALSE;
+
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+    has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+    for (y = 0; y < height; ++y)
+    {
+        const guchar *p = pixels + (gsize) y * (gsize) rowstride;
+
+        if (has_alpha)
+            for (x = 0; x < width; ++x, p += n_channels, data += PIXMAP_BPP)
+            {
+                guint t;
+
+                if (data[0] != p[3]
+                        || data[1] != MULT (p[0], p[3], t)
+                        || data[2] != MULT (p[1], p[3], t)
+                        || data[3] != MULT (p[2], p[3], t))
+                    return FALSE;
+            }
+        else
+            for (x = 0; x < width; ++x, p += n_channels, data += PIXMAP_BPP)
+                if (data[0] != 0xff || data[1] != p[0]
+                        || data[2] != p[1] || data[3] != p[2])
+                    return FALSE;
+    }
+    return TRUE;
+}
+
+/* returns a new GdkPixbuf of the first pixmap of @pixmaps (of type "a(iiay)",
+ * in wire format), or NULL */
+GdkPixbuf *
+pixmap_to_pixbuf (GVariant *pixmaps)
+{
+    GdkPixbuf *pixbuf;
+    GVariant *child, *data;
+    const guchar *p;
+    guchar *pixels;
+    gint width, height, rowstride;
+    gsize len;
+    gint x, y;
+
+    if (g_variant_n_children (pixmaps) == 0)
+        return NULL;
+
+    child = g_variant_get_child_value (pixmaps, 0);
+    g_variant_get (child, "(ii@ay)", &width, &height, &data);
+    p = g_variant_get_fixed_array (data, &len, sizeof (guchar));
+    if (width <= 0 || height <= 0
+            || len < (gsize) width * (gsize) height * PIXMAP_BPP)
+    {
+        g_variant_unref (data);
+        g_variant_unref (child);
+        return NULL;
+    }
+
+    pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+    pixels = gdk_pixbuf_get_pixels (pixbuf);
+    rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+    for (y = 0; y < height; ++y)
+    {
+        guchar *d = pixels + y * rowstride;
+
+        for (x = 0; x < width; ++x, p += PIXMAP_BPP, d += 4)
+        {
+            guint a = p[0];
+
+            d[3] = (guchar) a;
+            if (a == 0)
+                d[0] = d[1] = d[2] = 0;
+            else
+            {
+                d[0] = (guchar) MIN (255, (p[1] * 255 + a / 2) / a);
+                d[1] = (guchar) MIN (255, (p[2] * 255 + a / 2) / a);
+                d[2] = (guchar) MIN (255, (p[3] * 255 + a / 2) / a);
+            }
+        }
+    }
+
+    g_variant_unref (data);
+    g_variant_unref (child);
+    return pixbuf;
+}
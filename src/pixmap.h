@@ -0,0 +1,43 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * pixmap.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __PIXMAP_H__
+#define __PIXMAP_H__
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+/* Pixmaps on the wire are ARGB32 (premultiplied, as cairo does) in network
+ * byte order, i.e. each pixel is 4 bytes: A, R, G, B */
+#define PIXMAP_BPP          4
+
+GVariant *          pixmap_data_from_pixbuf     (GdkPixbuf          *pixbuf);
+gboolean            pixmap_data_equals_pixbuf   (const guchar       *data,
+                                                 gsize               len,
+                                                 GdkPixbuf          *pixbuf);
+GdkPixbuf *         pixmap_to_pixbuf            (GVariant           *pixmaps);
+
+G_END_DECLS
+
+#endif /* __PIXMAP_H__ */
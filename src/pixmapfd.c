@@ -0,0 +1,209 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * pixmapfd.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#if USE_MEMFD
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <string.h>
+#include <gio/gio.h>
+#include "pixmapfd.h"
+#include "pixmap.h"
+
+#define _UNUSED_                __attribute__ ((unused))
+
+#if USE_MEMFD
+
+#define PIXMAP_FD_CACHE_MAX     32
+
+typedef struct
+{
+    GVariant *pixmap;
+    gint fd;
+    GVariant *layout;
+    GList link;
+} PixmapFd;
+
+static GHashTable *fds = NULL;
+static GQueue fds_lru = G_QUEUE_INIT;
+
+static void
+pixmap_fd_free (PixmapFd *pfd)
+{
+    close (pfd->fd);
+    g_variant_unref (pfd->pixmap);
+    g_variant_unref (pfd->layout);
+    g_slice_free (PixmapFd, pfd);
+}
+
+static void
+set_errno_error (GError **error, const gchar *what)
+{
+    gint errsv = errno;
+
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+            "%s failed: %s", what, g_strerror (errsv));
+}
+
+/* writes the pixels of @pixmap into new sealed memfd; returns it, or -1 */
+static gint
+pixmap_fd_new (GVariant *pixmap, GVariant **layout, gsize *len, GError **error)
+{
+    GVariantBuilder builder;
+    GVariantIter iter;
+    GVariant *pixels;
+    guchar *data = NULL;
+    gsize offset;
+    gint width, height;
+    gint fd;
+
+    /* sizes with the wrong length of pixels are skipped */
+    *len = 0;
+    g_variant_iter_init (&iter, pixmap);
+    while (g_variant_iter_next (&iter, "(ii@ay)", &width, &height, &pixels))
+    {
+        if (width > 0 && height > 0 && g_variant_get_size (pixels)
+                == (gsize) width * (gsize) height * PIXMAP_BPP)
+            *len += g_variant_get_size (pixels);
+        g_variant_unref (pixels);
+    }
+
+    fd = memfd_create ("statusnotifier-pixmap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+    {
+        set_errno_error (error, "memfd_create");
+        return -1;
+    }
+    if (ftruncate (fd, (off_t) *len) < 0)
+    {
+        set_errno_error (error, "ftruncate");
+        close (fd);
+        return -1;
+    }
+    if (*len > 0)
+    {
+        data = mmap (NULL, *len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            set_errno_error (error, "mmap");
+            close (fd);
+            return -1;
+        }
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iit)"));
+    offset = 0;
+    g_variant_iter_init (&iter, pixmap);
+    while (g_variant_iter_next (&iter, "(ii@ay)", &width, &height, &pixels))
+    {
+        gsize size = g_variant_get_size (pixels);
+
+        if (width > 0 && height > 0
+                && size == (gsize) width * (gsize) height * PIXMAP_BPP)
+        {
+            memcpy (data + offset, g_variant_get_data (pixels), size);
+            g_variant_builder_add (&builder, "(iit)", width, height,
+                    (guint64) offset);
+            offset += size;
+        }
+        g_variant_unref (pixels);
+    }
+    /* (a writable mapping would prevent sealing against writes) */
+    if (data)
+        munmap (data, *len);
+
+    if (fcntl (fd, F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    {
+        set_errno_error (error, "Sealing memfd");
+        g_variant_builder_clear (&builder);
+        close (fd);
+        return -1;
+    }
+
+    *layout = g_variant_ref_sink (g_variant_builder_end (&builder));
+    return fd;
+}
+
+#endif /* USE_MEMFD */
+
+gint
+pixmap_fd_get (GVariant        *pixmap _UNUSED_,
+               GVariant       **layout,
+               PixmapFdStats   *stats,
+               GError         **error)
+{
+#if USE_MEMFD
+    PixmapFd *pfd;
+    gsize len;
+    gint fd;
+
+    stats->cached = FALSE;
+    stats->bytes = 0;
+
+    if (fds && (pfd = g_hash_table_lookup (fds, pixmap)))
+    {
+        stats->cached = TRUE;
+        g_queue_unlink (&fds_lru, &pfd->link);
+        g_queue_push_head_link (&fds_lru, &pfd->link);
+        *layout = g_variant_ref (pfd->layout);
+        return pfd->fd;
+    }
+
+    fd = pixmap_fd_new (pixmap, layout, &len, error);
+    if (fd < 0)
+        return -1;
+    stats->bytes = len;
+
+    if (!fds)
+        fds = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                NULL, (GDestroyNotify) pixmap_fd_free);
+    if (fds_lru.length >= PIXMAP_FD_CACHE_MAX)
+    {
+        GList *l = g_queue_pop_tail_link (&fds_lru);
+
+        g_hash_table_remove (fds, ((PixmapFd *) l->data)->pixmap);
+    }
+
+    pfd = g_slice_new (PixmapFd);
+    pfd->pixmap = g_variant_ref (pixmap);
+    pfd->fd = fd;
+    pfd->layout = g_variant_ref (*layout);
+    pfd->link.data = pfd;
+    pfd->link.prev = pfd->link.next = NULL;
+    g_queue_push_head_link (&fds_lru, &pfd->link);
+    g_hash_table_insert (fds, pixmap, pfd);
+
+    return fd;
+#else
+    stats->cached = FALSE;
+    stats->bytes = 0;
+    *layout = NULL;
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+            "Built without memfd support");
+    return -1;
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * pixmapfd.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __PIXMAPFD_H__
+#define __PIXMAPFD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Pixmaps (a(iiay)) exported as sealed memfds, for hosts on the same machine
+ * to map the pixels instead of getting them in DBus messages (see
+ * GetIconPixmapFd). The memfd holds the pixels of all sizes one after the
+ * other, in wire format, and can't be modified or resized.
+ *
+ * They're cached by pixmap (referenced, as pixmaps are immutable), so each is
+ * only written once. Main thread only, as the cache isn't locked. */
+
+typedef struct
+{
+    /* whether the memfd came from the cache */
+    gboolean cached;
+    /* bytes of pixel data written */
+    gsize bytes;
+} PixmapFdStats;
+
+/* returns the memfd (owned by the cache, only valid until the next call) for
+ * @pixmap, with @layout set to a new reference to its a(iit): width, height
+ * and offset of each size; -1 on error (or if not supported) */
+gint                pixmap_fd_get               (GVariant           *pixmap,
+                                                 GVariant          **layout,
+                                                 PixmapFdStats      *stats,
+                                                 GError            **error);
+
+G_END_DECLS
+
+#endif /* __PIXMAPFD_H__ */
@@ -0,0 +1,1157 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * render.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <math.h>
+#include "render.h"
+#include "pixmap.h"
+
+/* built-in 5x7 bitmap font: digits, (uppercase) letters and a few symbols;
+ * each row is 5 bits, the leftmost pixel being bit 4 */
+#define FONT_WIDTH          5
+#define FONT_HEIGHT         7
+
+static const gchar font_symbols[] = " !#%+-./:?";
+
+#define NB_GLYPHS           (10 + 26 + sizeof (font_symbols) - 1)
+/* '?', used for anything not in the font */
+#define GLYPH_UNKNOWN       (NB_GLYPHS - 1)
+
+static const guint8 font[NB_GLYPHS][FONT_HEIGHT] = {
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, /* 0 */
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, /* 1 */
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, /* 2 */
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, /* 3 */
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, /* 4 */
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, /* 5 */
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, /* 6 */
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, /* 7 */
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, /* 8 */
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, /* 9 */
+    { 0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11 }, /* A */
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e }, /* B */
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e }, /* C */
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c }, /* D */
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f }, /* E */
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 }, /* F */
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f }, /* G */
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 }, /* H */
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e }, /* I */
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c }, /* J */
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, /* K */
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f }, /* L */
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 }, /* M */
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, /* N */
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, /* O */
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 }, /* P */
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d }, /* Q */
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 }, /* R */
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e }, /* S */
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, /* T */
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e }, /* U */
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 }, /* V */
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a }, /* W */
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 }, /* X */
+    { 0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04 }, /* Y */
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f }, /* Z */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, /*   */
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, /* ! */
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a }, /* # */
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, /* % */
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 }, /* + */
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 }, /* - */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c }, /* . */
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, /* / */
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, /* : */
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }  /* ? */
+};
+
+/* smallest glyph height used; Text that doesn't fit is clipped */
+#define MIN_GLYPH_HEIGHT    5
+
+/* The font rasterized (with a box filter, so scaled glyphs are antialiased) at
+ * a given glyph height, as 8-bit coverage */
+typedef struct
+{
+    gint width;
+    gint height;
+    gint advance;
+    /* NB_GLYPHS glyphs of width x height, one after the other */
+    guchar coverage[];
+} Atlas;
+
+static Atlas *atlases[RENDER_MAX_SIZE + 1] = { NULL, };
+
+/* frames by content (key), most recently used first */
+#define FRAME_CACHE_MAX     128
+
+typedef struct
+{
+    gchar *key;
+    GVariant *pixmap;
+    GList link;
+} Frame;
+
+static GHashTable *frames = NULL;
+static GQueue frames_lru = G_QUEUE_INIT;
+
+static guint
+glyph_index (gunichar c)
+{
+    const gchar *s;
+
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'z')
+        c -= 'a' - 'A';
+    if (c >= 'A' && c <= 'Z')
+        return 10 + c - 'A';
+    if (c > 0 && c < 128 && (s = strchr (font_symbols, (gint) c)))
+        return 10 + 26 + (guint) (s - font_symbols);
+    return GLYPH_UNKNOWN;
+}
+
+static void
+rasterize_glyph (const guint8 *rows, guchar *coverage, gint width, gint height)
+{
+    gdouble sx = (gdouble) FONT_WIDTH / width;
+    gdouble sy = (gdouble) FONT_HEIGHT / height;
+    gint x, y;
+
+    for (y = 0; y < height; ++y)
+    {
+        gdouble y0 = y * sy, y1 = (y + 1) * sy;
+
+        for (x = 0; x < width; ++x)
+        {
+            gdouble x0 = x * sx, x1 = (x + 1) * sx;
+            gdouble sum = 0.;
+            gint fx, fy;
+
+            for (fy = (gint) y0; fy < FONT_HEIGHT && fy < y1; ++fy)
+            {
+                gdouble h = MIN (y1, fy + 1) - MAX (y0, fy);
+
+                for (fx = (gint) x0; fx < FONT_WIDTH && fx < x1; ++fx)
+                    if (rows[fy] & (1 << (FONT_WIDTH - 1 - fx)))
+                        sum += h * (MIN (x1, fx + 1) - MAX (x0, fx));
+            }
+            *coverage++ = (guchar) (255. * sum / (sx * sy) + .5);
+        }
+    }
+}
+
+static inline gint
+glyph_width (gint height)
+{
+    /* (unsigned, so there's no overflow for the compiler to assume away) */
+    gint width = (gint) (((guint) height * FONT_WIDTH + FONT_HEIGHT / 2) / FONT_HEIGHT);
+
+    return MAX (1, width);
+}
+
+static inline gint
+glyph_advance (gint height)
+{
+    return glyph_width (height) + MAX (1, height / FONT_HEIGHT);
+}
+
+/* width of @n chars with glyphs of @height */
+static inline gint
+text_width (gint height, glong n)
+{
+    return (n > 0)
+        ? (gint) n * glyph_advance (height) - (glyph_advance (height) - glyph_width (height))
+        : 0;
+}
+
+static const Atlas *
+atlas_get (gint height)
+{
+    Atlas *atlas;
+    gint width;
+    guint g;
+
+    if (G_LIKELY (atlases[height]))
+        return atlases[height];
+
+    width = glyph_width (height);
+    atlas = g_malloc (sizeof (*atlas) + NB_GLYPHS * (gsize) (width * height));
+    atlas->width = width;
+    atlas->height = height;
+    atlas->advance = glyph_advance (height);
+    for (g = 0; g < NB_GLYPHS; ++g)
+        rasterize_glyph (font[g], atlas->coverage + g * (gsize) (width * height),
+                width, height);
+
+    atlases[height] = atlas;
+    return atlas;
+}
+
+static void
+color_premultiply (guint32 color, guchar out[PIXMAP_BPP])
+{
+    guint a = color >> 24;
+
+    out[0] = (guchar) a;
+    out[1] = (guchar) ((((color >> 16) & 0xff) * a + 127) / 255);
+    out[2] = (guchar) ((((color >> 8) & 0xff) * a + 127) / 255);
+    out[3] = (guchar) (((color & 0xff) * a + 127) / 255);
+}
+
+/* composites (OVER) premultiplied @color, with coverage @cov, onto pixel @d */
+static inline void
+blend (guchar *d, const guchar color[PIXMAP_BPP], guint cov)
+{
+    guint inv, i;
+
+    if (cov == 0)
+        return;
+    inv = 255 - (color[0] * cov + 127) / 255;
+    for (i = 0; i < PIXMAP_BPP; ++i)
+        d[i] = (guchar) ((color[i] * cov + 127) / 255 + (d[i] * inv + 127) / 255);
+}
+
+static inline guint
+coverage (gdouble v)
+{
+    return (v <= 0.) ? 0 : (v >= 1.) ? 255 : (guint) (v * 255. + .5);
+}
+
+static void
+blit_glyph (guchar *data, gint size, const Atlas *atlas, guint glyph,
+            gint x, gint y, const guchar color[PIXMAP_BPP])
+{
+    const guchar *cov;
+    gint gx, gy;
+
+    cov = atlas->coverage + glyph * (gsize) (atlas->width * atlas->height);
+    for (gy = 0; gy < atlas->height; ++gy, cov += atlas->width)
+    {
+        if (y + gy < 0 || y + gy >= size)
+            continue;
+        for (gx = 0; gx < atlas->width; ++gx)
+            if (x + gx >= 0 && x + gx < size)
+                blend (data + ((y + gy) * size + x + gx) * PIXMAP_BPP,
+                        color, cov[gx]);
+    }
+}
+
+/* largest glyph height for @n chars to fit in a square @box */
+static gint
+fit_text_height (gint box, glong n)
+{
+    gint height;
+
+    height = (n > 0) ? (gint) MIN (box, FONT_HEIGHT * box / (n * (FONT_WIDTH + 1) - 1))
+        : box;
+    height = CLAMP (height, MIN_GLYPH_HEIGHT, RENDER_MAX_SIZE);
+    /* widths are rounded, so make sure it actually fits */
+    while (height > MIN_GLYPH_HEIGHT && text_width (height, n) > box)
+        --height;
+    return height;
+}
+
+/* draws @text centered, with glyphs of @height; Returns glyphs blitted */
+static guint
+draw_text (guchar *data, gint size, const gchar *text, gint height,
+           const guchar color[PIXMAP_BPP])
+{
+    const Atlas *atlas = atlas_get (height);
+    const gchar *s;
+    guint glyphs = 0;
+    gint x, y;
+
+    x = (size - text_width (height, g_utf8_strlen (text, -1))) / 2;
+    y = (size - atlas->height) / 2;
+    for (s = text; *s; s = g_utf8_next_char (s), x += atlas->advance)
+    {
+        gunichar c = g_utf8_get_char (s);
+
+        if (c == ' ')
+            continue;
+        blit_glyph (data, size, atlas, glyph_index (c), x, y, color);
+        ++glyphs;
+    }
+    return glyphs;
+}
+
+static void
+frame_free (Frame *frame)
+{
+    g_free (frame->key);
+    g_variant_unref (frame->pixmap);
+    g_free (frame);
+}
+
+/* Looks @key up in the frame cache; If found, frees @key and returns TRUE with
+ * a new reference in @pixmap */
+static gboolean
+frame_lookup (gchar *key, GVariant **pixmap, RenderStats *stats)
+{
+    Frame *frame;
+
+    stats->cached = FALSE;
+    stats->glyphs = 0;
+    stats->bytes = 0;
+
+    if (!frames || !(frame = g_hash_table_lookup (frames, key)))
+        return FALSE;
+
+    g_queue_unlink (&frames_lru, &frame->link);
+    g_queue_push_head_link (&frames_lru, &frame->link);
+    g_free (key);
+    stats->cached = TRUE;
+    *pixmap = g_variant_ref (frame->pixmap);
+    return TRUE;
+}
+
+/* returns a new reference to a pixmap (a(iiay)) of @data (taken), a square of
+ * @size */
+static GVariant *
+pixmap_new (guchar *data, gint size)
+{
+    GVariant *pixels, *child;
+
+    pixels = g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data,
+            (gsize) size * (gsize) size * PIXMAP_BPP,
+            TRUE, g_free, data);
+    child = g_variant_new ("(ii@ay)", size, size, pixels);
+    return g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("(iiay)"),
+                &child, 1));
+}
+
+/* Turns @data into the pixmap (a(iiay)) and adds it to the frame cache under
+ * @key (taken); Returns a new reference */
+static GVariant *
+frame_add (gchar *key, guchar *data, gint size, RenderStats *stats)
+{
+    Frame *frame;
+
+    if (!frames)
+        frames = g_hash_table_new_full (g_str_hash, g_str_equal,
+                NULL, (GDestroyNotify) frame_free);
+    if (frames_lru.length >= FRAME_CACHE_MAX)
+    {
+        GList *l = g_queue_pop_tail_link (&frames_lru);
+
+        g_hash_table_remove (frames, ((Frame *) l->data)->key);
+    }
+
+    frame = g_new0 (Frame, 1);
+    frame->key = key;
+    frame->pixmap = pixmap_new (data, size);
+    frame->link.data = frame;
+    g_queue_push_head_link (&frames_lru, &frame->link);
+    g_hash_table_insert (frames, frame->key, frame);
+
+    stats->bytes = (gsize) size * (gsize) size * PIXMAP_BPP;
+    return g_variant_ref (frame->pixmap);
+}
+
+static inline guchar *
+canvas_new (gint size)
+{
+    return g_malloc0 ((gsize) size * (gsize) size * PIXMAP_BPP);
+}
+
+/* Returns a new reference to a pixmap (a(iiay)) of @text in @fg, as large as
+ * fits, on a square of @bg */
+GVariant *
+render_text (const gchar *text, guint32 fg, guint32 bg, gint size,
+             RenderStats *stats)
+{
+    guchar c_fg[PIXMAP_BPP], c_bg[PIXMAP_BPP];
+    GVariant *pixmap;
+    guchar *data;
+    gchar *key;
+    gint i;
+
+    key = g_strdup_printf ("text:%d:%08x:%08x:%s", size, fg, bg, text);
+    if (frame_lookup (key, &pixmap, stats))
+        return pixmap;
+
+    color_premultiply (fg, c_fg);
+    color_premultiply (bg, c_bg);
+    data = canvas_new (size);
+    if (c_bg[0] > 0)
+        for (i = 0; i < size * size; ++i)
+            memcpy (data + i * PIXMAP_BPP, c_bg, PIXMAP_BPP);
+    stats->glyphs = draw_text (data, size, text,
+            fit_text_height (size - 2 * MAX (1, size / 16), g_utf8_strlen (text, -1)),
+            c_fg);
+
+    return frame_add (key, data, size, stats);
+}
+
+/* Returns a new reference to a pixmap (a(iiay)) of a disc of @bg with @count
+ * (or "99+") in @fg */
+GVariant *
+render_badge (guint count, guint32 fg, guint32 bg, gint size,
+              RenderStats *stats)
+{
+    guchar c_fg[PIXMAP_BPP], c_bg[PIXMAP_BPP];
+    GVariant *pixmap;
+    guchar *data, *d;
+    gchar text[4];
+    gchar *key;
+    gdouble r;
+    gint x, y;
+
+    key = g_strdup_printf ("badge:%d:%08x:%08x:%u", size, fg, bg, MIN (count, 100));
+    if (frame_lookup (key, &pixmap, stats))
+        return pixmap;
+
+    color_premultiply (fg, c_fg);
+    color_premultiply (bg, c_bg);
+    d = data = canvas_new (size);
+    r = size / 2.;
+    for (y = 0; y < size; ++y)
+        for (x = 0; x < size; ++x, d += PIXMAP_BPP)
+        {
+            gdouble dx = x + .5 - r, dy = y + .5 - r;
+
+            blend (d, c_bg, coverage (r - sqrt (dx * dx + dy * dy) + .5));
+        }
+
+    if (count > 99)
+        g_strlcpy (text, "99+", sizeof (text));
+    else
+        g_snprintf (text, sizeof (text), "%u", count);
+    /* roughly the square inscribed in the disc */
+    stats->glyphs = draw_text (data, size, text,
+            fit_text_height ((gint) (size * .7), (glong) strlen (text)), c_fg);
+
+    return frame_add (key, data, size, stats);
+}
+
+/* Returns a new reference to a pixmap (a(iiay)) of a ring of @bg, with an arc
+ * of @fg clockwise from the top for @fraction of it. @fraction is rounded to
+ * what can be told apart at @size, so close values share a frame. */
+GVariant *
+render_progress (gdouble fraction, guint32 fg, guint32 bg, gint size,
+                 RenderStats *stats)
+{
+    guchar c_fg[PIXMAP_BPP], c_bg[PIXMAP_BPP];
+    GVariant *pixmap;
+    guchar *data, *d;
+    gchar *key;
+    gdouble r, inner, end;
+    gint steps, step;
+    gint x, y;
+
+    /* also catches NaN, which CLAMP() wouldn't */
+    if (!(fraction > 0.))
+        fraction = 0.;
+    steps = (gint) (G_PI * size);
+    step = (gint) (MIN (fraction, 1.) * steps + .5);
+
+    key = g_strdup_printf ("progress:%d:%08x:%08x:%d", size, fg, bg, step);
+    if (frame_lookup (key, &pixmap, stats))
+        return pixmap;
+
+    color_premultiply (fg, c_fg);
+    color_premultiply (bg, c_bg);
+    d = data = canvas_new (size);
+    r = size / 2.;
+    inner = r - MAX (2., size / 6.);
+    end = 2. * G_PI * step / steps;
+    for (y = 0; y < size; ++y)
+        for (x = 0; x < size; ++x, d += PIXMAP_BPP)
+        {
+            gdouble dx = x + .5 - r, dy = y + .5 - r;
+            gdouble dist = sqrt (dx * dx + dy * dy);
+            gdouble a;
+            guint cov;
+
+            cov = MIN (coverage (r - dist + .5), coverage (dist - inner + .5));
+            if (cov == 0)
+                continue;
+            blend (d, c_bg, cov);
+
+            if (step == 0)
+                continue;
+            else if (step < steps)
+            {
+                /* clockwise from the top; Edges antialiased over the distance
+                 * (in pixels) to them along the arc */
+                a = atan2 (dx, -dy);
+                if (a < 0.)
+                    a += 2. * G_PI;
+                cov = cov * MIN (coverage ((end - a) * dist + .5),
+                        coverage (a * dist + .5)) / 255;
+            }
+            blend (d, c_fg, cov);
+        }
+
+    return frame_add (key, data, size, stats);
+}
+
+/* Graphs: the last @size samples, one column each, newest on the right. Each
+ * row holds its columns twice in a row, written at pos and pos + size, so the
+ * current image of a row is always the @size pixels starting at pos: adding a
+ * sample only writes its column, nothing else is moved or redrawn. */
+
+struct _RenderGraph
+{
+    gdouble min;
+    gdouble max;
+    guchar fg[PIXMAP_BPP];
+    guchar bg[PIXMAP_BPP];
+    gint size;
+    /* where the oldest column is (and the next one will be written) */
+    gint pos;
+    /* size rows of 2 * size pixels */
+    guchar *rows;
+};
+
+static void
+graph_write_column (RenderGraph *graph, gint pos, gdouble value)
+{
+    gint size = graph->size;
+    gdouble height;
+    gint y;
+
+    height = (value - graph->min) / (graph->max - graph->min);
+    /* also catches NaN */
+    if (!(height > 0.))
+        height = 0.;
+    height = MIN (height, 1.) * size;
+
+    for (y = 0; y < size; ++y)
+    {
+        guchar *d = graph->rows
+            + ((gsize) y * 2 * (gsize) size + (gsize) pos) * PIXMAP_BPP;
+
+        memcpy (d, graph->bg, PIXMAP_BPP);
+        /* antialiased top */
+        blend (d, graph->fg, coverage (height - (size - 1 - y)));
+        memcpy (d + size * PIXMAP_BPP, d, PIXMAP_BPP);
+    }
+}
+
+/* Returns a new graph of @fg on @bg, for values from @min to @max, of @size
+ * pixels (and samples) */
+RenderGraph *
+render_graph_new (gdouble min, gdouble max, guint32 fg, guint32 bg, gint size)
+{
+    RenderGraph *graph;
+    gint i;
+
+    graph = g_new0 (RenderGraph, 1);
+    graph->min = min;
+    graph->max = max;
+    color_premultiply (fg, graph->fg);
+    color_premultiply (bg, graph->bg);
+    graph->size = size;
+    graph->rows = g_malloc0 (2 * (gsize) size * (gsize) size * PIXMAP_BPP);
+    if (graph->bg[0] > 0)
+        for (i = 0; i < 2 * size * size; ++i)
+            memcpy (graph->rows + i * PIXMAP_BPP, graph->bg, PIXMAP_BPP);
+    return graph;
+}
+
+void
+render_graph_free (RenderGraph *graph)
+{
+    g_free (graph->rows);
+    g_free (graph);
+}
+
+/* adds @value as newest sample, dropping the oldest one */
+void
+render_graph_push (RenderGraph *graph, gdouble value)
+{
+    graph_write_column (graph, graph->pos, value);
+    graph->pos = (graph->pos + 1) % graph->size;
+}
+
+/* Returns a new reference to a pixmap (a(iiay)) of @graph as it is now, i.e.
+ * one copy per row */
+GVariant *
+render_graph_get_pixmap (RenderGraph *graph)
+{
+    gint size = graph->size;
+    gsize row = (gsize) size * PIXMAP_BPP;
+    guchar *data;
+    gint y;
+
+    data = g_malloc (row * (gsize) size);
+    for (y = 0; y < size; ++y)
+        memcpy (data + (gsize) y * row,
+                graph->rows
+                + ((gsize) y * 2 * (gsize) size + (gsize) graph->pos) * PIXMAP_BPP,
+                row);
+    return pixmap_new (data, size);
+}
+
+/* overlay composites, by (main, overlay) pixmaps; Both are referenced, so their
+ * addresses can't be reused by other pixmaps while in the cache */
+#define COMPOSITE_CACHE_MAX 32
+
+typedef struct
+{
+    GVariant *base;
+    GVariant *overlay;
+    GVariant *pixmap;
+    GList link;
+} Composite;
+
+static GHashTable *composites = NULL;
+static GQueue composites_lru = G_QUEUE_INIT;
+
+static guint
+composite_hash (gconstpointer key)
+{
+    const Composite *c = key;
+
+    return g_direct_hash (c->base) ^ (g_direct_hash (c->overlay) * 31);
+}
+
+static gboolean
+composite_equal (gconstpointer a, gconstpointer b)
+{
+    const Composite *c1 = a, *c2 = b;
+
+    return c1->base == c2->base && c1->overlay == c2->overlay;
+}
+
+static void
+composite_free (Composite *composite)
+{
+    g_variant_unref (composite->base);
+    g_variant_unref (composite->overlay);
+    g_variant_unref (composite->pixmap);
+    g_slice_free (Composite, composite);
+}
+
+/* the size of @pixmap to scale down (or up) from to @box: the smallest at
+ * least as large, else the largest */
+static GVariant *
+pixmap_pick (GVariant *pixmap, gint box)
+{
+    GVariant *best = NULL;
+    gint best_size = 0;
+    gsize i, n;
+
+    n = g_variant_n_children (pixmap);
+    for (i = 0; i < n; ++i)
+    {
+        GVariant *child = g_variant_get_child_value (pixmap, i);
+        gint w, h, size;
+
+        g_variant_get_child (child, 0, "i", &w);
+        g_variant_get_child (child, 1, "i", &h);
+        size = MAX (w, h);
+        if (!best || (best_size < box && size > best_size)
+                || (size >= box && size < best_size))
+        {
+            if (best)
+                g_variant_unref (best);
+            best = child;
+            best_size = size;
+        }
+        else
+            g_variant_unref (child);
+    }
+    return best;
+}
+
+/* pixel @x,@y of @src (@sw x @sh) box-filtered down (or up) to @bw x @bh,
+ * into @out */
+static inline void
+box_sample (const guchar *src, gint sw, gint sh, gint x, gint y, gint bw, gint bh,
+            guchar out[PIXMAP_BPP])
+{
+    /* unsigned (all are non-negative), no signed overflow to assume away */
+    guint sy0 = (guint) y * (guint) sh / (guint) bh;
+    guint sy1 = MAX (sy0 + 1, (guint) (y + 1) * (guint) sh / (guint) bh);
+    guint sx0 = (guint) x * (guint) sw / (guint) bw;
+    guint sx1 = MAX (sx0 + 1, (guint) (x + 1) * (guint) sw / (guint) bw);
+    guint sum[PIXMAP_BPP] = { 0, };
+    guint nb = (sx1 - sx0) * (sy1 - sy0);
+    guint i;
+    guint sx, sy;
+
+    /* premultiplied, so a plain average */
+    for (sy = sy0; sy < sy1; ++sy)
+        for (sx = sx0; sx < sx1; ++sx)
+        {
+            const guchar *p = src + ((gsize) sy * (gsize) sw + (gsize) sx) * PIXMAP_BPP;
+
+            for (i = 0; i < PIXMAP_BPP; ++i)
+                sum[i] += p[i];
+        }
+    for (i = 0; i < PIXMAP_BPP; ++i)
+        out[i] = (guchar) ((sum[i] + nb / 2) / nb);
+}
+
+/* returns the pixels of @child ((iiay)), or NULL if their size is wrong */
+static GVariant *
+child_get (GVariant *child, gint *width, gint *height)
+{
+    GVariant *pixels;
+
+    g_variant_get (child, "(ii@ay)", width, height, &pixels);
+    if (*width <= 0 || *height <= 0 || g_variant_get_size (pixels)
+            != (gsize) *width * (gsize) *height * PIXMAP_BPP)
+    {
+        g_variant_unref (pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+/* draws (OVER, box-filtered) @ov onto the @bw x @bh box at @bx,@by of @data,
+ * which is @width wide */
+static void
+draw_overlay (guchar *data, gint width, gint bx, gint by, gint bw, gint bh,
+              GVariant *ov)
+{
+    GVariant *pixels;
+    const guchar *src;
+    gint sw, sh;
+    gint x, y;
+
+    pixels = child_get (ov, &sw, &sh);
+    if (!pixels)
+        return;
+    src = g_variant_get_data (pixels);
+
+    for (y = 0; y < bh; ++y)
+        for (x = 0; x < bw; ++x)
+        {
+            guchar *d, s[PIXMAP_BPP];
+            guint inv, i;
+
+            box_sample (src, sw, sh, x, y, bw, bh, s);
+            d = data + ((gsize) (by + y) * (gsize) width + (gsize) (bx + x)) * PIXMAP_BPP;
+            inv = 255U - s[0];
+            for (i = 0; i < PIXMAP_BPP; ++i)
+                d[i] = (guchar) (s[i] + (d[i] * inv + 127) / 255);
+        }
+    g_variant_unref (pixels);
+}
+
+/* Returns a new reference to @base (main icon) with @overlay drawn, at half
+ * its size, in its bottom-right corner (for each size of @base, from the best
+ * size of @overlay); Composites are cached, so the same pair again is a
+ * lookup */
+GVariant *
+render_overlay (GVariant *base, GVariant *overlay, RenderStats *stats)
+{
+    Composite key, *composite;
+    GVariantBuilder builder;
+    gsize i, n;
+
+    stats->cached = FALSE;
+    stats->glyphs = 0;
+    stats->bytes = 0;
+
+    n = g_variant_n_children (base);
+    if (n == 0 || g_variant_n_children (overlay) == 0)
+        return g_variant_ref (base);
+
+    key.base = base;
+    key.overlay = overlay;
+    if (composites && (composite = g_hash_table_lookup (composites, &key)))
+    {
+        g_queue_unlink (&composites_lru, &composite->link);
+        g_queue_push_head_link (&composites_lru, &composite->link);
+        stats->cached = TRUE;
+        return g_variant_ref (composite->pixmap);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+    for (i = 0; i < n; ++i)
+    {
+        GVariant *pixels, *ov;
+        guchar *data;
+        gsize len;
+        gint w, h, bw, bh;
+
+        g_variant_get_child (base, i, "(ii@ay)", &w, &h, &pixels);
+        len = g_variant_get_size (pixels);
+        data = g_malloc (len);
+        memcpy (data, g_variant_get_data (pixels), len);
+        g_variant_unref (pixels);
+
+        bw = MAX (1, w / 2);
+        bh = MAX (1, h / 2);
+        if (len == (gsize) w * (gsize) h * PIXMAP_BPP
+                && (ov = pixmap_pick (overlay, MAX (bw, bh))))
+        {
+            draw_overlay (data, w, w - bw, h - bh, bw, bh, ov);
+            g_variant_unref (ov);
+        }
+
+        stats->bytes += len;
+        g_variant_builder_add (&builder, "(ii@ay)", w, h,
+                g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data, len,
+                    TRUE, g_free, data));
+    }
+
+    if (!composites)
+        composites = g_hash_table_new_full (composite_hash, composite_equal,
+                NULL, (GDestroyNotify) composite_free);
+    if (composites_lru.length >= COMPOSITE_CACHE_MAX)
+    {
+        GList *l = g_queue_pop_tail_link (&composites_lru);
+
+        g_hash_table_remove (composites, l->data);
+    }
+
+    composite = g_slice_new (Composite);
+    composite->base = g_variant_ref (base);
+    composite->overlay = g_variant_ref (overlay);
+    composite->pixmap = g_variant_ref_sink (g_variant_builder_end (&builder));
+    composite->link.data = composite;
+    composite->link.prev = composite->link.next = NULL;
+    g_queue_push_head_link (&composites_lru, &composite->link);
+    g_hash_table_add (composites, composite);
+
+    return g_variant_ref (composite->pixmap);
+}
+
+/* pixmaps fitted to sizes, by (pixmap, sizes); The pixmap is referenced, as for
+ * composites */
+#define FIT_CACHE_MAX       64
+
+typedef struct
+{
+    GVariant *pixmap;
+    gchar *sizes;
+    GVariant *fitted;
+    GList link;
+} Fit;
+
+static GHashTable *fits = NULL;
+static GQueue fits_lru = G_QUEUE_INIT;
+
+static guint
+fit_hash (gconstpointer key)
+{
+    const Fit *fit = key;
+
+    return g_direct_hash (fit->pixmap) ^ g_str_hash (fit->sizes);
+}
+
+static gboolean
+fit_equal (gconstpointer a, gconstpointer b)
+{
+    const Fit *f1 = a, *f2 = b;
+
+    return f1->pixmap == f2->pixmap && !strcmp (f1->sizes, f2->sizes);
+}
+
+static void
+fit_free (Fit *fit)
+{
+    g_variant_unref (fit->pixmap);
+    g_free (fit->sizes);
+    g_variant_unref (fit->fitted);
+    g_slice_free (Fit, fit);
+}
+
+static gint
+cmp_size (gconstpointer a, gconstpointer b)
+{
+    return *(const gint *) a - *(const gint *) b;
+}
+
+/* Returns a new reference to @pixmap with, for each of @sizes (or each of its
+ * own sizes if none), its nearest size, downscaled if larger; Sizes are capped
+ * to @max_size, unless 0. Results are cached, and when nothing needs to be
+ * changed @pixmap itself is returned */
+GVariant *
+render_fit (GVariant *pixmap, const gint *sizes, guint nb_sizes, gint max_size,
+            RenderStats *stats)
+{
+    Fit key, *fit;
+    GVariantBuilder builder;
+    GArray *targets;
+    GString *str;
+    gint prev_w = 0, prev_h = 0;
+    gboolean needed = nb_sizes > 0;
+    gsize i, n;
+
+    stats->cached = FALSE;
+    stats->glyphs = 0;
+    stats->bytes = 0;
+
+    n = g_variant_n_children (pixmap);
+    if (n == 0)
+        return g_variant_ref (pixmap);
+
+    targets = g_array_sized_new (FALSE, FALSE, sizeof (gint),
+            (nb_sizes > 0) ? nb_sizes : (guint) n);
+    if (nb_sizes > 0)
+        g_array_append_vals (targets, sizes, nb_sizes);
+    else
+        for (i = 0; i < n; ++i)
+        {
+            gint w, h;
+
+            g_variant_get_child (pixmap, i, "(ii@ay)", &w, &h, NULL);
+            w = MAX (w, h);
+            g_array_append_val (targets, w);
+        }
+    for (i = 0; i < targets->len; ++i)
+        if (max_size > 0 && g_array_index (targets, gint, i) > max_size)
+        {
+            g_array_index (targets, gint, i) = max_size;
+            needed = TRUE;
+        }
+    if (!needed)
+    {
+        g_array_free (targets, TRUE);
+        return g_variant_ref (pixmap);
+    }
+    g_array_sort (targets, cmp_size);
+
+    str = g_string_new (NULL);
+    for (i = 0; i < targets->len; ++i)
+        g_string_append_printf (str, "%d,", g_array_index (targets, gint, i));
+    key.pixmap = pixmap;
+    key.sizes = str->str;
+    if (fits && (fit = g_hash_table_lookup (fits, &key)))
+    {
+        g_string_free (str, TRUE);
+        g_array_free (targets, TRUE);
+        g_queue_unlink (&fits_lru, &fit->link);
+        g_queue_push_head_link (&fits_lru, &fit->link);
+        stats->cached = TRUE;
+        return g_variant_ref (fit->fitted);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+    for (i = 0; i < targets->len; ++i)
+    {
+        gint target = g_array_index (targets, gint, i);
+        GVariant *child, *pixels;
+        const guchar *src;
+        guchar *data;
+        gsize len;
+        gint w, h, size, dw, dh, x, y;
+
+        child = pixmap_pick (pixmap, target);
+        pixels = child_get (child, &w, &h);
+        if (!pixels)
+        {
+            g_variant_unref (child);
+            continue;
+        }
+
+        size = MAX (w, h);
+        if (size <= target)
+        {
+            /* (e.g. all targets over the largest size) */
+            if (w != prev_w || h != prev_h)
+                g_variant_builder_add_value (&builder, child);
+            prev_w = w;
+            prev_h = h;
+            g_variant_unref (pixels);
+            g_variant_unref (child);
+            continue;
+        }
+
+        dw = MAX (1, w * target / size);
+        dh = MAX (1, h * target / size);
+        if (dw == prev_w && dh == prev_h)
+        {
+            g_variant_unref (pixels);
+            g_variant_unref (child);
+            continue;
+        }
+        len = (gsize) dw * (gsize) dh * PIXMAP_BPP;
+        data = g_malloc (len);
+        src = g_variant_get_data (pixels);
+        for (y = 0; y < dh; ++y)
+            for (x = 0; x < dw; ++x)
+                box_sample (src, w, h, x, y, dw, dh,
+                        data + ((gsize) y * (gsize) dw + (gsize) x) * PIXMAP_BPP);
+        stats->bytes += len;
+        g_variant_builder_add (&builder, "(ii@ay)", dw, dh,
+                g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data, len,
+                    TRUE, g_free, data));
+        prev_w = dw;
+        prev_h = dh;
+        g_variant_unref (pixels);
+        g_variant_unref (child);
+    }
+    g_array_free (targets, TRUE);
+
+    if (!fits)
+        fits = g_hash_table_new_full (fit_hash, fit_equal,
+                NULL, (GDestroyNotify) fit_free);
+    if (fits_lru.length >= FIT_CACHE_MAX)
+    {
+        GList *l = g_queue_pop_tail_link (&fits_lru);
+
+        g_hash_table_remove (fits, l->data);
+    }
+
+    fit = g_slice_new (Fit);
+    fit->pixmap = g_variant_ref (pixmap);
+    fit->sizes = g_string_free (str, FALSE);
+    fit->fitted = g_variant_ref_sink (g_variant_builder_end (&builder));
+    fit->link.data = fit;
+    fit->link.prev = fit->link.next = NULL;
+    g_queue_push_head_link (&fits_lru, &fit->link);
+    g_hash_table_add (fits, fit);
+
+    return g_variant_ref (fit->fitted);
+}
+
+/* deltas are made of dirty tiles, merged into rects along rows; positions
+ * are unsigned, being all non-negative */
+#define DELTA_TILE          8U
+
+static gboolean
+tile_differs (const guchar *a, const guchar *b, guint width, guint x, guint y,
+              guint tw, guint th)
+{
+    gsize row = (gsize) width * PIXMAP_BPP;
+    guint i;
+
+    for (i = 0; i < th; ++i)
+    {
+        gsize offset = (gsize) (y + i) * row + (gsize) x * PIXMAP_BPP;
+
+        if (memcmp (a + offset, b + offset, (gsize) tw * PIXMAP_BPP))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+add_rect (GVariantBuilder *builder, const guchar *src, guint width,
+          guint x, guint y, guint w, guint h, RenderStats *stats)
+{
+    gsize row = (gsize) w * PIXMAP_BPP;
+    guchar *data;
+    guint i;
+
+    data = g_malloc (row * (gsize) h);
+    for (i = 0; i < h; ++i)
+        memcpy (data + (gsize) i * row,
+                src + ((gsize) (y + i) * (gsize) width + (gsize) x) * PIXMAP_BPP,
+                row);
+    stats->bytes += row * (gsize) h;
+    g_variant_builder_add (builder, "(iiii@ay)", (gint) x, (gint) y, (gint) w, (gint) h,
+            g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data, row * (gsize) h,
+                TRUE, g_free, data));
+}
+
+/* Returns the changes from @old to @cur (both a(iiay)) as a(iia(iiiiay)): for
+ * each size, its rects (x, y, width, height, pixels) that differ; Without @old
+ * it's all of @cur. Returns NULL if @old doesn't have the same sizes as @cur */
+GVariant *
+render_delta (GVariant *old, GVariant *cur, RenderStats *stats)
+{
+    GVariantBuilder builder;
+    gsize i, n;
+
+    stats->cached = FALSE;
+    stats->glyphs = 0;
+    stats->bytes = 0;
+
+    n = g_variant_n_children (cur);
+    if (old && g_variant_n_children (old) != n)
+        return NULL;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iia(iiiiay))"));
+    for (i = 0; i < n; ++i)
+    {
+        GVariant *child, *pixels, *old_pixels = NULL;
+        GVariantBuilder rects;
+        const guchar *src, *prev = NULL;
+        gint w, h;
+        guint tx, ty, ntx, nty;
+
+        child = g_variant_get_child_value (cur, i);
+        pixels = child_get (child, &w, &h);
+        g_variant_unref (child);
+        if (old)
+        {
+            gint ow = 0, oh = 0;
+
+            child = g_variant_get_child_value (old, i);
+            old_pixels = child_get (child, &ow, &oh);
+            g_variant_unref (child);
+            if (!pixels || !old_pixels || ow != w || oh != h)
+            {
+                if (pixels)
+                    g_variant_unref (pixels);
+                if (old_pixels)
+                    g_variant_unref (old_pixels);
+                g_variant_builder_clear (&builder);
+                return NULL;
+            }
+            prev = g_variant_get_data (old_pixels);
+        }
+        else if (!pixels)
+            continue;
+        src = g_variant_get_data (pixels);
+
+        g_variant_builder_init (&rects, G_VARIANT_TYPE ("a(iiiiay)"));
+        ntx = ((guint) w + DELTA_TILE - 1) / DELTA_TILE;
+        nty = ((guint) h + DELTA_TILE - 1) / DELTA_TILE;
+        for (ty = 0; ty < nty; ++ty)
+        {
+            guint y = ty * DELTA_TILE;
+            guint th = MIN (DELTA_TILE, (guint) h - y);
+            guint start = 0;
+            gboolean in_run = FALSE;
+
+            /* (one past the last tile, to close a run) */
+            for (tx = 0; tx <= ntx; ++tx)
+            {
+                gboolean dirty = tx < ntx && (!prev || tile_differs (prev, src,
+                            (guint) w, tx * DELTA_TILE, y,
+                            MIN (DELTA_TILE, (guint) w - tx * DELTA_TILE), th));
+
+                if (dirty && !in_run)
+                {
+                    start = tx;
+                    in_run = TRUE;
+                }
+                else if (!dirty && in_run)
+                {
+                    add_rect (&rects, src, (guint) w, start * DELTA_TILE, y,
+                            MIN (tx * DELTA_TILE, (guint) w) - start * DELTA_TILE,
+                            th, stats);
+                    in_run = FALSE;
+                }
+            }
+        }
+        g_variant_builder_add (&builder, "(ii@a(iiiiay))", w, h,
+                g_variant_builder_end (&rects));
+
+        g_variant_unref (pixels);
+        if (old_pixels)
+            g_variant_unref (old_pixels);
+    }
+    return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
@@ -0,0 +1,104 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * render.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Procedural icons (text, badge, progress ring) rendered straight into wire
+ * format, using a built-in bitmap font pre-rasterized into a glyph atlas per
+ * glyph height. Frames are cached by content, so rendering the same thing
+ * again is only a lookup.
+ *
+ * Icons are square, of RENDER_MIN_SIZE to RENDER_MAX_SIZE pixels; Colors are
+ * 0xAARRGGBB, not premultiplied. Main thread only, as the caches aren't
+ * locked. */
+
+#define RENDER_MIN_SIZE     8
+#define RENDER_MAX_SIZE     256
+
+typedef struct
+{
+    /* whether the frame came from the frame cache */
+    gboolean cached;
+    /* glyphs blitted (i.e. 0 when cached) */
+    guint glyphs;
+    /* bytes of pixel data produced */
+    gsize bytes;
+} RenderStats;
+
+GVariant *          render_text                 (const gchar        *text,
+                                                 guint32             fg,
+                                                 guint32             bg,
+                                                 gint                size,
+                                                 RenderStats        *stats);
+GVariant *          render_badge                (guint               count,
+                                                 guint32             fg,
+                                                 guint32             bg,
+                                                 gint                size,
+                                                 RenderStats        *stats);
+GVariant *          render_progress             (gdouble             fraction,
+                                                 guint32             fg,
+                                                 guint32             bg,
+                                                 gint                size,
+                                                 RenderStats        *stats);
+
+/* main icon (a(iiay), any size) with an overlay drawn onto it; Composites are
+ * cached by (main, overlay) */
+GVariant *          render_overlay              (GVariant           *base,
+                                                 GVariant           *overlay,
+                                                 RenderStats        *stats);
+
+/* @pixmap (a(iiay)) with only the nearest size for each of @sizes (all of its
+ * sizes if none), downscaled (box filter) as needed, and none over @max_size
+ * (unless 0); Cached by (pixmap, sizes) */
+GVariant *          render_fit                  (GVariant           *pixmap,
+                                                 const gint         *sizes,
+                                                 guint               nb_sizes,
+                                                 gint                max_size,
+                                                 RenderStats        *stats);
+
+/* changes from @old to @cur (a(iiay)), as dirty rects for each size, i.e.
+ * a(iia(iiiiay)); NULL if sizes differ */
+GVariant *          render_delta                (GVariant           *old,
+                                                 GVariant           *cur,
+                                                 RenderStats        *stats);
+
+/* graph of the last samples, one column per sample */
+typedef struct _RenderGraph RenderGraph;
+
+RenderGraph *       render_graph_new            (gdouble             min,
+                                                 gdouble             max,
+                                                 guint32             fg,
+                                                 guint32             bg,
+                                                 gint                size);
+void                render_graph_free           (RenderGraph        *graph);
+void                render_graph_push           (RenderGraph        *graph,
+                                                 gdouble             value);
+GVariant *          render_graph_get_pixmap     (RenderGraph        *graph);
+
+G_END_DECLS
+
+#endif /* __RENDER_H__ */
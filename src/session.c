@@ -0,0 +1,268 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * session.c
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <gio/gio.h>
+#include "session.h"
+
+#define _UNUSED_                __attribute__ ((unused))
+
+#define LOGIND_NAME         "org.freedesktop.login1"
+#define LOGIND_OBJECT       "/org/freedesktop/login1"
+#define LOGIND_MANAGER      "org.freedesktop.login1.Manager"
+#define LOGIND_SESSION      "org.freedesktop.login1.Session"
+
+struct watcher
+{
+    SessionFunc func;
+    gpointer data;
+};
+
+static struct
+{
+    GSList *watchers;
+    /* set while watching, to cancel whatever is pending on stop */
+    GCancellable *cancellable;
+    GDBusProxy *proxy;
+    gboolean inactive;
+    /* while calling watchers, removals only clear func (see purge_watchers) */
+    guint dispatching;
+    gboolean removed;
+} session;
+
+static gboolean
+get_hint (GDBusProxy *proxy, const gchar *name)
+{
+    GVariant *variant;
+    gboolean hint = FALSE;
+
+    variant = g_dbus_proxy_get_cached_property (proxy, name);
+    if (variant)
+    {
+        if (g_variant_is_of_type (variant, G_VARIANT_TYPE_BOOLEAN))
+            hint = g_variant_get_boolean (variant);
+        g_variant_unref (variant);
+    }
+    return hint;
+}
+
+static void session_stop (void);
+
+/* frees the watchers removed while dispatching */
+static void
+purge_watchers (void)
+{
+    GSList *l;
+
+    for (l = session.watchers; l; )
+    {
+        struct watcher *w = l->data;
+        GSList *next = l->next;
+
+        if (!w->func)
+        {
+            session.watchers = g_slist_delete_link (session.watchers, l);
+            g_free (w);
+        }
+        l = next;
+    }
+    session.removed = FALSE;
+
+    if (!session.watchers && session.cancellable)
+        session_stop ();
+}
+
+static void
+session_update (void)
+{
+    gboolean inactive;
+    GSList *l;
+
+    inactive = get_hint (session.proxy, "LockedHint")
+        || get_hint (session.proxy, "IdleHint");
+    if (inactive == session.inactive)
+        return;
+
+    session.inactive = inactive;
+    /* a watcher may add or remove watchers (itself or any other): links stay
+     * valid until we're done, added ones are prepended thus not called */
+    ++session.dispatching;
+    for (l = session.watchers; l; l = l->next)
+    {
+        struct watcher *w = l->data;
+
+        if (w->func)
+            w->func (inactive, w->data);
+    }
+    if (--session.dispatching == 0 && session.removed)
+        purge_watchers ();
+}
+
+static void
+properties_changed (GDBusProxy  *proxy _UNUSED_,
+                    GVariant    *changed _UNUSED_,
+                    GStrv        invalidated _UNUSED_,
+                    gpointer     data _UNUSED_)
+{
+    session_update ();
+}
+
+static void
+proxy_cb (GObject *sce _UNUSED_, GAsyncResult *result, gpointer data _UNUSED_)
+{
+    GDBusProxy *proxy;
+
+    proxy = g_dbus_proxy_new_finish (result, NULL);
+    if (!proxy)
+        /* cancelled, or no logind: remain active */
+        return;
+
+    session.proxy = proxy;
+    g_signal_connect (proxy, "g-properties-changed",
+            (GCallback) properties_changed, NULL);
+    session_update ();
+}
+
+static void
+session_path_cb (GObject *sce, GAsyncResult *result, gpointer data _UNUSED_)
+{
+    GDBusConnection *conn = (GDBusConnection *) sce;
+    GVariant *variant;
+    const gchar *path;
+
+    variant = g_dbus_connection_call_finish (conn, result, NULL);
+    if (!variant)
+        return;
+
+    g_variant_get (variant, "(&o)", &path);
+    g_dbus_proxy_new (conn,
+            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+            NULL,
+            LOGIND_NAME,
+            path,
+            LOGIND_SESSION,
+            session.cancellable,
+            proxy_cb,
+            NULL);
+    g_variant_unref (variant);
+}
+
+static void
+bus_cb (GObject *sce _UNUSED_, GAsyncResult *result, gpointer data _UNUSED_)
+{
+    GDBusConnection *conn;
+    const gchar *id;
+
+    conn = g_bus_get_finish (result, NULL);
+    if (!conn)
+        return;
+
+    /* the session we were started in, if any; else the one we belong to */
+    id = g_getenv ("XDG_SESSION_ID");
+    g_dbus_connection_call (conn,
+            LOGIND_NAME,
+            LOGIND_OBJECT,
+            LOGIND_MANAGER,
+            (id && *id) ? "GetSession" : "GetSessionByPID",
+            (id && *id) ? g_variant_new ("(s)", id)
+                        : g_variant_new ("(u)", (guint32) getpid ()),
+            G_VARIANT_TYPE ("(o)"),
+            G_DBUS_CALL_FLAGS_NO_AUTO_START,
+            -1,
+            session.cancellable,
+            session_path_cb,
+            NULL);
+    g_object_unref (conn);
+}
+
+static void
+session_start (void)
+{
+    const gchar *env = g_getenv (SESSION_BUS_ENV);
+
+    session.cancellable = g_cancellable_new ();
+    g_bus_get ((g_strcmp0 (env, "session")) ? G_BUS_TYPE_SYSTEM : G_BUS_TYPE_SESSION,
+            session.cancellable, bus_cb, NULL);
+}
+
+static void
+session_stop (void)
+{
+    g_cancellable_cancel (session.cancellable);
+    g_clear_object (&session.cancellable);
+    if (session.proxy)
+    {
+        g_signal_handlers_disconnect_by_func (session.proxy,
+                properties_changed, NULL);
+        g_clear_object (&session.proxy);
+    }
+    session.inactive = FALSE;
+}
+
+void
+session_watch_add (SessionFunc func, gpointer data)
+{
+    struct watcher *w;
+
+    w = g_new (struct watcher, 1);
+    w->func = func;
+    w->data = data;
+    session.watchers = g_slist_prepend (session.watchers, w);
+
+    if (!session.cancellable)
+        session_start ();
+}
+
+void
+session_watch_remove (SessionFunc func, gpointer data)
+{
+    GSList *l;
+
+    for (l = session.watchers; l; l = l->next)
+    {
+        struct watcher *w = l->data;
+
+        if (w->func == func && w->data == data)
+        {
+            if (session.dispatching > 0)
+            {
+                w->func = NULL;
+                session.removed = TRUE;
+                return;
+            }
+            session.watchers = g_slist_delete_link (session.watchers, l);
+            g_free (w);
+            break;
+        }
+    }
+
+    if (!session.watchers && session.cancellable)
+        session_stop ();
+}
+
+gboolean
+session_is_inactive (void)
+{
+    return session.inactive;
+}
@@ -0,0 +1,52 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * session.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Watches logind's LockedHint & IdleHint of the session we're in; The session
+ * is inactive when either is set. Watching starts with the first watcher added
+ * and stops after the last one is removed. Should logind not be around (or we
+ * not be part of a session), the session simply remains active.
+ *
+ * If SESSION_BUS_ENV is set to "session" logind is looked for on the session
+ * bus instead of the system one, so a stand-in service can be used.
+ *
+ * Main thread only. */
+
+#define SESSION_BUS_ENV     "STATUS_NOTIFIER_LOGIND_BUS"
+
+typedef void (*SessionFunc) (gboolean inactive, gpointer data);
+
+void                session_watch_add           (SessionFunc         func,
+                                                 gpointer            data);
+void                session_watch_remove        (SessionFunc         func,
+                                                 gpointer            data);
+gboolean            session_is_inactive         (void);
+
+G_END_DECLS
+
+#endif /* __SESSION_H__ */
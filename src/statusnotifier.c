@@ -23,21 +23,45 @@
 #include "config.h"
 
 #include <unistd.h>
-#include <gdk/gdk.h>
+#include <string.h>
 #include "statusnotifier.h"
 #include "enums.h"
 #include "interfaces.h"
 #include "closures.h"
+#include "pixmap.h"
+#include "render.h"
+#include "iconstore.h"
+#include "iconfile.h"
+#include "session.h"
+#include "counters.h"
+#include "pixmapfd.h"
+#include "trace.h"
+#if USE_MEMFD
+#include <gio/gunixfdlist.h>
+#endif
 
 #if USE_DBUSMENU
-#include <gtk/gtk.h>
-#include <libdbusmenu-glib/menuitem.h>
-#include <libdbusmenu-glib/server.h>
-#include <libdbusmenu-gtk/parser.h>
+#include <gmodule.h>
+#include "dbusmenu.h"
 #endif
 
 #define _UNUSED_                __attribute__ ((unused))
 
+/* USDT probes, see trace.h */
+TRACE_PROBE (dbus_notify_entry);
+TRACE_PROBE (dbus_notify_exit);
+TRACE_PROBE (method_call_entry);
+TRACE_PROBE (method_call_exit);
+TRACE_PROBE (pixmap_entry);
+TRACE_PROBE (pixmap_exit);
+TRACE_PROBE (get_prop_entry);
+TRACE_PROBE (get_prop_exit);
+TRACE_PROBE (register_item_cb);
+TRACE_PROBE (name_acquired);
+TRACE_PROBE (proxy_cb);
+TRACE_PROBE (watcher_appeared);
+TRACE_PROBE (group_register);
+
 /**
  * SECTION:statusnotifier
  * @Short_description: A StatusNotifierItem as per KDE's specifications
@@ -78,6 +102,30 @@
  * signals (such as #StatusNotifierItem::context-menu) which will be emitted
  * when the corresponding DBus method was called.
  *
+ * Next to the standard interface, the item's object also implements
+ * org.statusnotifier.Extension1, for hosts that know of it; Others simply keep
+ * using the standard properties. It has methods:
+ * - SetIconSizes, see status_notifier_item_set_max_icon_size()
+ * - GetIconDelta (property, since) -> (revision, full, sizes): for property
+ *   IconPixmap, OverlayIconPixmap or AttentionIconPixmap, returns only what
+ *   changed since revision @since, as rects (x, y, width, height, pixels, in
+ *   the same format as the property) for each size (width, height). If @since
+ *   is unknown (e.g. 0, or too old) or sizes changed, everything is sent and
+ *   full is %TRUE, the host should then drop what it had. Either way revision
+ *   is that of what the host now has, to use as @since on the next call (e.g.
+ *   after a NewIcon signal). After a host changes its sizes via SetIconSizes,
+ *   its next call for each property sends everything (at the current
+ *   revision); Changing max-icon-size starts a new revision, so everything is
+ *   sent again to all hosts.
+ * - GetIconPixmapFd (property) -> (fd, sizes): for the same properties, returns
+ *   a file descriptor to map instead of getting the pixels in the message, for
+ *   hosts on the same machine. It's a sealed (i.e. read-only, and of fixed
+ *   size) memfd holding the pixels (in the same format as the property) of each
+ *   size (width, height, offset). Fails with
+ *   org.freedesktop.DBus.Error.NotSupported if the connection can't pass file
+ *   descriptors, or statusnotifier was built without memfd support; Hosts then
+ *   use the property instead.
+ *
  * For reference, the specifications can be found at
  * https://freedesktop.org/wiki/Specifications/StatusNotifierItem/
  *
@@ -109,6 +157,14 @@ enum
     PROP_ITEM_IS_MENU,
     PROP_MENU,
     PROP_WINDOW_ID,
+    PROP_SCROLL_COALESCING,
+    PROP_BATCH_SIGNALS,
+    PROP_DEFER_WHEN_PASSIVE,
+    PROP_THROTTLE_WHEN_INACTIVE,
+    PROP_BACKGROUND_CONVERSION,
+    PROP_DISK_CACHE,
+    PROP_COMPOSITE_OVERLAY,
+    PROP_MAX_ICON_SIZE,
 
     PROP_STATE,
 
@@ -138,6 +194,62 @@ enum
     NB_SIGNALS
 };
 
+/* DBus signals of the item, see dbus_notify() */
+typedef enum
+{
+    DBUS_SIGNAL_NEW_TITLE = 0,
+    DBUS_SIGNAL_NEW_ICON,
+    DBUS_SIGNAL_NEW_ATTENTION_ICON,
+    DBUS_SIGNAL_NEW_OVERLAY_ICON,
+    DBUS_SIGNAL_NEW_TOOLTIP,
+    DBUS_SIGNAL_NEW_STATUS,
+    NB_DBUS_SIGNALS
+} DbusSignal;
+
+static const struct
+{
+    const gchar *name;
+    Counter counter;
+} dbus_signals[NB_DBUS_SIGNALS] = {
+    { "NewTitle",           COUNTER_SIGNAL_NEW_TITLE },
+    { "NewIcon",            COUNTER_SIGNAL_NEW_ICON },
+    { "NewAttentionIcon",   COUNTER_SIGNAL_NEW_ATTENTION_ICON },
+    { "NewOverlayIcon",     COUNTER_SIGNAL_NEW_OVERLAY_ICON },
+    { "NewToolTip",         COUNTER_SIGNAL_NEW_TOOLTIP },
+    { "NewStatus",          COUNTER_SIGNAL_NEW_STATUS }
+};
+
+/* frames of an animation, see status_notifier_item_set_animation() */
+typedef struct
+{
+    /* from the icon store, see icon_store_ref() */
+    GVariant **frames;
+    /* end of each frame, in ms since the start of the animation */
+    guint *ends;
+    guint nb_frames;
+    guint current;
+} Animation;
+
+/* sizes a host renders icons at, see SetIconSizes (none: all sizes) */
+typedef struct
+{
+    gint *sizes;
+    guint nb_sizes;
+    guint watch_id;
+    /* bits of icons whose next GetIconDelta must be full, i.e. not against
+     * what was sent at the previous sizes */
+    guint full;
+} HostSizes;
+
+/* pixmaps sent by GetIconDelta kept, per icon, to diff against */
+#define ICON_HISTORY        8
+
+typedef struct
+{
+    guint revision;
+    GVariant *pixmap;
+} IconRevision;
+
 struct _StatusNotifierItemPrivate
 {
     gchar *id;
@@ -150,6 +262,29 @@ struct _StatusNotifierItemPrivate
             gchar *icon_name;
             GdkPixbuf *pixbuf;
         };
+        /* a(iiay) ready to be sent, for icons set without a pixbuf (e.g.
+         * rendered), i.e. has_pixbuf is TRUE but pixbuf is NULL; For pixbufs,
+         * the one from the icon store (once needed), see icon_store_ref() */
+        GVariant *pixmap;
+        /* for graphs, pixmap is only a cache (NULL once outdated); The DBus
+         * signal is sent at most once per graph_interval (ms) */
+        RenderGraph *graph;
+        guint graph_interval;
+        gint64 graph_signaled;
+        /* bumped whenever the icon changes, so background conversions of a
+         * previous pixbuf know they're outdated; atomic */
+        gint generation;
+        /* bumped on each status_notifier_item_set_from_file_async(), so only
+         * the last one gets applied */
+        guint file_serial;
+        /* frames, pixmap then being (a ref on) the current one */
+        Animation *animation;
+        /* what GetIconDelta sent last (as served, before fit_pixmap()), newest
+         * at history_next - 1; Revisions start at 1, bumped on each pixmap
+         * seen there */
+        IconRevision history[ICON_HISTORY];
+        guint history_next;
+        guint revision;
     } icon[_NB_STATUS_NOTIFIER_ICONS];
     gchar *attention_movie_name;
     gchar *tooltip_title;
@@ -159,22 +294,101 @@ struct _StatusNotifierItemPrivate
 
     guint tooltip_freeze;
 
+    gint scroll_coalescing;
+    /* (64 bits so they can't overflow, clamped once emitted) */
+    gint64 scroll_delta[2];
+    StatusNotifierScrollOrientation scroll_first;
+    guint scroll_source;
+
+    gboolean batch_signals;
+
+    gboolean defer_passive;
+    /* DbusSignal bits, held back while Passive */
+    guint passive_signals;
+
+    gboolean throttle_inactive;
+    /* session locked/idle (only tracked when throttle_inactive) */
+    gboolean session_inactive;
+    /* DbusSignal bits, held back while session_inactive */
+    guint inactive_signals;
+
+    gboolean background_conversion;
+    gboolean disk_cache;
+    gboolean composite_overlay;
+    gint max_icon_size;
+    /* sender -> HostSizes, from SetIconSizes */
+    GHashTable *host_sizes;
+
+    /* pre-serialized (a(iiay)) main icon for each status, if any; And the
+     * icon store's pixmaps (one per size) it's made of, kept so they're
+     * shared/not converted again */
+    GVariant *status_icons[3];
+    GPtrArray *status_refs[3];
+
+    /* bits of icons (graphs) waiting on their DBus signal */
+    guint graph_dirty;
+    guint graph_source;
+
+    /* in the list of items driven by the animation timer */
+    gboolean animating;
+    /* whether the watcher has a host, once registered with an animation */
+    gboolean host_present;
+    /* StatusNotifierHostRegistered & StatusNotifierHostUnregistered */
+    guint host_watch_ids[2];
+
     StatusNotifierState state;
     guint dbus_watch_id;
     gulong dbus_sid;
     guint dbus_owner_id;
     guint dbus_reg_id;
+    guint dbus_uniq_id;
+    gchar *object_path;
     GDBusProxy *dbus_proxy;
 #if USE_DBUSMENU
-    DbusmenuServer *menu_service;
+    GObject *menu_service;
     GObject *menu;
 #endif
     GDBusConnection *dbus_conn;
     GError *dbus_err;
+    guint dbus_debug_reg_id;
+    guint dbus_ext_reg_id;
+
+    guint64 counters[NB_COUNTERS];
+    gint64 reg_start;
+
+    /* not a ref, the group holds one on us */
+    StatusNotifierItemGroup *group;
+    /* waiting on the group's watcher/proxy to register */
+    gboolean group_pending;
+    /* DbusSignal bits, while the group is frozen */
+    guint pending_signals;
+};
+
+struct _StatusNotifierItemGroupPrivate
+{
+    GPtrArray *items;
+    guint freeze;
+
+    guint dbus_watch_id;
+    gboolean dbus_proxy_pending;
+    GDBusProxy *dbus_proxy;
+    gulong dbus_sid;
+    gboolean host_registered;
 };
 
 static guint uniq_id = 0;
 
+#if USE_DBUSMENU
+static struct
+{
+    gboolean tried;
+    GModule *module;
+    DbusmenuIsMenuFunc is_menu;
+    DbusmenuServerNewFunc server_new;
+    DbusmenuSetMenuFunc set_menu;
+} dbusmenu = { FALSE, };
+#endif
+
 static GParamSpec *status_notifier_item_props[NB_PROPS] = { NULL, };
 static guint status_notifier_item_signals[NB_SIGNALS] = { 0, };
 
@@ -190,6 +404,15 @@ static void     status_notifier_item_get_property   (GObject            *object,
                                                      GValue             *value,
                                                      GParamSpec         *pspec);
 static void     status_notifier_item_finalize       (GObject            *object);
+static void     flush_scroll                        (StatusNotifierItem *sn);
+static GVariant *get_icon_pixmap                    (StatusNotifierItem *sn,
+                                                     StatusNotifierIcon  icon);
+static void     session_changed                     (gboolean            inactive,
+                                                     StatusNotifierItem *sn);
+static void     animation_update                    (StatusNotifierItem *sn);
+static void     animation_stop                      (StatusNotifierItem *sn);
+static void     icon_history_clear                  (StatusNotifierItem *sn);
+static void     batch_drop                          (StatusNotifierItem *sn);
 
 G_DEFINE_TYPE (StatusNotifierItem, status_notifier_item, G_TYPE_OBJECT)
 
@@ -515,6 +738,126 @@ status_notifier_item_class_init (StatusNotifierItemClass *klass)
                 0,
                 G_PARAM_READWRITE);
 
+    /**
+     * StatusNotifierItem:scroll-coalescing:
+     *
+     * Whether (and how) to coalesce Scroll requests: -1 to emit
+     * #StatusNotifierItem::scroll for each one (default), 0 to sum up the
+     * deltas of all requests received until the next main loop iteration, or
+     * the window (in milliseconds) over which deltas are summed up.
+     *
+     * See status_notifier_item_set_scroll_coalescing() for more.
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_SCROLL_COALESCING] =
+        g_param_spec_int ("scroll-coalescing", "scroll-coalescing",
+                "Aggregation window for scroll requests (ms); 0 for next "
+                "iteration, -1 to disable",
+                -1, G_MAXINT,
+                -1,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:batch-signals:
+     *
+     * Whether DBus signals are batched, see
+     * status_notifier_item_set_batch_signals()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_BATCH_SIGNALS] =
+        g_param_spec_boolean ("batch-signals", "batch-signals",
+                "Whether to batch DBus signals per main loop iteration",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:defer-when-passive:
+     *
+     * Whether DBus signals about icons & tooltip are held back while the
+     * status is %STATUS_NOTIFIER_STATUS_PASSIVE, see
+     * status_notifier_item_set_defer_when_passive()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_DEFER_WHEN_PASSIVE] =
+        g_param_spec_boolean ("defer-when-passive", "defer-when-passive",
+                "Whether to hold back icons & tooltip DBus signals while Passive",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:throttle-when-inactive:
+     *
+     * Whether DBus signals are held back while the session is locked or idle,
+     * see status_notifier_item_set_throttle_when_inactive()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_THROTTLE_WHEN_INACTIVE] =
+        g_param_spec_boolean ("throttle-when-inactive", "throttle-when-inactive",
+                "Whether to hold back DBus signals while the session is locked or idle",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:background-conversion:
+     *
+     * Whether pixbufs are converted for DBus in background threads, see
+     * status_notifier_item_set_background_conversion()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_BACKGROUND_CONVERSION] =
+        g_param_spec_boolean ("background-conversion", "background-conversion",
+                "Whether to convert pixbufs in background threads",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:disk-cache:
+     *
+     * Whether pixbufs converted for DBus are cached on disk, and shared with
+     * other processes, see status_notifier_item_set_disk_cache()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_DISK_CACHE] =
+        g_param_spec_boolean ("disk-cache", "disk-cache",
+                "Whether to cache converted pixbufs on disk",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:composite-overlay:
+     *
+     * Whether the overlay icon is drawn onto the main icon sent over DBus, for
+     * hosts ignoring overlays, see status_notifier_item_set_composite_overlay()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_COMPOSITE_OVERLAY] =
+        g_param_spec_boolean ("composite-overlay", "composite-overlay",
+                "Whether to draw the overlay icon onto the main icon",
+                FALSE,
+                G_PARAM_READWRITE);
+
+    /**
+     * StatusNotifierItem:max-icon-size:
+     *
+     * Largest width/height of icons sent over DBus, larger ones being
+     * downscaled; 0 for no limit. See status_notifier_item_set_max_icon_size()
+     *
+     * Since: @NEXT_VERSION@
+     */
+    status_notifier_item_props[PROP_MAX_ICON_SIZE] =
+        g_param_spec_int ("max-icon-size", "max-icon-size",
+                "Largest size of icons sent over DBus (0 for no limit)",
+                0, G_MAXINT,
+                0,
+                G_PARAM_READWRITE);
+
     /**
      * StatusNotifierItem:state:
      *
@@ -586,6 +929,9 @@ status_notifier_item_class_init (StatusNotifierItemClass *klass)
             2,
             G_TYPE_INT,
             G_TYPE_INT);
+    g_signal_set_va_marshaller (status_notifier_item_signals[SIGNAL_CONTEXT_MENU],
+            STATUS_NOTIFIER_TYPE_ITEM,
+            g_cclosure_user_marshal_BOOLEAN__INT_INTv);
 
     /**
      * StatusNotifierItem::activate:
@@ -612,6 +958,9 @@ status_notifier_item_class_init (StatusNotifierItemClass *klass)
             2,
             G_TYPE_INT,
             G_TYPE_INT);
+    g_signal_set_va_marshaller (status_notifier_item_signals[SIGNAL_ACTIVATE],
+            STATUS_NOTIFIER_TYPE_ITEM,
+            g_cclosure_user_marshal_BOOLEAN__INT_INTv);
 
     /**
      * StatusNotifierItem::secondary-activate:
@@ -640,6 +989,9 @@ status_notifier_item_class_init (StatusNotifierItemClass *klass)
             2,
             G_TYPE_INT,
             G_TYPE_INT);
+    g_signal_set_va_marshaller (status_notifier_item_signals[SIGNAL_SECONDARY_ACTIVATE],
+            STATUS_NOTIFIER_TYPE_ITEM,
+            g_cclosure_user_marshal_BOOLEAN__INT_INTv);
 
     /**
      * StatusNotifierItem::scroll:
@@ -658,11 +1010,14 @@ status_notifier_item_class_init (StatusNotifierItemClass *klass)
             G_STRUCT_OFFSET (StatusNotifierItemClass, scroll),
             g_signal_accumulator_true_handled,
             NULL,
-            g_cclosure_user_marshal_BOOLEAN__INT_INT,
+            g_cclosure_user_marshal_BOOLEAN__INT_ENUM,
             G_TYPE_BOOLEAN,
             2,
             G_TYPE_INT,
             TYPE_STATUS_NOTIFIER_SCROLL_ORIENTATION);
+    g_signal_set_va_marshaller (status_notifier_item_signals[SIGNAL_SCROLL],
+            STATUS_NOTIFIER_TYPE_ITEM,
+            g_cclosure_user_marshal_BOOLEAN__INT_ENUMv);
 
     g_type_class_add_private (klass, sizeof (StatusNotifierItemPrivate));
 }
@@ -672,6 +1027,7 @@ status_notifier_item_init (StatusNotifierItem *sn)
 {
     sn->priv = G_TYPE_INSTANCE_GET_PRIVATE (sn,
             STATUS_NOTIFIER_TYPE_ITEM, StatusNotifierItemPrivate);
+    sn->priv->scroll_coalescing = -1;
 }
 
 static void
@@ -749,6 +1105,30 @@ status_notifier_item_set_property (GObject            *object,
         case PROP_WINDOW_ID:
             status_notifier_item_set_window_id (sn, g_value_get_uint (value));
             break;
+        case PROP_SCROLL_COALESCING:
+            status_notifier_item_set_scroll_coalescing (sn, g_value_get_int (value));
+            break;
+        case PROP_BATCH_SIGNALS:
+            status_notifier_item_set_batch_signals (sn, g_value_get_boolean (value));
+            break;
+        case PROP_DEFER_WHEN_PASSIVE:
+            status_notifier_item_set_defer_when_passive (sn, g_value_get_boolean (value));
+            break;
+        case PROP_THROTTLE_WHEN_INACTIVE:
+            status_notifier_item_set_throttle_when_inactive (sn, g_value_get_boolean (value));
+            break;
+        case PROP_BACKGROUND_CONVERSION:
+            status_notifier_item_set_background_conversion (sn, g_value_get_boolean (value));
+            break;
+        case PROP_DISK_CACHE:
+            status_notifier_item_set_disk_cache (sn, g_value_get_boolean (value));
+            break;
+        case PROP_COMPOSITE_OVERLAY:
+            status_notifier_item_set_composite_overlay (sn, g_value_get_boolean (value));
+            break;
+        case PROP_MAX_ICON_SIZE:
+            status_notifier_item_set_max_icon_size (sn, g_value_get_int (value));
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
             break;
@@ -828,6 +1208,30 @@ status_notifier_item_get_property (GObject            *object,
         case PROP_WINDOW_ID:
             g_value_set_uint (value, priv->window_id);
             break;
+        case PROP_SCROLL_COALESCING:
+            g_value_set_int (value, priv->scroll_coalescing);
+            break;
+        case PROP_BATCH_SIGNALS:
+            g_value_set_boolean (value, priv->batch_signals);
+            break;
+        case PROP_DEFER_WHEN_PASSIVE:
+            g_value_set_boolean (value, priv->defer_passive);
+            break;
+        case PROP_THROTTLE_WHEN_INACTIVE:
+            g_value_set_boolean (value, priv->throttle_inactive);
+            break;
+        case PROP_BACKGROUND_CONVERSION:
+            g_value_set_boolean (value, priv->background_conversion);
+            break;
+        case PROP_DISK_CACHE:
+            g_value_set_boolean (value, priv->disk_cache);
+            break;
+        case PROP_COMPOSITE_OVERLAY:
+            g_value_set_boolean (value, priv->composite_overlay);
+            break;
+        case PROP_MAX_ICON_SIZE:
+            g_value_set_int (value, priv->max_icon_size);
+            break;
         case PROP_STATE:
             g_value_set_enum (value, priv->state);
             break;
@@ -837,23 +1241,59 @@ status_notifier_item_get_property (GObject            *object,
     }
 }
 
+static void
+animation_free (Animation *animation)
+{
+    guint i;
+
+    for (i = 0; i < animation->nb_frames; ++i)
+        icon_store_unref (animation->frames[i]);
+    g_free (animation->frames);
+    g_free (animation->ends);
+    g_slice_free (Animation, animation);
+}
+
 static void
 free_icon (StatusNotifierItem *sn, StatusNotifierIcon icon)
 {
     StatusNotifierItemPrivate *priv = sn->priv;
 
     if (priv->icon[icon].has_pixbuf)
-        g_object_unref (priv->icon[icon].pixbuf);
+    {
+        if (priv->icon[icon].pixbuf)
+            g_object_unref (priv->icon[icon].pixbuf);
+    }
     else
         g_free (priv->icon[icon].icon_name);
+    if (priv->icon[icon].pixmap)
+    {
+        if (priv->icon[icon].has_pixbuf && priv->icon[icon].pixbuf)
+            icon_store_unref (priv->icon[icon].pixmap);
+        else
+            g_variant_unref (priv->icon[icon].pixmap);
+    }
+    if (priv->icon[icon].graph)
+        render_graph_free (priv->icon[icon].graph);
     priv->icon[icon].has_pixbuf = FALSE;
     priv->icon[icon].icon_name = NULL;
+    priv->icon[icon].pixmap = NULL;
+    priv->icon[icon].graph = NULL;
+    priv->graph_dirty &= ~(1U << icon);
+    /* cancels any conversion in progress */
+    g_atomic_int_inc (&priv->icon[icon].generation);
+    /* (the item leaves the animation timer on its next tick) */
+    if (priv->icon[icon].animation)
+    {
+        animation_free (priv->icon[icon].animation);
+        priv->icon[icon].animation = NULL;
+    }
 }
 
 static void
 dbus_free (StatusNotifierItem *sn)
 {
     StatusNotifierItemPrivate *priv = sn->priv;
+    guint i;
 
     if (priv->dbus_watch_id > 0)
     {
@@ -887,16 +1327,43 @@ dbus_free (StatusNotifierItem *sn)
         priv->menu_service = NULL;
     }
 #endif
+    /* not to have signals of ours sent once gone (on a path maybe reused) */
+    if (priv->dbus_conn && priv->object_path)
+        batch_drop (sn);
     if (priv->dbus_reg_id > 0)
     {
         g_dbus_connection_unregister_object (priv->dbus_conn, priv->dbus_reg_id);
         priv->dbus_reg_id = 0;
     }
+    if (priv->dbus_debug_reg_id > 0)
+    {
+        g_dbus_connection_unregister_object (priv->dbus_conn, priv->dbus_debug_reg_id);
+        priv->dbus_debug_reg_id = 0;
+    }
+    if (priv->dbus_ext_reg_id > 0)
+    {
+        g_dbus_connection_unregister_object (priv->dbus_conn, priv->dbus_ext_reg_id);
+        priv->dbus_ext_reg_id = 0;
+    }
+    if (priv->host_sizes)
+    {
+        g_hash_table_unref (priv->host_sizes);
+        priv->host_sizes = NULL;
+    }
+    for (i = 0; i < G_N_ELEMENTS (priv->host_watch_ids); ++i)
+        if (priv->host_watch_ids[i] > 0)
+        {
+            g_dbus_connection_signal_unsubscribe (priv->dbus_conn,
+                    priv->host_watch_ids[i]);
+            priv->host_watch_ids[i] = 0;
+        }
     if (priv->dbus_conn)
     {
         g_object_unref (priv->dbus_conn);
         priv->dbus_conn = NULL;
     }
+    g_free (priv->object_path);
+    priv->object_path = NULL;
 }
 
 static void
@@ -906,79 +1373,342 @@ status_notifier_item_finalize (GObject *object)
     StatusNotifierItemPrivate *priv = sn->priv;
     guint i;
 
+    animation_stop (sn);
     g_free (priv->id);
     g_free (priv->title);
     for (i = 0; i < _NB_STATUS_NOTIFIER_ICONS; ++i)
         free_icon (sn, i);
+    icon_history_clear (sn);
     g_free (priv->attention_movie_name);
     g_free (priv->tooltip_title);
     g_free (priv->tooltip_body);
+    if (priv->scroll_source > 0)
+        g_source_remove (priv->scroll_source);
+    if (priv->graph_source > 0)
+        g_source_remove (priv->graph_source);
+    if (priv->throttle_inactive)
+        session_watch_remove ((SessionFunc) session_changed, sn);
+    for (i = 0; i < G_N_ELEMENTS (priv->status_icons); ++i)
+        if (priv->status_icons[i])
+        {
+            g_variant_unref (priv->status_icons[i]);
+            g_ptr_array_unref (priv->status_refs[i]);
+        }
 
     dbus_free (sn);
 
     G_OBJECT_CLASS (status_notifier_item_parent_class)->finalize (object);
 }
 
+/* Signals batching (opt-in, see #StatusNotifierItem:batch-signals): signals of
+ * all items sharing a connection are queued during a main loop iteration, then
+ * handed to GDBus all together from an idle source. A signal queued again
+ * (same object & signal) before that replaces the previous one, which is what
+ * saves messages (and writes, GDBus writing each message on its own). */
+
+#define BATCH_DATA_KEY      "statusnotifier-batch"
+
+struct batch
+{
+    /* not a ref, we're attached to it */
+    GDBusConnection *conn;
+    /* NULL for those dropped, see batch_drop() */
+    GPtrArray *messages;
+    /* "path\nsignal" -> index in messages */
+    GHashTable *index;
+    guint source;
+};
+
+static void
+batch_free (struct batch *batch)
+{
+    if (batch->source > 0)
+        g_source_remove (batch->source);
+    g_ptr_array_unref (batch->messages);
+    g_hash_table_unref (batch->index);
+    g_slice_free (struct batch, batch);
+}
+
 static void
-dbus_notify (StatusNotifierItem *sn, guint prop)
+batch_message_free (GDBusMessage *message)
+{
+    if (message)
+        g_object_unref (message);
+}
+
+static gboolean
+batch_send (struct batch *batch)
+{
+    guint i;
+
+    batch->source = 0;
+    for (i = 0; i < batch->messages->len; ++i)
+        if (batch->messages->pdata[i])
+            g_dbus_connection_send_message (batch->conn, batch->messages->pdata[i],
+                    G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, NULL);
+    g_ptr_array_set_size (batch->messages, 0);
+    g_hash_table_remove_all (batch->index);
+
+    g_dbus_connection_flush (batch->conn, NULL, NULL, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+/* removes the signals of @sn not yet sent */
+static void
+batch_drop (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    struct batch *batch;
+    GHashTableIter iter;
+    gpointer key, idx;
+    gchar *prefix;
+
+    batch = g_object_get_data ((GObject *) priv->dbus_conn, BATCH_DATA_KEY);
+    if (!batch)
+        return;
+
+    prefix = g_strconcat (priv->object_path, "\n", NULL);
+    g_hash_table_iter_init (&iter, batch->index);
+    while (g_hash_table_iter_next (&iter, &key, &idx))
+        if (g_str_has_prefix (key, prefix))
+        {
+            guint i = GPOINTER_TO_UINT (idx);
+
+            g_object_unref (batch->messages->pdata[i]);
+            batch->messages->pdata[i] = NULL;
+            g_hash_table_iter_remove (&iter);
+        }
+    g_free (prefix);
+}
+
+static void
+batch_queue (StatusNotifierItem *sn, const gchar *signal, GVariant *params)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    struct batch *batch;
+    GDBusMessage *message;
+    gpointer idx;
+    gchar *key;
+
+    batch = g_object_get_data ((GObject *) priv->dbus_conn, BATCH_DATA_KEY);
+    if (!batch)
+    {
+        batch = g_slice_new0 (struct batch);
+        batch->conn = priv->dbus_conn;
+        batch->messages = g_ptr_array_new_with_free_func (
+                (GDestroyNotify) batch_message_free);
+        batch->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        g_object_set_data_full ((GObject *) priv->dbus_conn, BATCH_DATA_KEY,
+                batch, (GDestroyNotify) batch_free);
+    }
+
+    message = g_dbus_message_new_signal (priv->object_path, ITEM_INTERFACE, signal);
+    if (params)
+        g_dbus_message_set_body (message, params);
+
+    key = g_strconcat (priv->object_path, "\n", signal, NULL);
+    if (g_hash_table_lookup_extended (batch->index, key, NULL, &idx))
+    {
+        guint i = GPOINTER_TO_UINT (idx);
+
+        g_object_unref (batch->messages->pdata[i]);
+        batch->messages->pdata[i] = message;
+        g_free (key);
+        counters_add (priv->counters, COUNTER_SIGNALS_COALESCED, 1);
+    }
+    else
+    {
+        g_hash_table_insert (batch->index, key, GUINT_TO_POINTER (batch->messages->len));
+        g_ptr_array_add (batch->messages, message);
+    }
+    counters_add (priv->counters, COUNTER_SIGNALS_BATCHED, 1);
+
+    if (batch->source == 0)
+        batch->source = g_idle_add_full (G_PRIORITY_DEFAULT,
+                (GSourceFunc) batch_send, batch, NULL);
+}
+
+static void
+dbus_emit (StatusNotifierItem *sn, DbusSignal dbus_signal)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    const gchar *signal = dbus_signals[dbus_signal].name;
+    GVariant *params = NULL;
+    gint64 start;
+    TRACE_MARK_BEGIN (mark);
+
+    start = g_get_monotonic_time ();
+    TRACE (dbus_notify_entry, priv->id, signal);
+    if (dbus_signal == DBUS_SIGNAL_NEW_STATUS)
+    {
+        const gchar const *s_status[] = {
+            "Passive",
+            "Active",
+            "NeedsAttention"
+        };
+        params = g_variant_new ("(s)", s_status[priv->status]);
+    }
+
+    if (priv->batch_signals)
+        batch_queue (sn, signal, params);
+    else
+        g_dbus_connection_emit_signal (priv->dbus_conn,
+                NULL,
+                priv->object_path,
+                ITEM_INTERFACE,
+                signal,
+                params,
+                NULL);
+
+    TRACE (dbus_notify_exit, priv->id, signal);
+    TRACE_MARK_END (mark, "dbus_notify", "%s: %s", priv->id, signal);
+    counters_add (priv->counters, dbus_signals[dbus_signal].counter, 1);
+    counters_add (priv->counters, COUNTER_TIME_SIGNALS,
+            (guint64) (g_get_monotonic_time () - start));
+}
+
+static void
+dbus_notify_signal (StatusNotifierItem *sn, DbusSignal dbus_signal)
 {
     StatusNotifierItemPrivate *priv = sn->priv;
-    const gchar *signal;
 
     if (priv->state !=  STATUS_NOTIFIER_STATE_REGISTERED)
+    {
+        counters_add (priv->counters, COUNTER_SIGNALS_DROPPED, 1);
+        return;
+    }
+
+    /* session locked/idle: only remember it, see session_catch_up() */
+    if (priv->session_inactive)
+    {
+        if (priv->inactive_signals & (1U << dbus_signal))
+            counters_add (priv->counters, COUNTER_SIGNALS_SUPPRESSED_COALESCED, 1);
+        priv->inactive_signals |= 1U << dbus_signal;
+        counters_add (priv->counters, COUNTER_SIGNALS_SUPPRESSED, 1);
         return;
+    }
+
+    /* Passive: only remember it, see passive_flush() */
+    if (priv->defer_passive && priv->status == STATUS_NOTIFIER_STATUS_PASSIVE
+            && dbus_signal != DBUS_SIGNAL_NEW_TITLE
+            && dbus_signal != DBUS_SIGNAL_NEW_STATUS)
+    {
+        if (priv->passive_signals & (1U << dbus_signal))
+            counters_add (priv->counters, COUNTER_SIGNALS_DEFERRED_COALESCED, 1);
+        priv->passive_signals |= 1U << dbus_signal;
+        counters_add (priv->counters, COUNTER_SIGNALS_DEFERRED, 1);
+        return;
+    }
+
+    /* group is frozen: only remember it, see group_flush() */
+    if (priv->group && priv->group->priv->freeze > 0)
+    {
+        priv->pending_signals |= 1U << dbus_signal;
+        counters_add (priv->counters, COUNTER_SIGNALS_FROZEN, 1);
+        return;
+    }
+
+    dbus_emit (sn, dbus_signal);
+}
+
+/* sends what was held back while Passive (or no longer is) */
+static void
+passive_flush (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    guint pending = priv->passive_signals;
+    guint i;
+
+    priv->passive_signals = 0;
+    for (i = 0; i < NB_DBUS_SIGNALS; ++i)
+        if (pending & (1U << i))
+        {
+            counters_add (priv->counters, COUNTER_SIGNALS_DEFERRED_SENT, 1);
+            dbus_notify_signal (sn, i);
+        }
+}
+
+/* session back to active: sends what was held back, as a single update */
+static void
+session_catch_up (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    guint pending = priv->inactive_signals;
+    StatusNotifierIcon icon;
+    gint64 now;
+    guint i;
+
+    priv->session_inactive = FALSE;
+    priv->inactive_signals = 0;
+    animation_update (sn);
+
+    /* dirty graphs already are in pending, see graph_schedule() */
+    now = g_get_monotonic_time ();
+    for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+        if (priv->graph_dirty & (1U << icon))
+            priv->icon[icon].graph_signaled = now;
+    priv->graph_dirty = 0;
+
+    if (pending == 0)
+        return;
+    counters_add (priv->counters, COUNTER_SESSION_CATCH_UPS, 1);
+    for (i = 0; i < NB_DBUS_SIGNALS; ++i)
+        if (pending & (1U << i))
+            dbus_notify_signal (sn, i);
+}
+
+static void
+session_changed (gboolean inactive, StatusNotifierItem *sn)
+{
+    if (inactive)
+    {
+        sn->priv->session_inactive = TRUE;
+        animation_update (sn);
+    }
+    else
+        session_catch_up (sn);
+}
+
+static void
+dbus_notify (StatusNotifierItem *sn, guint prop)
+{
+    DbusSignal dbus_signal;
 
     switch (prop)
     {
         case PROP_STATUS:
-            {
-                const gchar const *s_status[] = {
-                    "Passive",
-                    "Active",
-                    "NeedsAttention"
-                };
-                signal = "NewStatus";
-                g_dbus_connection_emit_signal (priv->dbus_conn,
-                        NULL,
-                        ITEM_OBJECT,
-                        ITEM_INTERFACE,
-                        signal,
-                        g_variant_new ("(s)", s_status[priv->status]),
-                        NULL);
-                return;
-            }
+            dbus_signal = DBUS_SIGNAL_NEW_STATUS;
+            break;
         case PROP_TITLE:
-            signal = "NewTitle";
+            dbus_signal = DBUS_SIGNAL_NEW_TITLE;
             break;
         case PROP_MAIN_ICON_NAME:
         case PROP_MAIN_ICON_PIXBUF:
-            signal = "NewIcon";
+            dbus_signal = DBUS_SIGNAL_NEW_ICON;
             break;
         case PROP_ATTENTION_ICON_NAME:
         case PROP_ATTENTION_ICON_PIXBUF:
-            signal = "NewAttentionIcon";
+            dbus_signal = DBUS_SIGNAL_NEW_ATTENTION_ICON;
             break;
         case PROP_OVERLAY_ICON_NAME:
         case PROP_OVERLAY_ICON_PIXBUF:
-            signal = "NewOverlayIcon";
+            dbus_signal = DBUS_SIGNAL_NEW_OVERLAY_ICON;
             break;
         case PROP_TOOLTIP_TITLE:
         case PROP_TOOLTIP_BODY:
         case PROP_TOOLTIP_ICON_NAME:
         case PROP_TOOLTIP_ICON_PIXBUF:
-            signal = "NewToolTip";
+            dbus_signal = DBUS_SIGNAL_NEW_TOOLTIP;
             break;
         default:
             g_return_if_reached ();
     }
 
-    g_dbus_connection_emit_signal (priv->dbus_conn,
-            NULL,
-            ITEM_OBJECT,
-            ITEM_INTERFACE,
-            signal,
-            NULL,
-            NULL);
+    dbus_notify_signal (sn, dbus_signal);
+    /* the overlay is part of IconPixmap */
+    if (dbus_signal == DBUS_SIGNAL_NEW_OVERLAY_ICON && sn->priv->composite_overlay
+            && sn->priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf)
+        dbus_notify_signal (sn, DBUS_SIGNAL_NEW_ICON);
 }
 
 /**
@@ -1056,23 +1786,150 @@ status_notifier_item_get_category (StatusNotifierItem      *sn)
     return sn->priv->category;
 }
 
-/**
- * status_notifier_item_set_from_pixbuf:
- * @sn: A #StatusNotifierItem
- * @icon: Which icon to set
- * @pixbuf: A #GdkPixbuf to use for @icon
- *
- * Sets the icon @icon to @pixbuf.
- *
- * An icon can either be identified by its Freedesktop-compliant icon name,
- * or by the icon data itself (via #GdkPixbuf).
- *
- * It is currently not possible to set both, as setting one will unset the
- * other.
- */
-void
-status_notifier_item_set_from_pixbuf (StatusNotifierItem      *sn,
-                                      StatusNotifierIcon       icon,
+/* Background conversion (opt-in, see #StatusNotifierItem:background-conversion):
+ * pixbufs are converted (via the icon store) by a process-wide pool of a few
+ * threads, the result then handed back to the item's main context, where it's
+ * cached in the slot and the DBus signal sent. A job whose slot has changed
+ * since is skipped (if not yet started) or its result dropped. */
+
+#define CONVERT_MAX_THREADS     4
+
+typedef struct
+{
+    /* refs */
+    StatusNotifierItem *sn;
+    GdkPixbuf *pixbuf;
+    GMainContext *context;
+    StatusNotifierIcon icon;
+    gint generation;
+    gboolean disk_cache;
+    /* result, NULL if skipped */
+    GVariant *pixmap;
+    IconStoreStats stats;
+} ConvertJob;
+
+static GThreadPool *convert_pool = NULL;
+
+/* main thread only */
+static void
+count_store_stats (StatusNotifierItem *sn, const IconStoreStats *stats)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    if (stats->hit)
+        counters_add (priv->counters, COUNTER_ICON_STORE_HITS, 1);
+    else if (stats->mapped)
+        counters_add (priv->counters, COUNTER_DISK_CACHE_HITS, 1);
+    else
+    {
+        counters_add (priv->counters, COUNTER_PIXMAP_CONVERSIONS, 1);
+        counters_add (priv->counters, COUNTER_PIXMAP_BYTES, stats->bytes);
+        counters_add (priv->counters, COUNTER_TIME_PIXMAP, (guint64) stats->convert_us);
+    }
+    if (stats->written)
+        counters_add (priv->counters, COUNTER_DISK_CACHE_WRITES, 1);
+}
+
+static gboolean
+convert_is_current (ConvertJob *job)
+{
+    return g_atomic_int_get (&job->sn->priv->icon[job->icon].generation)
+        == job->generation;
+}
+
+static void
+convert_job_free (ConvertJob *job)
+{
+    g_object_unref (job->sn);
+    g_object_unref (job->pixbuf);
+    g_main_context_unref (job->context);
+    g_slice_free (ConvertJob, job);
+}
+
+/* main context of the item */
+static gboolean
+convert_done (ConvertJob *job)
+{
+    StatusNotifierItem *sn = job->sn;
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierIcon icon = job->icon;
+
+    if (!job->pixmap || !convert_is_current (job))
+    {
+        counters_add (priv->counters, COUNTER_PIXMAP_CANCELLED, 1);
+        if (job->pixmap)
+            icon_store_unref (job->pixmap);
+        convert_job_free (job);
+        return G_SOURCE_REMOVE;
+    }
+
+    count_store_stats (sn, &job->stats);
+    counters_add (priv->counters, COUNTER_PIXMAP_BACKGROUND, 1);
+
+    /* a Get in the meantime might have converted it already */
+    if (priv->icon[icon].pixmap)
+        icon_store_unref (job->pixmap);
+    else
+        priv->icon[icon].pixmap = job->pixmap;
+
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+
+    convert_job_free (job);
+    return G_SOURCE_REMOVE;
+}
+
+/* pool thread */
+static void
+convert_run (ConvertJob *job, gpointer data _UNUSED_)
+{
+    if (convert_is_current (job))
+        job->pixmap = icon_store_ref (job->pixbuf, job->disk_cache, &job->stats);
+    g_main_context_invoke (job->context, (GSourceFunc) convert_done, job);
+}
+
+static void
+convert_start (StatusNotifierItem *sn, StatusNotifierIcon icon)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    ConvertJob *job;
+
+    if (G_UNLIKELY (!convert_pool))
+        convert_pool = g_thread_pool_new ((GFunc) convert_run, NULL,
+                (gint) CLAMP (g_get_num_processors (), 1, CONVERT_MAX_THREADS),
+                FALSE, NULL);
+
+    job = g_slice_new0 (ConvertJob);
+    job->sn = g_object_ref (sn);
+    job->pixbuf = g_object_ref (priv->icon[icon].pixbuf);
+    job->context = g_main_context_ref_thread_default ();
+    job->icon = icon;
+    job->generation = g_atomic_int_get (&priv->icon[icon].generation);
+    job->disk_cache = priv->disk_cache;
+
+    g_thread_pool_push (convert_pool, job, NULL);
+}
+
+/**
+ * status_notifier_item_set_from_pixbuf:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @pixbuf: A #GdkPixbuf to use for @icon
+ *
+ * Sets the icon @icon to @pixbuf.
+ *
+ * An icon can either be identified by its Freedesktop-compliant icon name,
+ * or by the icon data itself (via #GdkPixbuf).
+ *
+ * It is currently not possible to set both, as setting one will unset the
+ * other.
+ *
+ * If #StatusNotifierItem:background-conversion is %TRUE, the DBus signal is
+ * only sent once @pixbuf has been converted in a background thread.
+ */
+void
+status_notifier_item_set_from_pixbuf (StatusNotifierItem      *sn,
+                                      StatusNotifierIcon       icon,
                                       GdkPixbuf               *pixbuf)
 {
     StatusNotifierItemPrivate *priv;
@@ -1080,276 +1937,1727 @@ status_notifier_item_set_from_pixbuf (StatusNotifierItem      *sn,
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    free_icon (sn, icon);
-    priv->icon[icon].has_pixbuf = TRUE;
-    priv->icon[icon].pixbuf = g_object_ref (pixbuf);
+    free_icon (sn, icon);
+    priv->icon[icon].has_pixbuf = TRUE;
+    priv->icon[icon].pixbuf = g_object_ref (pixbuf);
+
+    notify (sn, prop_name_from_icon[icon]);
+    if (priv->background_conversion)
+        /* signal sent from convert_done() */
+        convert_start (sn, icon);
+    else if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+}
+
+/* status_notifier_item_set_from_file_async(): decoding is done by a GTask in
+ * a worker thread (with its own callback), the pixbuf then set from the main
+ * context before completing the caller's GTask. */
+
+typedef struct
+{
+    StatusNotifierIcon icon;
+    gchar *filename;
+    gint size;
+    gint generation;
+    guint file_serial;
+    IconFileStats stats;
+} FileLoad;
+
+static void
+file_load_free (FileLoad *load)
+{
+    g_free (load->filename);
+    g_slice_free (FileLoad, load);
+}
+
+/* worker thread */
+static void
+file_load_run (GTask                *thread,
+               gpointer              source _UNUSED_,
+               FileLoad             *load,
+               GCancellable         *cancellable)
+{
+    GError *error = NULL;
+    GdkPixbuf *pixbuf;
+
+    pixbuf = icon_file_load (load->filename, load->size, cancellable,
+            &load->stats, &error);
+    if (pixbuf)
+        g_task_return_pointer (thread, pixbuf, g_object_unref);
+    else
+        g_task_return_error (thread, error);
+}
+
+static void
+file_loaded (GObject *sce, GAsyncResult *result, GTask *task)
+{
+    StatusNotifierItem *sn = (StatusNotifierItem *) sce;
+    StatusNotifierItemPrivate *priv = sn->priv;
+    FileLoad *load = g_task_get_task_data (task);
+    GError *error = NULL;
+    GdkPixbuf *pixbuf;
+
+    pixbuf = g_task_propagate_pointer ((GTask *) result, &error);
+    if (!pixbuf)
+    {
+        g_task_return_error (task, error);
+        g_object_unref (task);
+        return;
+    }
+
+    if (load->stats.cached)
+        counters_add (priv->counters, COUNTER_FILE_CACHE_HITS, 1);
+    else
+    {
+        counters_add (priv->counters, COUNTER_FILE_DECODES, 1);
+        counters_add (priv->counters, COUNTER_TIME_FILE_DECODE,
+                (guint64) load->stats.decode_us);
+    }
+
+    /* don't overwrite anything set since */
+    if (g_atomic_int_get (&priv->icon[load->icon].generation) != load->generation
+            || priv->icon[load->icon].file_serial != load->file_serial)
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                "Icon was changed while loading '%s'", load->filename);
+    else
+    {
+        status_notifier_item_set_from_pixbuf (sn, load->icon, pixbuf);
+        g_task_return_boolean (task, TRUE);
+    }
+    g_object_unref (pixbuf);
+    g_object_unref (task);
+}
+
+/**
+ * status_notifier_item_set_from_file_async:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @filename: Name of the image file to load
+ * @size: Size (width & height) to scale the image to fit in, or -1
+ * @cancellable: (allow-none): A #GCancellable, or %NULL
+ * @callback: (scope async): Function to call when done
+ * @user_data: (closure): User data for @callback
+ *
+ * Sets the icon @icon to the image in @filename, loaded in a worker thread
+ * (as with gdk_pixbuf_new_from_file()) so the main loop isn't blocked on
+ * disk I/O or decoding. If @size isn't -1 the image is scaled (preserving its
+ * aspect ratio) to fit in a square of @size pixels.
+ *
+ * Loaded images are cached process-wide (by @filename, modification time and
+ * size of the file, and @size), so e.g. switching between a few icons only
+ * decodes each once; Should the file be modified, it is loaded again.
+ *
+ * Once loaded, the icon is set as with status_notifier_item_set_from_pixbuf()
+ * and @callback called; Use status_notifier_item_set_from_file_finish() to get
+ * the result. If @icon was changed in the meantime (including by another call
+ * to this function) it is left as is, and %G_IO_ERROR_CANCELLED returned.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_from_file_async (StatusNotifierItem      *sn,
+                                          StatusNotifierIcon       icon,
+                                          const gchar             *filename,
+                                          gint                     size,
+                                          GCancellable            *cancellable,
+                                          GAsyncReadyCallback      callback,
+                                          gpointer                 user_data)
+{
+    StatusNotifierItemPrivate *priv;
+    FileLoad *load;
+    GTask *task, *thread;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (filename != NULL);
+    g_return_if_fail (size == -1 || size > 0);
+    priv = sn->priv;
+
+    load = g_slice_new0 (FileLoad);
+    load->icon = icon;
+    load->filename = g_strdup (filename);
+    load->size = size;
+    load->generation = g_atomic_int_get (&priv->icon[icon].generation);
+    load->file_serial = ++priv->icon[icon].file_serial;
+
+    task = g_task_new (sn, cancellable, callback, user_data);
+    g_task_set_source_tag (task, status_notifier_item_set_from_file_async);
+    g_task_set_task_data (task, load, (GDestroyNotify) file_load_free);
+
+    thread = g_task_new (sn, cancellable, (GAsyncReadyCallback) file_loaded, task);
+    g_task_set_task_data (thread, load, NULL);
+    g_task_run_in_thread (thread, (GTaskThreadFunc) file_load_run);
+    g_object_unref (thread);
+}
+
+/**
+ * status_notifier_item_set_from_file_finish:
+ * @sn: A #StatusNotifierItem
+ * @result: The #GAsyncResult passed to the callback
+ * @error: (allow-none): Return location for a #GError, or %NULL
+ *
+ * Finishes an operation started with
+ * status_notifier_item_set_from_file_async()
+ *
+ * Returns: %TRUE if the icon was set, else %FALSE with @error set
+ *
+ * Since: @NEXT_VERSION@
+ */
+gboolean
+status_notifier_item_set_from_file_finish (StatusNotifierItem      *sn,
+                                           GAsyncResult            *result,
+                                           GError                 **error)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    g_return_val_if_fail (g_task_is_valid (result, sn), FALSE);
+    return g_task_propagate_boolean ((GTask *) result, error);
+}
+
+/**
+ * status_notifier_item_set_from_icon_name:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @icon_name: Name of an icon to use for @icon
+ *
+ * Sets the icon @icon to be @icon_name.
+ *
+ * An icon can either be identified by its Freedesktop-compliant icon name,
+ * or by the icon data itself (via #GdkPixbuf).
+ *
+ * It is currently not possible to set both, as setting one will unset the
+ * other.
+ */
+void
+status_notifier_item_set_from_icon_name (StatusNotifierItem      *sn,
+                                         StatusNotifierIcon       icon,
+                                         const gchar             *icon_name)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+
+    free_icon (sn, icon);
+    priv->icon[icon].icon_name = g_strdup (icon_name);
+
+    notify (sn, prop_pixbuf_from_icon[icon]);
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+}
+
+/* sets @icon to @pixmap, i.e. an a(iiay) ready to be sent as is (taking the
+ * reference) */
+static void
+set_pixmap (StatusNotifierItem     *sn,
+            StatusNotifierIcon      icon,
+            GVariant               *pixmap)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    /* same as already set, e.g. a count that didn't change */
+    if (priv->icon[icon].pixmap == pixmap)
+    {
+        g_variant_unref (pixmap);
+        return;
+    }
+
+    free_icon (sn, icon);
+    priv->icon[icon].has_pixbuf = TRUE;
+    priv->icon[icon].pixbuf = NULL;
+    priv->icon[icon].pixmap = pixmap;
+
+    notify (sn, prop_name_from_icon[icon]);
+    notify (sn, prop_pixbuf_from_icon[icon]);
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+}
+
+/* sets @icon to @pixmap (rendered, taking the reference) */
+static void
+set_icon_pixmap (StatusNotifierItem     *sn,
+                 StatusNotifierIcon      icon,
+                 GVariant               *pixmap,
+                 const RenderStats      *stats,
+                 gint64                  start)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    counters_add (priv->counters, (stats->cached)
+            ? COUNTER_RENDER_CACHE_HITS : COUNTER_RENDER_FRAMES, 1);
+    counters_add (priv->counters, COUNTER_RENDER_GLYPHS, stats->glyphs);
+    counters_add (priv->counters, COUNTER_TIME_RENDER,
+            (guint64) (g_get_monotonic_time () - start));
+
+    set_pixmap (sn, icon, pixmap);
+}
+
+/**
+ * status_notifier_item_set_from_resource:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @path: Path of the resource, as registered with g_resources_register()
+ * @error: (allow-none): Return location for a #GError, or %NULL
+ *
+ * Sets the icon @icon to the pixmaps in resource @path, as compiled at build
+ * time by statusnotifier-mkpixmaps from e.g. PNG or SVG files, at as many
+ * sizes as wanted (see <link linkend="statusnotifier-mkpixmaps">its
+ * documentation</link>, also for the format of the pixmaps).
+ *
+ * Those are already in the format sent over DBus, so they are published as
+ * they are: no image is decoded nor converted, and for resources compiled in
+ * the program no pixel data is copied either. This is thus the cheapest way to
+ * get an icon shown, e.g. on startup.
+ *
+ * Returns: %TRUE if the icon was set, else %FALSE with @error set (and @icon
+ * left as is)
+ *
+ * Since: @NEXT_VERSION@
+ */
+gboolean
+status_notifier_item_set_from_resource (StatusNotifierItem      *sn,
+                                        StatusNotifierIcon       icon,
+                                        const gchar             *path,
+                                        GError                 **error)
+{
+    GBytes *bytes;
+    GVariant *pixmap;
+    GVariantIter iter;
+    gint width, height;
+    GVariant *data;
+    gboolean valid = TRUE;
+
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+    g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+    bytes = g_resources_lookup_data (path, G_RESOURCE_LOOKUP_FLAGS_NONE, error);
+    if (!bytes)
+        return FALSE;
+    /* blobs are little-endian, see src/mkpixmaps.c; and not trusted to be in
+     * normal form, resources can come from anywhere (e.g. a file) */
+    pixmap = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a(iiay)"),
+                bytes, FALSE));
+    g_bytes_unref (bytes);
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    {
+        GVariant *swapped = g_variant_byteswap (pixmap);
+
+        g_variant_unref (pixmap);
+        pixmap = swapped;
+    }
+#endif
+
+    /* only the sizes are checked, the pixels are taken as they are */
+    g_variant_iter_init (&iter, pixmap);
+    while (valid && g_variant_iter_next (&iter, "(ii@ay)", &width, &height, &data))
+    {
+        valid = width > 0 && height > 0
+            && g_variant_get_size (data) == (gsize) width * (gsize) height * PIXMAP_BPP;
+        g_variant_unref (data);
+    }
+    if (!valid || g_variant_n_children (pixmap) == 0)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                "Invalid pixmaps in resource '%s'", path);
+        g_variant_unref (pixmap);
+        return FALSE;
+    }
+
+    counters_add (sn->priv->counters, COUNTER_RESOURCE_ICONS, 1);
+    set_pixmap (sn, icon, pixmap);
+    return TRUE;
+}
+
+/**
+ * status_notifier_item_set_from_text:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @text: The text to show
+ * @fg: Color of the text, as 0xAARRGGBB
+ * @bg: Color of the background, as 0xAARRGGBB (0 for none)
+ * @size: Width and height of the icon, in pixels
+ *
+ * Sets the icon @icon to @text drawn in @fg, as large as it fits, on a square
+ * of @bg; E.g. to show a temperature or a percentage.
+ *
+ * Such icons are rendered by statusnotifier directly in the format sent over
+ * DBus, from a built-in bitmap font which supports digits, letters (shown in
+ * uppercase), space and "!#%+-./:?" - anything else is shown as '?'. Rendered
+ * icons are cached by content, so getting back to a previous text is only a
+ * lookup, and setting the same text again does nothing.
+ *
+ * @size must be between 8 and 256.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_from_text (StatusNotifierItem      *sn,
+                                    StatusNotifierIcon       icon,
+                                    const gchar             *text,
+                                    guint32                  fg,
+                                    guint32                  bg,
+                                    gint                     size)
+{
+    RenderStats stats;
+    GVariant *pixmap;
+    gint64 start;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (text != NULL && g_utf8_validate (text, -1, NULL));
+    g_return_if_fail (size >= RENDER_MIN_SIZE && size <= RENDER_MAX_SIZE);
+
+    start = g_get_monotonic_time ();
+    pixmap = render_text (text, fg, bg, size, &stats);
+    set_icon_pixmap (sn, icon, pixmap, &stats, start);
+}
+
+/**
+ * status_notifier_item_set_from_badge:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @count: The count to show
+ * @fg: Color of the count, as 0xAARRGGBB
+ * @bg: Color of the badge, as 0xAARRGGBB
+ * @size: Width and height of the icon, in pixels
+ *
+ * Sets the icon @icon to a badge, i.e. a disc of @bg with @count drawn in @fg,
+ * or "99+" if @count is over 99; E.g. as %STATUS_NOTIFIER_OVERLAY_ICON to show
+ * a number of unread messages.
+ *
+ * See status_notifier_item_set_from_text() for more.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_from_badge (StatusNotifierItem      *sn,
+                                     StatusNotifierIcon       icon,
+                                     guint                    count,
+                                     guint32                  fg,
+                                     guint32                  bg,
+                                     gint                     size)
+{
+    RenderStats stats;
+    GVariant *pixmap;
+    gint64 start;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (size >= RENDER_MIN_SIZE && size <= RENDER_MAX_SIZE);
+
+    start = g_get_monotonic_time ();
+    pixmap = render_badge (count, fg, bg, size, &stats);
+    set_icon_pixmap (sn, icon, pixmap, &stats, start);
+}
+
+/**
+ * status_notifier_item_set_from_progress:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @fraction: The progress, from 0.0 to 1.0
+ * @fg: Color of the progress, as 0xAARRGGBB
+ * @bg: Color of the rest of the ring, as 0xAARRGGBB (0 for none)
+ * @size: Width and height of the icon, in pixels
+ *
+ * Sets the icon @icon to a progress ring of @bg, with @fraction of it (starting
+ * from the top, clockwise) in @fg.
+ *
+ * @fraction is rounded to what can actually be seen at @size, so that close
+ * values use the same icon (and setting it doesn't emit any DBus signal).
+ *
+ * See status_notifier_item_set_from_text() for more.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_from_progress (StatusNotifierItem      *sn,
+                                        StatusNotifierIcon       icon,
+                                        gdouble                  fraction,
+                                        guint32                  fg,
+                                        guint32                  bg,
+                                        gint                     size)
+{
+    RenderStats stats;
+    GVariant *pixmap;
+    gint64 start;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (size >= RENDER_MIN_SIZE && size <= RENDER_MAX_SIZE);
+
+    start = g_get_monotonic_time ();
+    pixmap = render_progress (fraction, fg, bg, size, &stats);
+    set_icon_pixmap (sn, icon, pixmap, &stats, start);
+}
+
+static gboolean graph_cb (StatusNotifierItem *sn);
+
+/* sends the DBus signal of graphs due for it, and schedules the others */
+static void
+graph_schedule (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierIcon icon;
+    gint64 now, next = G_MAXINT64;
+
+    if (priv->graph_source > 0)
+    {
+        g_source_remove (priv->graph_source);
+        priv->graph_source = 0;
+    }
+
+    /* session locked/idle: no timers, the signal is held back right away and
+     * graph_dirty kept, so further samples are simply coalesced until
+     * session_catch_up() */
+    if (priv->session_inactive)
+    {
+        for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+            if ((priv->graph_dirty & (1U << icon))
+                    && (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0))
+                dbus_notify (sn, prop_name_from_icon[icon]);
+        return;
+    }
+
+    now = g_get_monotonic_time ();
+    for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+    {
+        gint64 due;
+
+        if (!(priv->graph_dirty & (1U << icon)))
+            continue;
+
+        due = priv->icon[icon].graph_signaled
+            + (gint64) priv->icon[icon].graph_interval * G_TIME_SPAN_MILLISECOND;
+        if (due > now)
+        {
+            next = MIN (next, due);
+            continue;
+        }
+
+        priv->graph_dirty &= ~(1U << icon);
+        priv->icon[icon].graph_signaled = now;
+        if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+            dbus_notify (sn, prop_name_from_icon[icon]);
+    }
+
+    if (next != G_MAXINT64)
+        priv->graph_source = g_timeout_add (
+                (guint) ((next - now + G_TIME_SPAN_MILLISECOND - 1) / G_TIME_SPAN_MILLISECOND),
+                (GSourceFunc) graph_cb, sn);
+}
+
+static gboolean
+graph_cb (StatusNotifierItem *sn)
+{
+    sn->priv->graph_source = 0;
+    graph_schedule (sn);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * status_notifier_item_set_graph:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @min: The value shown as empty
+ * @max: The value shown as full
+ * @fg: Color of the graph, as 0xAARRGGBB
+ * @bg: Color of the background, as 0xAARRGGBB (0 for none)
+ * @size: Width and height of the icon, in pixels
+ * @interval: Minimum time between DBus signals, in milliseconds
+ *
+ * Sets the icon @icon to a (rolling) graph of the last @size samples, one
+ * column each, newest on the right, as added with
+ * status_notifier_item_push_sample(). It starts empty.
+ *
+ * Adding a sample only draws its column, the rest of the graph is kept as is
+ * (in the format sent over DBus) and only shifted.
+ *
+ * The DBus signal for @icon is then sent at most once every @interval, with
+ * samples added in between (if any) sent together after that; Use 0 for one
+ * signal per sample.
+ *
+ * @size must be between 8 and 256.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_graph (StatusNotifierItem      *sn,
+                                StatusNotifierIcon       icon,
+                                gdouble                  min,
+                                gdouble                  max,
+                                guint32                  fg,
+                                guint32                  bg,
+                                gint                     size,
+                                guint                    interval)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (min < max);
+    g_return_if_fail (size >= RENDER_MIN_SIZE && size <= RENDER_MAX_SIZE);
+    priv = sn->priv;
+
+    free_icon (sn, icon);
+    priv->icon[icon].has_pixbuf = TRUE;
+    priv->icon[icon].pixbuf = NULL;
+    priv->icon[icon].graph = render_graph_new (min, max, fg, bg, size);
+    priv->icon[icon].graph_interval = interval;
+    priv->icon[icon].graph_signaled = g_get_monotonic_time ();
+
+    notify (sn, prop_name_from_icon[icon]);
+    notify (sn, prop_pixbuf_from_icon[icon]);
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+}
+
+/**
+ * status_notifier_item_push_sample:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon
+ * @value: The value to add
+ *
+ * Adds @value to the graph of icon @icon, set using
+ * status_notifier_item_set_graph(), dropping the oldest one. Values outside
+ * of the graph's range are clamped.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_push_sample (StatusNotifierItem      *sn,
+                                  StatusNotifierIcon       icon,
+                                  gdouble                  value)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+    g_return_if_fail (priv->icon[icon].graph != NULL);
+
+    render_graph_push (priv->icon[icon].graph, value);
+    counters_add (priv->counters, COUNTER_GRAPH_SAMPLES, 1);
+    if (priv->icon[icon].pixmap)
+    {
+        g_variant_unref (priv->icon[icon].pixmap);
+        priv->icon[icon].pixmap = NULL;
+    }
+
+    notify (sn, prop_pixbuf_from_icon[icon]);
+    if (priv->graph_dirty & (1U << icon))
+    {
+        /* will go with the pending signal */
+        counters_add (priv->counters, COUNTER_GRAPH_COALESCED, 1);
+        return;
+    }
+    priv->graph_dirty |= 1U << icon;
+    graph_schedule (sn);
+}
+
+/* Animations: all animating items of the process are driven by a single timer,
+ * on a timeline shared from when the first one started. Each wakeup is at the
+ * next frame boundary of any of them, so animations with the same frame
+ * durations flip together on one wakeup. Items only animate while
+ * NeedsAttention, registered with a host present, and (with
+ * throttle-when-inactive) the session active; Else they're off the timer,
+ * showing their first frame. */
+
+#define ANIMATION_MIN_MS    20
+
+static GSList *animating = NULL;
+static guint animation_source = 0;
+static gint64 animation_epoch;
+
+static gboolean animation_cb (gpointer data);
+
+static void
+animation_show (StatusNotifierItem *sn, StatusNotifierIcon icon, guint frame)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    Animation *animation = priv->icon[icon].animation;
+
+    if (animation->current == frame)
+        return;
+    animation->current = frame;
+    g_variant_unref (priv->icon[icon].pixmap);
+    priv->icon[icon].pixmap = g_variant_ref (animation->frames[frame]);
+    counters_add (priv->counters, COUNTER_ANIMATION_FRAMES, 1);
+
+    /* (no GObject notify, frames aren't "set" by the app) */
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+}
+
+/* shows the current frame of all animating items, and sets the timer for the
+ * next frame boundary; Items that shouldn't animate anymore are dropped */
+static void
+animation_tick (void)
+{
+    GSList *l, *next;
+    gint64 now;
+    guint delay = G_MAXUINT;
+
+    if (animation_source > 0)
+    {
+        g_source_remove (animation_source);
+        animation_source = 0;
+    }
+
+    now = (g_get_monotonic_time () - animation_epoch) / G_TIME_SPAN_MILLISECOND;
+    for (l = animating; l; l = next)
+    {
+        StatusNotifierItem *sn = l->data;
+        StatusNotifierIcon icon;
+        gboolean has_animation = FALSE;
+
+        next = l->next;
+        for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+        {
+            Animation *animation = sn->priv->icon[icon].animation;
+            guint pos, frame;
+
+            if (!animation)
+                continue;
+            has_animation = TRUE;
+
+            pos = (guint) (now % animation->ends[animation->nb_frames - 1]);
+            for (frame = 0; pos >= animation->ends[frame]; ++frame)
+                ;
+            delay = MIN (delay, animation->ends[frame] - pos);
+            animation_show (sn, icon, frame);
+        }
+        if (!has_animation)
+            animation_update (sn);
+    }
+
+    if (animating)
+        animation_source = g_timeout_add (delay, animation_cb, NULL);
+}
+
+static gboolean
+animation_cb (gpointer data _UNUSED_)
+{
+    animation_source = 0;
+    animation_tick ();
+    return G_SOURCE_REMOVE;
+}
+
+static void
+animation_stop (StatusNotifierItem *sn)
+{
+    if (!sn->priv->animating)
+        return;
+    sn->priv->animating = FALSE;
+    animating = g_slist_remove (animating, sn);
+    if (!animating && animation_source > 0)
+    {
+        g_source_remove (animation_source);
+        animation_source = 0;
+    }
+}
+
+static void
+host_present_cb (GDBusConnection *conn, GAsyncResult *result, StatusNotifierItem *sn)
+{
+    GVariant *variant;
+
+    variant = g_dbus_connection_call_finish (conn, result, NULL);
+    if (variant)
+    {
+        GVariant *value;
+
+        g_variant_get (variant, "(v)", &value);
+        if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN))
+            sn->priv->host_present = g_variant_get_boolean (value);
+        g_variant_unref (value);
+        g_variant_unref (variant);
+        animation_update (sn);
+    }
+    g_object_unref (sn);
+}
+
+/* StatusNotifierHost(Un)Registered from the watcher */
+static void
+host_changed (GDBusConnection  *conn,
+              const gchar      *sender _UNUSED_,
+              const gchar      *path _UNUSED_,
+              const gchar      *interface _UNUSED_,
+              const gchar      *signal _UNUSED_,
+              GVariant         *params _UNUSED_,
+              gpointer          data)
+{
+    g_dbus_connection_call (conn,
+            WATCHER_NAME,
+            WATCHER_OBJECT,
+            "org.freedesktop.DBus.Properties",
+            "Get",
+            g_variant_new ("(ss)", WATCHER_INTERFACE, "IsStatusNotifierHostRegistered"),
+            G_VARIANT_TYPE ("(v)"),
+            G_DBUS_CALL_FLAGS_NONE,
+            -1, NULL,
+            (GAsyncReadyCallback) host_present_cb,
+            g_object_ref (data));
+}
+
+/* puts @sn on/off the animation timer as needed */
+static void
+animation_update (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    const gchar *host_signals[] = {
+        "StatusNotifierHostRegistered",
+        "StatusNotifierHostUnregistered"
+    };
+    StatusNotifierIcon icon;
+    guint i;
+    gboolean has_animation = FALSE;
+    gboolean wanted;
+
+    for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+        if (priv->icon[icon].animation)
+            has_animation = TRUE;
+
+    /* only watched once needed, as an item otherwise doesn't care */
+    if (has_animation && priv->state == STATUS_NOTIFIER_STATE_REGISTERED
+            && priv->dbus_conn && priv->host_watch_ids[0] == 0)
+        for (i = 0; i < G_N_ELEMENTS (host_signals); ++i)
+            priv->host_watch_ids[i] = g_dbus_connection_signal_subscribe (
+                    priv->dbus_conn,
+                    WATCHER_NAME,
+                    WATCHER_INTERFACE,
+                    host_signals[i],
+                    WATCHER_OBJECT,
+                    NULL,
+                    G_DBUS_SIGNAL_FLAGS_NONE,
+                    host_changed,
+                    sn, NULL);
+
+    wanted = has_animation
+        && priv->status == STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION
+        && priv->state == STATUS_NOTIFIER_STATE_REGISTERED
+        && priv->dbus_conn && priv->host_present
+        && !priv->session_inactive;
+
+    if (!wanted)
+    {
+        animation_stop (sn);
+        for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+            if (priv->icon[icon].animation)
+                animation_show (sn, icon, 0);
+        return;
+    }
+
+    if (!priv->animating)
+    {
+        if (!animating)
+            animation_epoch = g_get_monotonic_time ();
+        animating = g_slist_prepend (animating, sn);
+        priv->animating = TRUE;
+    }
+    animation_tick ();
+}
+
+/**
+ * status_notifier_item_set_animation:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon to set
+ * @frames: (array length=n_frames): The frames of the animation
+ * @durations: (array length=n_frames): How long to show each frame, in
+ * milliseconds
+ * @n_frames: Number of frames (and durations)
+ *
+ * Sets the icon @icon to an animation looping over @frames, e.g. a blinking
+ * %STATUS_NOTIFIER_ATTENTION_ICON, as an alternative to
+ * #StatusNotifierItem:attention-movie-name which many hosts ignore.
+ *
+ * All frames are converted right away to what's sent over DBus (through the
+ * same store as status_notifier_item_set_from_pixbuf(), so identical frames
+ * are only converted once), and no reference is kept on @frames. Each frame
+ * is then only a DBus signal.
+ *
+ * Animations only run while the status is
+ * %STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION and the item is registered with a
+ * host present (and, with #StatusNotifierItem:throttle-when-inactive, while the
+ * session is active); Else the first frame is shown. All animating items of the
+ * process share a single timer, aligned on frame boundaries: items animating
+ * with the same durations change frame together, on a shared timeline (so an
+ * animation starting while others run doesn't necessarily start on its first
+ * frame).
+ *
+ * Durations under 20ms are taken as 20ms.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_animation (StatusNotifierItem      *sn,
+                                    StatusNotifierIcon       icon,
+                                    GdkPixbuf              **frames,
+                                    const guint             *durations,
+                                    guint                    n_frames)
+{
+    StatusNotifierItemPrivate *priv;
+    Animation *animation;
+    IconStoreStats stats;
+    guint end = 0;
+    guint i;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (frames != NULL && durations != NULL && n_frames > 0);
+    priv = sn->priv;
+
+    animation = g_slice_new (Animation);
+    animation->frames = g_new (GVariant *, n_frames);
+    animation->ends = g_new (guint, n_frames);
+    animation->nb_frames = n_frames;
+    animation->current = 0;
+    for (i = 0; i < n_frames; ++i)
+    {
+        animation->frames[i] = icon_store_ref (frames[i], priv->disk_cache, &stats);
+        count_store_stats (sn, &stats);
+        end += MAX (durations[i], ANIMATION_MIN_MS);
+        animation->ends[i] = end;
+    }
+
+    free_icon (sn, icon);
+    priv->icon[icon].has_pixbuf = TRUE;
+    priv->icon[icon].pixbuf = NULL;
+    priv->icon[icon].pixmap = g_variant_ref (animation->frames[0]);
+    priv->icon[icon].animation = animation;
+
+    notify (sn, prop_name_from_icon[icon]);
+    notify (sn, prop_pixbuf_from_icon[icon]);
+    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
+        dbus_notify (sn, prop_name_from_icon[icon]);
+    animation_update (sn);
+}
+
+/**
+ * status_notifier_item_has_pixbuf:
+ * @sn: A #StatusNotifierItem
+ * @icon: Which icon
+ *
+ * Returns whether icon @icon currently has a #GdkPixbuf set or not. If so, the
+ * icon data will be sent via DBus, else the icon name (if any) will be used.
+ *
+ * This is also the case for icons rendered by statusnotifier, e.g. using
+ * status_notifier_item_set_from_text()
+ *
+ * Returns: %TRUE is a #GdkPixbuf is set for @icon, else %FALSE
+ */
+gboolean
+status_notifier_item_has_pixbuf (StatusNotifierItem      *sn,
+                                 StatusNotifierIcon       icon)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->icon[icon].has_pixbuf;
+}
+
+/**
+ * status_notifier_item_get_pixbuf:
+ * @sn: A #StatusNotifierItem
+ * @icon: The icon to get
+ *
+ * Returns the #GdkPixbuf set for @icon, if there's one. Not that it will return
+ * %NULL if an icon name is set.
+ *
+ * For icons rendered by statusnotifier (e.g. using
+ * status_notifier_item_set_from_text()) a new #GdkPixbuf is created from the
+ * icon data.
+ *
+ * Returns: (transfer full): The #GdkPixbuf set for @icon, or %NULL
+ */
+GdkPixbuf *
+status_notifier_item_get_pixbuf (StatusNotifierItem      *sn,
+                                 StatusNotifierIcon       icon)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    priv = sn->priv;
+
+    if (!priv->icon[icon].has_pixbuf)
+        return NULL;
+    if (!priv->icon[icon].pixbuf)
+    {
+        GdkPixbuf *pixbuf;
+        GVariant *pixmap;
+
+        pixmap = get_icon_pixmap (sn, icon);
+        pixbuf = pixmap_to_pixbuf (pixmap);
+        g_variant_unref (pixmap);
+        return pixbuf;
+    }
+
+    return g_object_ref (priv->icon[icon].pixbuf);
+}
+
+/**
+ * status_notifier_item_get_icon_name:
+ * @sn: A #StatusNotifierItem
+ * @icon: The icon to get
+ *
+ * Returns the icon name set for @icon, if there's one. Not that it will return
+ * %NULL if a #GdkPixbuf is set.
+ *
+ * Returns: (transfer full): A newly allocated string of the icon name set for
+ * @icon, free using g_free()
+ */
+gchar *
+status_notifier_item_get_icon_name (StatusNotifierItem      *sn,
+                                    StatusNotifierIcon       icon)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    priv = sn->priv;
+
+    if (priv->icon[icon].has_pixbuf)
+        return NULL;
+
+    return g_strdup (priv->icon[icon].icon_name);
+}
+
+/**
+ * status_notifier_item_set_attention_movie_name:
+ * @sn: A #StatusNotifierItem
+ * @movie_name: The name of the movie
+ *
+ * In addition to the icon, the item can also specify an animation associated to
+ * the #STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION status.
+ *
+ * This should be either a Freedesktop-compliant icon name or a full path.  The
+ * visualization can chose between the movie or icon (or using neither of those)
+ * at its discretion.
+ */
+void
+status_notifier_item_set_attention_movie_name (StatusNotifierItem      *sn,
+                                               const gchar             *movie_name)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+
+    g_free (priv->attention_movie_name);
+    priv->attention_movie_name = g_strdup (movie_name);
+
+    notify (sn, PROP_ATTENTION_MOVIE_NAME);
+}
+
+/**
+ * status_notifier_item_get_attention_movie_name:
+ * @sn: A #StatusNotifierItem
+ *
+ * Returns the movie name set for animation associated with the
+ * #STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION status
+ *
+ * Returns: A newly allocated string with the movie name, free using g_free()
+ * when done
+ */
+gchar *
+status_notifier_item_get_attention_movie_name (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    return g_strdup (sn->priv->attention_movie_name);
+}
+
+/**
+ * status_notifier_item_set_title:
+ * @sn: A #StatusNotifierItem
+ * @title: The title
+ *
+ * Sets the title of the item (might be used by visualization e.g. in menu of
+ * hidden items when #STATUS_NOTIFIER_STATUS_PASSIVE)
+ */
+void
+status_notifier_item_set_title (StatusNotifierItem      *sn,
+                                const gchar             *title)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+
+    g_free (priv->title);
+    priv->title = g_strdup (title);
+
+    notify (sn, PROP_TITLE);
+    dbus_notify (sn, PROP_TITLE);
+}
+
+/**
+ * status_notifier_item_get_title:
+ * @sn: A #StatusNotifierItem
+ *
+ * Returns the title of the item
+ *
+ * Returns: A newly allocated string, free with g_free() when done
+ */
+gchar *
+status_notifier_item_get_title (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    return g_strdup (sn->priv->title);
+}
+
+/* switches the main icon to the one for the current status, if any; Returns
+ * whether it did */
+static gboolean
+status_icon_apply (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    GVariant *pixmap = priv->status_icons[priv->status];
+
+    if (!pixmap || priv->icon[STATUS_NOTIFIER_ICON].pixmap == pixmap)
+        return FALSE;
+
+    free_icon (sn, STATUS_NOTIFIER_ICON);
+    priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf = TRUE;
+    priv->icon[STATUS_NOTIFIER_ICON].pixbuf = NULL;
+    priv->icon[STATUS_NOTIFIER_ICON].pixmap = g_variant_ref (pixmap);
+    counters_add (priv->counters, COUNTER_STATUS_ICON_SWITCHES, 1);
+
+    notify (sn, PROP_MAIN_ICON_NAME);
+    notify (sn, PROP_MAIN_ICON_PIXBUF);
+    return TRUE;
+}
+
+/**
+ * status_notifier_item_set_status_icon:
+ * @sn: A #StatusNotifierItem
+ * @status: The status to set the icon for
+ * @pixbufs: (array length=n_pixbufs) (allow-none): The main icon to use for
+ * @status, possibly in different sizes
+ * @n_pixbufs: Number of #GdkPixbuf in @pixbufs
+ *
+ * Sets the main icon to be used whenever the status is @status, e.g. a grey
+ * icon for %STATUS_NOTIFIER_STATUS_PASSIVE and a colored one for
+ * %STATUS_NOTIFIER_STATUS_ACTIVE. Use %NULL (or no pixbufs) to remove it.
+ *
+ * @pixbufs are converted right away to what's sent over DBus (all sizes, for
+ * the host to pick from), through the icon store (so icons already converted,
+ * e.g. used by another item, or in the disk cache if enabled, aren't converted
+ * again), and no reference is kept on them. They must be RGB, with 8 bits per
+ * sample (and alpha or not) as when loaded by #GdkPixbuf. Changing the status
+ * then only switches the main icon to it, and #StatusNotifierItem:status and
+ * #StatusNotifierItem:main-icon-pixbuf are updated together (both DBus signals
+ * being sent one after the other, with the new icon in place).
+ *
+ * The main icon can still be set as usual, e.g. using
+ * status_notifier_item_set_from_pixbuf(), which lasts until the status changes
+ * to one with an icon set using this function.
+ *
+ * If @status is the current status, the main icon is switched right away.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_status_icon (StatusNotifierItem      *sn,
+                                      StatusNotifierStatus     status,
+                                      GdkPixbuf              **pixbufs,
+                                      guint                    n_pixbufs)
+{
+    StatusNotifierItemPrivate *priv;
+    GPtrArray *refs;
+    GVariant **children;
+    guint i;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail ((guint) status < G_N_ELEMENTS (sn->priv->status_icons));
+    g_return_if_fail (pixbufs != NULL || n_pixbufs == 0);
+    for (i = 0; i < n_pixbufs; ++i)
+    {
+        g_return_if_fail (GDK_IS_PIXBUF (pixbufs[i]));
+        g_return_if_fail (gdk_pixbuf_get_colorspace (pixbufs[i]) == GDK_COLORSPACE_RGB);
+        g_return_if_fail (gdk_pixbuf_get_bits_per_sample (pixbufs[i]) == 8);
+        g_return_if_fail (gdk_pixbuf_get_n_channels (pixbufs[i])
+                == ((gdk_pixbuf_get_has_alpha (pixbufs[i])) ? 4 : 3));
+    }
+    priv = sn->priv;
+
+    /* new ones first, so icons set again are found in the store */
+    refs = NULL;
+    children = NULL;
+    if (n_pixbufs > 0)
+    {
+        refs = g_ptr_array_new_full (n_pixbufs, (GDestroyNotify) icon_store_unref);
+        children = g_new (GVariant *, n_pixbufs);
+    }
+    for (i = 0; i < n_pixbufs; ++i)
+    {
+        IconStoreStats stats;
+        GVariant *pixmap;
+
+        pixmap = icon_store_ref (pixbufs[i], priv->disk_cache, &stats);
+        count_store_stats (sn, &stats);
+        g_ptr_array_add (refs, pixmap);
+        /* the store's are a(iiay) of one */
+        children[i] = g_variant_get_child_value (pixmap, 0);
+    }
+
+    if (priv->status_icons[status])
+    {
+        g_variant_unref (priv->status_icons[status]);
+        priv->status_icons[status] = NULL;
+        g_ptr_array_unref (priv->status_refs[status]);
+        priv->status_refs[status] = NULL;
+    }
+    if (n_pixbufs == 0)
+        return;
+
+    priv->status_icons[status] = g_variant_ref_sink (g_variant_new_array (
+                G_VARIANT_TYPE ("(iiay)"), children, n_pixbufs));
+    priv->status_refs[status] = refs;
+    for (i = 0; i < n_pixbufs; ++i)
+        g_variant_unref (children[i]);
+    g_free (children);
+
+    if (status == priv->status && status_icon_apply (sn))
+        dbus_notify (sn, PROP_MAIN_ICON_PIXBUF);
+}
+
+/**
+ * status_notifier_item_set_status:
+ * @sn: A #StatusNotifierItem
+ * @status: The new status
+ *
+ * Sets the item status to @status, describing the status of this item or of the
+ * associated application.
+ */
+void
+status_notifier_item_set_status (StatusNotifierItem      *sn,
+                                 StatusNotifierStatus     status)
+{
+    StatusNotifierItemPrivate *priv;
+    gboolean switched;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail ((guint) status < G_N_ELEMENTS (sn->priv->status_icons));
+    priv = sn->priv;
+
+    priv->status = status;
+
+    notify (sn, PROP_STATUS);
+    /* switch to the pre-serialized icon first, so hosts reacting to NewStatus
+     * already get it */
+    switched = status_icon_apply (sn);
+    dbus_notify (sn, PROP_STATUS);
+    /* (unless it was held back, then it's flushed below) */
+    if (switched && !(priv->passive_signals & (1U << DBUS_SIGNAL_NEW_ICON)))
+        dbus_notify (sn, PROP_MAIN_ICON_PIXBUF);
+    if (status != STATUS_NOTIFIER_STATUS_PASSIVE)
+        passive_flush (sn);
+    animation_update (sn);
+}
+
+/**
+ * status_notifier_item_get_status:
+ * @sn: A #StatusNotifierItem
+ *
+ * Returns the status of @sn
+ *
+ * Returns: Current status of @sn
+ */
+StatusNotifierStatus
+status_notifier_item_get_status (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), -1);
+    return sn->priv->status;
+}
+
+/**
+ * status_notifier_item_set_window_id:
+ * @sn: A #StatusNotifierItem
+ * @window_id: The window ID
+ *
+ * Sets the window ID for @sn
+ *
+ * It's the windowing-system dependent identifier for a window, the application
+ * can chose one of its windows to be available trough this property or just set
+ * 0 if it's not interested.
+ */
+void
+status_notifier_item_set_window_id (StatusNotifierItem      *sn,
+                                    guint32                  window_id)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+
+    priv->window_id = window_id;
 
-    notify (sn, prop_name_from_icon[icon]);
-    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
-        dbus_notify (sn, prop_name_from_icon[icon]);
+    notify (sn, PROP_WINDOW_ID);
 }
 
 /**
- * status_notifier_item_set_from_icon_name:
+ * status_notifier_item_get_window_id:
  * @sn: A #StatusNotifierItem
- * @icon: Which icon to set
- * @icon_name: Name of an icon to use for @icon
  *
- * Sets the icon @icon to be @icon_name.
+ * Returns the windowing-system dependent idnetifier for a window associated
+ * with @sn
  *
- * An icon can either be identified by its Freedesktop-compliant icon name,
- * or by the icon data itself (via #GdkPixbuf).
+ * Returns: The window ID associated with @sn
+ */
+guint32
+status_notifier_item_get_window_id (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), 0);
+    return sn->priv->window_id;
+}
+
+/**
+ * status_notifier_item_set_scroll_coalescing:
+ * @sn: A #StatusNotifierItem
+ * @window: The aggregation window, in milliseconds; 0 for the next main loop
+ * iteration, -1 to disable coalescing
  *
- * It is currently not possible to set both, as setting one will unset the
- * other.
+ * Sets whether Scroll requests should be coalesced. By default (@window -1)
+ * #StatusNotifierItem::scroll is emitted for each Scroll request received.
+ *
+ * Otherwise, deltas are summed up (per orientation) over @window milliseconds
+ * after the first request (or until the next main loop iteration if @window is
+ * 0) and a single #StatusNotifierItem::scroll is then emitted per orientation.
+ * This is useful with high-resolution wheels or touchpads sending bursts of
+ * small deltas. Requests are always replied to right away.
+ *
+ * Disabling coalescing emits whatever was pending.
+ *
+ * Since: @NEXT_VERSION@
  */
 void
-status_notifier_item_set_from_icon_name (StatusNotifierItem      *sn,
-                                         StatusNotifierIcon       icon,
-                                         const gchar             *icon_name)
+status_notifier_item_set_scroll_coalescing (StatusNotifierItem      *sn,
+                                            gint                     window)
 {
     StatusNotifierItemPrivate *priv;
 
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (window >= -1);
     priv = sn->priv;
 
-    free_icon (sn, icon);
-    priv->icon[icon].icon_name = g_strdup (icon_name);
+    if (priv->scroll_coalescing == window)
+        return;
 
-    notify (sn, prop_pixbuf_from_icon[icon]);
-    if (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0)
-        dbus_notify (sn, prop_name_from_icon[icon]);
+    priv->scroll_coalescing = window;
+    /* emit what's pending, the new window will apply to the next requests */
+    if (priv->scroll_source > 0)
+        flush_scroll (sn);
+
+    notify (sn, PROP_SCROLL_COALESCING);
 }
 
 /**
- * status_notifier_item_has_pixbuf:
+ * status_notifier_item_get_scroll_coalescing:
  * @sn: A #StatusNotifierItem
- * @icon: Which icon
  *
- * Returns whether icon @icon currently has a #GdkPixbuf set or not. If so, the
- * icon data will be sent via DBus, else the icon name (if any) will be used.
+ * Returns the aggregation window for Scroll requests, see
+ * status_notifier_item_set_scroll_coalescing()
  *
- * Returns: %TRUE is a #GdkPixbuf is set for @icon, else %FALSE
+ * Returns: The aggregation window in milliseconds, 0 for the next main loop
+ * iteration, or -1 if coalescing is disabled
+ *
+ * Since: @NEXT_VERSION@
+ */
+gint
+status_notifier_item_get_scroll_coalescing (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), -1);
+    return sn->priv->scroll_coalescing;
+}
+
+/**
+ * status_notifier_item_set_batch_signals:
+ * @sn: A #StatusNotifierItem
+ * @batch: Whether to batch DBus signals
+ *
+ * Sets whether DBus signals (e.g. NewIcon, NewToolTip) for @sn are batched.
+ * By default each signal is emitted right away, and handed over to the DBus
+ * connection on its own.
+ *
+ * When batching, signals of all items sharing the connection (and batching)
+ * are queued during the current main loop iteration, and sent at its end.
+ * Should the same signal be emitted again for @sn before that, only the last
+ * one is sent. This is meant for applications updating items repeatedly (e.g.
+ * title and icon in a loop), sparing hosts the intermediate states. Signals
+ * that aren't repeated are still sent as one message (and one write) each.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_batch_signals (StatusNotifierItem      *sn,
+                                        gboolean                 batch)
+{
+    StatusNotifierItemPrivate *priv;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    priv = sn->priv;
+
+    batch = !!batch;
+    if (priv->batch_signals == batch)
+        return;
+
+    priv->batch_signals = batch;
+    notify (sn, PROP_BATCH_SIGNALS);
+}
+
+/**
+ * status_notifier_item_get_batch_signals:
+ * @sn: A #StatusNotifierItem
+ *
+ * Returns whether DBus signals for @sn are batched, see
+ * status_notifier_item_set_batch_signals()
+ *
+ * Returns: %TRUE if DBus signals are batched
+ *
+ * Since: @NEXT_VERSION@
  */
 gboolean
-status_notifier_item_has_pixbuf (StatusNotifierItem      *sn,
-                                 StatusNotifierIcon       icon)
+status_notifier_item_get_batch_signals (StatusNotifierItem      *sn)
 {
     g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
-    return sn->priv->icon[icon].has_pixbuf;
+    return sn->priv->batch_signals;
 }
 
 /**
- * status_notifier_item_get_pixbuf:
+ * status_notifier_item_set_defer_when_passive:
  * @sn: A #StatusNotifierItem
- * @icon: The icon to get
+ * @defer: Whether to hold back DBus signals while Passive
  *
- * Returns the #GdkPixbuf set for @icon, if there's one. Not that it will return
- * %NULL if an icon name is set.
+ * Sets whether DBus signals about icons (main, overlay & attention) and the
+ * tooltip are held back while the status is
+ * %STATUS_NOTIFIER_STATUS_PASSIVE, as hosts usually hide such items.
  *
- * Returns: (transfer full): The #GdkPixbuf set for @icon, or %NULL
+ * Changes are still applied locally, but hosts will only be told (and
+ * therefore fetch icons) once the status changes to
+ * %STATUS_NOTIFIER_STATUS_ACTIVE or %STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION,
+ * when all that was held back is sent along with NewStatus, each signal only
+ * once.
+ *
+ * Disabling it sends whatever was held back.
+ *
+ * Since: @NEXT_VERSION@
  */
-GdkPixbuf *
-status_notifier_item_get_pixbuf (StatusNotifierItem      *sn,
-                                 StatusNotifierIcon       icon)
+void
+status_notifier_item_set_defer_when_passive (StatusNotifierItem      *sn,
+                                             gboolean                 defer)
 {
     StatusNotifierItemPrivate *priv;
 
-    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    if (!priv->icon[icon].has_pixbuf)
-        return NULL;
+    defer = !!defer;
+    if (priv->defer_passive == defer)
+        return;
 
-    return g_object_ref (priv->icon[icon].pixbuf);
+    priv->defer_passive = defer;
+    if (!defer)
+        passive_flush (sn);
+    notify (sn, PROP_DEFER_WHEN_PASSIVE);
 }
 
 /**
- * status_notifier_item_get_icon_name:
+ * status_notifier_item_get_defer_when_passive:
  * @sn: A #StatusNotifierItem
- * @icon: The icon to get
  *
- * Returns the icon name set for @icon, if there's one. Not that it will return
- * %NULL if a #GdkPixbuf is set.
+ * Returns whether DBus signals about icons & tooltip are held back while
+ * Passive, see status_notifier_item_set_defer_when_passive()
  *
- * Returns: (transfer full): A newly allocated string of the icon name set for
- * @icon, free using g_free()
+ * Returns: %TRUE if DBus signals are held back while Passive
+ *
+ * Since: @NEXT_VERSION@
  */
-gchar *
-status_notifier_item_get_icon_name (StatusNotifierItem      *sn,
-                                    StatusNotifierIcon       icon)
+gboolean
+status_notifier_item_get_defer_when_passive (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->defer_passive;
+}
+
+/**
+ * status_notifier_item_set_throttle_when_inactive:
+ * @sn: A #StatusNotifierItem
+ * @throttle: Whether to hold back DBus signals while the session is inactive
+ *
+ * Sets whether all DBus signals are held back while the session is locked or
+ * idle (as per logind's LockedHint and IdleHint), when nothing is shown
+ * anyways, to avoid waking up hosts (and the item itself, as graphs aren't
+ * rate-limited via timers then) for nothing.
+ *
+ * Changes are still applied locally, and each signal that was held back is
+ * sent once as the session becomes active again, so hosts catch up in a single
+ * update.
+ *
+ * If logind isn't available, the session is always considered active.
+ * Disabling it sends whatever was held back.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_set_throttle_when_inactive (StatusNotifierItem      *sn,
+                                                 gboolean                 throttle)
 {
     StatusNotifierItemPrivate *priv;
 
-    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    if (priv->icon[icon].has_pixbuf)
-        return NULL;
+    throttle = !!throttle;
+    if (priv->throttle_inactive == throttle)
+        return;
 
-    return g_strdup (priv->icon[icon].icon_name);
+    priv->throttle_inactive = throttle;
+    if (throttle)
+    {
+        session_watch_add ((SessionFunc) session_changed, sn);
+        priv->session_inactive = session_is_inactive ();
+        /* already inactive: pause running animations right away */
+        if (priv->session_inactive)
+            animation_update (sn);
+    }
+    else
+    {
+        session_watch_remove ((SessionFunc) session_changed, sn);
+        session_catch_up (sn);
+    }
+    notify (sn, PROP_THROTTLE_WHEN_INACTIVE);
 }
 
 /**
- * status_notifier_item_set_attention_movie_name:
+ * status_notifier_item_get_throttle_when_inactive:
  * @sn: A #StatusNotifierItem
- * @movie_name: The name of the movie
  *
- * In addition to the icon, the item can also specify an animation associated to
- * the #STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION status.
+ * Returns whether DBus signals are held back while the session is locked or
+ * idle, see status_notifier_item_set_throttle_when_inactive()
  *
- * This should be either a Freedesktop-compliant icon name or a full path.  The
- * visualization can chose between the movie or icon (or using neither of those)
- * at its discretion.
+ * Returns: %TRUE if DBus signals are held back while the session is inactive
+ *
+ * Since: @NEXT_VERSION@
+ */
+gboolean
+status_notifier_item_get_throttle_when_inactive (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->throttle_inactive;
+}
+
+/**
+ * status_notifier_item_set_background_conversion:
+ * @sn: A #StatusNotifierItem
+ * @background: Whether to convert pixbufs in background threads
+ *
+ * Sets whether pixbufs set via status_notifier_item_set_from_pixbuf() are
+ * converted (into the format used over DBus) right away in background threads,
+ * instead of on the main thread when hosts first ask for them. This avoids
+ * stalling the main loop, and all DBus calls, on large icons.
+ *
+ * The DBus signal for the icon is then only sent once it is ready; Setting the
+ * icon again before that cancels the conversion of the previous one.
+ *
+ * Since: @NEXT_VERSION@
  */
 void
-status_notifier_item_set_attention_movie_name (StatusNotifierItem      *sn,
-                                               const gchar             *movie_name)
+status_notifier_item_set_background_conversion (StatusNotifierItem      *sn,
+                                                gboolean                 background)
 {
     StatusNotifierItemPrivate *priv;
 
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    g_free (priv->attention_movie_name);
-    priv->attention_movie_name = g_strdup (movie_name);
+    background = !!background;
+    if (priv->background_conversion == background)
+        return;
 
-    notify (sn, PROP_ATTENTION_MOVIE_NAME);
+    priv->background_conversion = background;
+    notify (sn, PROP_BACKGROUND_CONVERSION);
 }
 
 /**
- * status_notifier_item_get_attention_movie_name:
+ * status_notifier_item_get_background_conversion:
  * @sn: A #StatusNotifierItem
  *
- * Returns the movie name set for animation associated with the
- * #STATUS_NOTIFIER_STATUS_NEEDS_ATTENTION status
+ * Returns whether pixbufs are converted in background threads, see
+ * status_notifier_item_set_background_conversion()
  *
- * Returns: A newly allocated string with the movie name, free using g_free()
- * when done
+ * Returns: %TRUE if pixbufs are converted in background threads
+ *
+ * Since: @NEXT_VERSION@
  */
-gchar *
-status_notifier_item_get_attention_movie_name (StatusNotifierItem      *sn)
+gboolean
+status_notifier_item_get_background_conversion (StatusNotifierItem      *sn)
 {
-    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
-    return g_strdup (sn->priv->attention_movie_name);
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->background_conversion;
 }
 
 /**
- * status_notifier_item_set_title:
+ * status_notifier_item_set_disk_cache:
  * @sn: A #StatusNotifierItem
- * @title: The title
+ * @disk_cache: Whether to cache converted pixbufs on disk
  *
- * Sets the title of the item (might be used by visualization e.g. in menu of
- * hidden items when #STATUS_NOTIFIER_STATUS_PASSIVE)
+ * Sets whether pixbufs, once converted into the format used over DBus, are
+ * also cached on disk (in directory statusnotifier/pixmaps of the user's cache
+ * directory, i.e. usually ~/.cache), one file per icon, named after a hash of
+ * its pixels and its size.
+ *
+ * Icons found there (and matching the pixbuf, which is checked) are then
+ * mapped in memory (read-only) instead of being converted, so processes using
+ * the same icons (e.g. multiple instances of an application) share that
+ * memory. Loading them is faster than converting, though not free, as checking
+ * them reads all the pixels.
+ *
+ * The least recently used files are removed once the directory holds more
+ * than 32 MiB (as checked on the first write of the process, then
+ * periodically, so it can go over for a while); they can also safely be
+ * removed at any time.
+ *
+ * Since: @NEXT_VERSION@
  */
 void
-status_notifier_item_set_title (StatusNotifierItem      *sn,
-                                const gchar             *title)
+status_notifier_item_set_disk_cache (StatusNotifierItem      *sn,
+                                     gboolean                 disk_cache)
 {
     StatusNotifierItemPrivate *priv;
 
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    g_free (priv->title);
-    priv->title = g_strdup (title);
+    disk_cache = !!disk_cache;
+    if (priv->disk_cache == disk_cache)
+        return;
 
-    notify (sn, PROP_TITLE);
-    dbus_notify (sn, PROP_TITLE);
+    priv->disk_cache = disk_cache;
+    notify (sn, PROP_DISK_CACHE);
 }
 
 /**
- * status_notifier_item_get_title:
+ * status_notifier_item_get_disk_cache:
  * @sn: A #StatusNotifierItem
  *
- * Returns the title of the item
+ * Returns whether converted pixbufs are cached on disk, see
+ * status_notifier_item_set_disk_cache()
  *
- * Returns: A newly allocated string, free with g_free() when done
+ * Returns: %TRUE if converted pixbufs are cached on disk
+ *
+ * Since: @NEXT_VERSION@
  */
-gchar *
-status_notifier_item_get_title (StatusNotifierItem      *sn)
+gboolean
+status_notifier_item_get_disk_cache (StatusNotifierItem      *sn)
 {
-    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
-    return g_strdup (sn->priv->title);
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->disk_cache;
 }
 
 /**
- * status_notifier_item_set_status:
+ * status_notifier_item_set_composite_overlay:
  * @sn: A #StatusNotifierItem
- * @status: The new status
+ * @composite_overlay: Whether to draw the overlay icon onto the main icon
  *
- * Sets the item status to @status, describing the status of this item or of the
- * associated application.
+ * Sets whether the overlay icon (%STATUS_NOTIFIER_OVERLAY_ICON) is drawn, at
+ * half size in the bottom-right corner, onto the main icon as sent over DBus
+ * (IconPixmap), for hosts that don't draw overlays. The overlay is still sent
+ * as usual as well, and the main icon itself (e.g.
+ * #StatusNotifierItem:main-icon-pixbuf) is left as is.
+ *
+ * This is only done when both icons are set from pixbufs (or rendered), not
+ * icon names. Composites are done in the format sent over DBus, and cached per
+ * (main icon, overlay icon) pair, so going back to a previous overlay (e.g.
+ * toggling between a few badges) is only a lookup.
+ *
+ * Since: @NEXT_VERSION@
  */
 void
-status_notifier_item_set_status (StatusNotifierItem      *sn,
-                                 StatusNotifierStatus     status)
+status_notifier_item_set_composite_overlay (StatusNotifierItem      *sn,
+                                            gboolean                 composite_overlay)
 {
     StatusNotifierItemPrivate *priv;
 
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    priv->status = status;
+    composite_overlay = !!composite_overlay;
+    if (priv->composite_overlay == composite_overlay)
+        return;
 
-    notify (sn, PROP_STATUS);
-    dbus_notify (sn, PROP_STATUS);
+    priv->composite_overlay = composite_overlay;
+    notify (sn, PROP_COMPOSITE_OVERLAY);
+    if (priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf
+            && priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].has_pixbuf)
+        dbus_notify (sn, PROP_MAIN_ICON_PIXBUF);
 }
 
 /**
- * status_notifier_item_get_status:
+ * status_notifier_item_get_composite_overlay:
  * @sn: A #StatusNotifierItem
  *
- * Returns the status of @sn
+ * Returns whether the overlay icon is drawn onto the main icon, see
+ * status_notifier_item_set_composite_overlay()
  *
- * Returns: Current status of @sn
+ * Returns: %TRUE if the overlay icon is drawn onto the main icon
+ *
+ * Since: @NEXT_VERSION@
  */
-StatusNotifierStatus
-status_notifier_item_get_status (StatusNotifierItem      *sn)
+gboolean
+status_notifier_item_get_composite_overlay (StatusNotifierItem      *sn)
 {
-    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), -1);
-    return sn->priv->status;
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
+    return sn->priv->composite_overlay;
 }
 
 /**
- * status_notifier_item_set_window_id:
+ * status_notifier_item_set_max_icon_size:
  * @sn: A #StatusNotifierItem
- * @window_id: The window ID
+ * @max_icon_size: Largest width/height of icons sent over DBus, or 0
+ *
+ * Sets the largest width/height of icons sent over DBus: larger ones (from
+ * pixbufs or otherwise) are downscaled to fit, when sent. Use 0 (the default)
+ * for no limit.
+ *
+ * Hosts can also tell the sizes they render icons at, using method
+ * SetIconSizes (taking an array of sizes, in pixels) of interface
+ * org.statusnotifier.Extension1 on the item's object; They then only get, for
+ * each of those, the nearest size available (downscaled as needed) instead of
+ * all of them. Calling it again replaces those sizes, and an empty array goes
+ * back to all sizes.
  *
- * Sets the window ID for @sn
+ * Downscaled icons are cached (per icon & sizes), so only done once.
  *
- * It's the windowing-system dependent identifier for a window, the application
- * can chose one of its windows to be available trough this property or just set
- * 0 if it's not interested.
+ * Since: @NEXT_VERSION@
  */
 void
-status_notifier_item_set_window_id (StatusNotifierItem      *sn,
-                                    guint32                  window_id)
+status_notifier_item_set_max_icon_size (StatusNotifierItem      *sn,
+                                        gint                     max_icon_size)
 {
     StatusNotifierItemPrivate *priv;
+    StatusNotifierIcon icon;
 
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (max_icon_size >= 0);
     priv = sn->priv;
 
-    priv->window_id = window_id;
+    if (priv->max_icon_size == max_icon_size)
+        return;
 
-    notify (sn, PROP_WINDOW_ID);
+    priv->max_icon_size = max_icon_size;
+    icon_history_clear (sn);
+    notify (sn, PROP_MAX_ICON_SIZE);
+    for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+        if (priv->icon[icon].has_pixbuf
+                && (icon != STATUS_NOTIFIER_TOOLTIP_ICON || priv->tooltip_freeze == 0))
+            dbus_notify (sn, prop_name_from_icon[icon]);
 }
 
 /**
- * status_notifier_item_get_window_id:
+ * status_notifier_item_get_max_icon_size:
  * @sn: A #StatusNotifierItem
  *
- * Returns the windowing-system dependent idnetifier for a window associated
- * with @sn
+ * Returns the largest width/height of icons sent over DBus, see
+ * status_notifier_item_set_max_icon_size()
  *
- * Returns: The window ID associated with @sn
+ * Returns: The largest size of icons sent over DBus, or 0 for no limit
+ *
+ * Since: @NEXT_VERSION@
  */
-guint32
-status_notifier_item_get_window_id (StatusNotifierItem      *sn)
+gint
+status_notifier_item_get_max_icon_size (StatusNotifierItem      *sn)
 {
     g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), 0);
-    return sn->priv->window_id;
+    return sn->priv->max_icon_size;
 }
 
 /**
@@ -1529,6 +3837,73 @@ status_notifier_item_get_tooltip_body (StatusNotifierItem      *sn)
     return g_strdup (sn->priv->tooltip_body);
 }
 
+static void
+flush_scroll (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierScrollOrientation orientation[2];
+    gint delta[2];
+    gboolean ret;
+    guint i;
+
+    if (priv->scroll_source > 0)
+    {
+        g_source_remove (priv->scroll_source);
+        priv->scroll_source = 0;
+    }
+
+    /* in the order they came in; reset first in case handlers iterate the main
+     * loop (and more requests come in) */
+    orientation[0] = priv->scroll_first;
+    orientation[1] = (priv->scroll_first == STATUS_NOTIFIER_SCROLL_ORIENTATION_VERTICAL)
+        ? STATUS_NOTIFIER_SCROLL_ORIENTATION_HORIZONTAL
+        : STATUS_NOTIFIER_SCROLL_ORIENTATION_VERTICAL;
+    for (i = 0; i < 2; ++i)
+    {
+        delta[i] = (gint) CLAMP (priv->scroll_delta[orientation[i]],
+                G_MININT, G_MAXINT);
+        priv->scroll_delta[orientation[i]] = 0;
+    }
+
+    g_object_ref (sn);
+    for (i = 0; i < 2; ++i)
+    {
+        if (delta[i] == 0)
+            continue;
+        counters_add (priv->counters, COUNTER_SCROLL_EMITTED, 1);
+        g_signal_emit (sn, status_notifier_item_signals[SIGNAL_SCROLL], 0,
+                delta[i], orientation[i], &ret);
+    }
+    g_object_unref (sn);
+}
+
+static gboolean
+scroll_cb (StatusNotifierItem *sn)
+{
+    sn->priv->scroll_source = 0;
+    flush_scroll (sn);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+queue_scroll (StatusNotifierItem               *sn,
+              gint                              delta,
+              StatusNotifierScrollOrientation   orientation)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    if (priv->scroll_source == 0)
+    {
+        priv->scroll_first = orientation;
+        if (priv->scroll_coalescing == 0)
+            priv->scroll_source = g_idle_add ((GSourceFunc) scroll_cb, sn);
+        else
+            priv->scroll_source = g_timeout_add ((guint) priv->scroll_coalescing,
+                    (GSourceFunc) scroll_cb, sn);
+    }
+    priv->scroll_delta[orientation] += delta;
+}
+
 static void
 method_call (GDBusConnection        *conn _UNUSED_,
              const gchar            *sender _UNUSED_,
@@ -1543,6 +3918,9 @@ method_call (GDBusConnection        *conn _UNUSED_,
     guint signal;
     gint x, y;
     gboolean ret;
+    TRACE_MARK_BEGIN (mark);
+
+    TRACE (method_call_entry, sn->priv->id, method);
 
     if (!g_strcmp0 (method, "ContextMenu"))
         signal = SIGNAL_CONTEXT_MENU;
@@ -1562,9 +3940,18 @@ method_call (GDBusConnection        *conn _UNUSED_,
             orientation = STATUS_NOTIFIER_SCROLL_ORIENTATION_HORIZONTAL;
         g_free (s_orientation);
 
-        g_signal_emit (sn, status_notifier_item_signals[SIGNAL_SCROLL], 0,
-                delta, orientation, &ret);
+        counters_add (sn->priv->counters, COUNTER_SCROLL_CALLS, 1);
+        if (sn->priv->scroll_coalescing < 0)
+        {
+            counters_add (sn->priv->counters, COUNTER_SCROLL_EMITTED, 1);
+            g_signal_emit (sn, status_notifier_item_signals[SIGNAL_SCROLL], 0,
+                    delta, orientation, &ret);
+        }
+        else
+            queue_scroll (sn, delta, orientation);
         g_dbus_method_invocation_return_value (invocation, NULL);
+        TRACE (method_call_exit, sn->priv->id, method);
+        TRACE_MARK_END (mark, "method_call", "%s: %s", sn->priv->id, method);
         return;
     }
     else
@@ -1574,166 +3961,631 @@ method_call (GDBusConnection        *conn _UNUSED_,
     g_variant_get (params, "(ii)", &x, &y);
     g_signal_emit (sn, status_notifier_item_signals[signal], 0, x, y, &ret);
     g_dbus_method_invocation_return_value (invocation, NULL);
+    TRACE (method_call_exit, sn->priv->id, method);
+    TRACE_MARK_END (mark, "method_call", "%s: %s", sn->priv->id, method);
+}
+
+/* returns a new reference to the a(iiay) for @icon, empty if not set from a
+ * pixbuf (or rendered) */
+static GVariant *
+get_icon_pixmap (StatusNotifierItem *sn, StatusNotifierIcon icon)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    IconStoreStats stats;
+    TRACE_MARK_BEGIN (mark);
+
+    if (!priv->icon[icon].has_pixbuf)
+        return g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("(iiay)"),
+                    NULL, 0));
+    if (priv->icon[icon].pixmap)
+        return g_variant_ref (priv->icon[icon].pixmap);
+    if (priv->icon[icon].graph)
+    {
+        priv->icon[icon].pixmap = render_graph_get_pixmap (priv->icon[icon].graph);
+        return g_variant_ref (priv->icon[icon].pixmap);
+    }
+
+    TRACE (pixmap_entry, priv->id, icon,
+            gdk_pixbuf_get_width (priv->icon[icon].pixbuf),
+            gdk_pixbuf_get_height (priv->icon[icon].pixbuf));
+    /* only converted if no other slot/item has the same pixels */
+    priv->icon[icon].pixmap = icon_store_ref (priv->icon[icon].pixbuf,
+            priv->disk_cache, &stats);
+    TRACE (pixmap_exit, priv->id, icon,
+            gdk_pixbuf_get_width (priv->icon[icon].pixbuf),
+            gdk_pixbuf_get_height (priv->icon[icon].pixbuf),
+            stats.bytes);
+    TRACE_MARK_END (mark, "pixmap", "%s: icon %d, %dx%d%s",
+            priv->id, icon,
+            gdk_pixbuf_get_width (priv->icon[icon].pixbuf),
+            gdk_pixbuf_get_height (priv->icon[icon].pixbuf),
+            (stats.hit) ? " (stored)" : (stats.mapped) ? " (mapped)" : "");
+
+    count_store_stats (sn, &stats);
+    return g_variant_ref (priv->icon[icon].pixmap);
+}
+
+/* returns a new reference to the a(iiay) for the main icon, with the overlay
+ * drawn onto it if composite-overlay (and both are pixmaps) */
+static GVariant *
+get_main_pixmap (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    GVariant *base, *overlay, *pixmap;
+    RenderStats stats;
+    gint64 start;
+
+    base = get_icon_pixmap (sn, STATUS_NOTIFIER_ICON);
+    if (!priv->composite_overlay
+            || !priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf
+            || !priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].has_pixbuf)
+        return base;
+
+    start = g_get_monotonic_time ();
+    overlay = get_icon_pixmap (sn, STATUS_NOTIFIER_OVERLAY_ICON);
+    pixmap = render_overlay (base, overlay, &stats);
+    g_variant_unref (base);
+    g_variant_unref (overlay);
+
+    counters_add (priv->counters, (stats.cached)
+            ? COUNTER_OVERLAY_CACHE_HITS : COUNTER_OVERLAY_COMPOSITES, 1);
+    counters_add (priv->counters, COUNTER_TIME_RENDER,
+            (guint64) (g_get_monotonic_time () - start));
+    return pixmap;
+}
+
+/* returns what's actually sent for @pixmap (taken) to @sender: only the sizes
+ * it asked for (see SetIconSizes), if any, and none over max-icon-size */
+static GVariant *
+fit_pixmap (StatusNotifierItem *sn, GVariant *pixmap, const gchar *sender)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    HostSizes *host = NULL;
+    RenderStats stats;
+    GVariant *fitted;
+    gint64 start;
+
+    if (priv->host_sizes && sender)
+        host = g_hash_table_lookup (priv->host_sizes, sender);
+    if (host && host->nb_sizes == 0)
+        host = NULL;
+    if (!host && priv->max_icon_size == 0)
+        return pixmap;
+
+    start = g_get_monotonic_time ();
+    fitted = render_fit (pixmap, (host) ? host->sizes : NULL,
+            (host) ? host->nb_sizes : 0, priv->max_icon_size, &stats);
+    g_variant_unref (pixmap);
+
+    if (stats.cached)
+        counters_add (priv->counters, COUNTER_FIT_CACHE_HITS, 1);
+    else if (stats.bytes > 0)
+    {
+        counters_add (priv->counters, COUNTER_FIT_DOWNSCALES, 1);
+        counters_add (priv->counters, COUNTER_TIME_RENDER,
+                (guint64) (g_get_monotonic_time () - start));
+    }
+    return fitted;
+}
+
+/* returns either a floating GVariant or a new reference, GDBus handles both */
+static GVariant *
+get_prop_value (StatusNotifierItem *sn, const gchar *property, const gchar *sender)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    if (!g_strcmp0 (property, "Id"))
+        return g_variant_new ("s", priv->id);
+    else if (!g_strcmp0 (property, "Category"))
+    {
+        const gchar const *s_category[] = {
+            "ApplicationStatus",
+            "Communications",
+            "SystemServices",
+            "Hardware"
+        };
+        return g_variant_new ("s", s_category[priv->category]);
+    }
+    else if (!g_strcmp0 (property, "Title"))
+        return g_variant_new ("s", (priv->title) ? priv->title : "");
+    else if (!g_strcmp0 (property, "Status"))
+    {
+        const gchar const *s_status[] = {
+            "Passive",
+            "Active",
+            "NeedsAttention"
+        };
+        return g_variant_new ("s", s_status[priv->status]);
+    }
+    else if (!g_strcmp0 (property, "WindowId"))
+        return g_variant_new ("i", priv->window_id);
+    else if (!g_strcmp0 (property, "IconName"))
+        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf)
+                ? ((priv->icon[STATUS_NOTIFIER_ICON].icon_name)
+                    ? priv->icon[STATUS_NOTIFIER_ICON].icon_name : "") : "");
+    else if (!g_strcmp0 (property, "IconPixmap"))
+        return fit_pixmap (sn, get_main_pixmap (sn), sender);
+    else if (!g_strcmp0 (property, "OverlayIconName"))
+        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].has_pixbuf)
+                ? ((priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].icon_name)
+                    ? priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].icon_name : "") : "");
+    else if (!g_strcmp0 (property, "OverlayIconPixmap"))
+        return fit_pixmap (sn, get_icon_pixmap (sn, STATUS_NOTIFIER_OVERLAY_ICON),
+                sender);
+    else if (!g_strcmp0 (property, "AttentionIconName"))
+        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].has_pixbuf)
+                ? ((priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].icon_name)
+                    ? priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].icon_name : "") : "");
+    else if (!g_strcmp0 (property, "AttentionIconPixmap"))
+        return fit_pixmap (sn, get_icon_pixmap (sn, STATUS_NOTIFIER_ATTENTION_ICON),
+                sender);
+    else if (!g_strcmp0 (property, "AttentionMovieName"))
+        return g_variant_new ("s", (priv->attention_movie_name)
+                ? priv->attention_movie_name : "");
+    else if (!g_strcmp0 (property, "ToolTip"))
+    {
+        GVariant *variant;
+        GVariant *pixmap;
+
+        if (!priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].has_pixbuf)
+        {
+            variant = g_variant_new ("(sa(iiay)ss)",
+                    (priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].icon_name)
+                    ? priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].icon_name : "",
+                    NULL,
+                    (priv->tooltip_title) ? priv->tooltip_title : "",
+                    (priv->tooltip_body) ? priv->tooltip_body : "");
+            return variant;
+        }
+
+        pixmap = fit_pixmap (sn, get_icon_pixmap (sn, STATUS_NOTIFIER_TOOLTIP_ICON),
+                sender);
+        variant = g_variant_new ("(s@a(iiay)ss)",
+                "",
+                pixmap,
+                (priv->tooltip_title) ? priv->tooltip_title : "",
+                (priv->tooltip_body) ? priv->tooltip_body : "");
+        g_variant_unref (pixmap);
+
+        return variant;
+    }
+    else if (!g_strcmp0 (property, "ItemIsMenu"))
+        return g_variant_new ("b", priv->item_is_menu);
+    else if (!g_strcmp0 (property, "Menu"))
+    {
+#if USE_DBUSMENU
+        if (priv->menu_service != NULL)
+        {
+            GVariant *var;
+            gchar *path;
+
+            g_object_get (priv->menu_service,
+                    DBUSMENU_PROP_DBUS_OBJECT, &path,
+                    NULL);
+            var = g_variant_new ("o", path);
+            g_free (path);
+            return var;
+        }
+        else
+#endif
+            return g_variant_new ("o", "/NO_DBUSMENU");
+    }
+
+    g_return_val_if_reached (NULL);
+}
+
+static GVariant *
+get_prop (GDBusConnection        *conn _UNUSED_,
+          const gchar            *sender,
+          const gchar            *object _UNUSED_,
+          const gchar            *interface _UNUSED_,
+          const gchar            *property,
+          GError                **error _UNUSED_,
+          gpointer                data)
+{
+    StatusNotifierItem *sn = (StatusNotifierItem *) data;
+    StatusNotifierItemPrivate *priv = sn->priv;
+    GVariant *variant;
+    Counter counter;
+    gint64 start;
+    TRACE_MARK_BEGIN (mark);
+
+    start = g_get_monotonic_time ();
+    TRACE (get_prop_entry, priv->id, property);
+    variant = get_prop_value (sn, property, sender);
+    TRACE (get_prop_exit, priv->id, property,
+            (variant) ? g_variant_get_size (variant) : 0);
+    TRACE_MARK_END (mark, "get_prop", "%s: %s", priv->id, property);
+
+    counter = counters_get_prop (property);
+    if (G_LIKELY (counter != NB_COUNTERS))
+        counters_add (priv->counters, counter, 1);
+    counters_add (priv->counters, COUNTER_TIME_GET_PROP,
+            (guint64) (g_get_monotonic_time () - start));
+
+    return variant;
+}
+
+static void
+debug_method_call (GDBusConnection        *conn _UNUSED_,
+                   const gchar            *sender _UNUSED_,
+                   const gchar            *object _UNUSED_,
+                   const gchar            *interface _UNUSED_,
+                   const gchar            *method,
+                   GVariant               *params _UNUSED_,
+                   GDBusMethodInvocation  *invocation,
+                   gpointer                data)
+{
+    StatusNotifierItem *sn = (StatusNotifierItem *) data;
+    GVariant *counters;
+
+    if (!g_strcmp0 (method, "GetCounters"))
+        counters = counters_to_variant (sn->priv->counters);
+    else if (!g_strcmp0 (method, "GetGlobalCounters"))
+        counters = counters_global_to_variant ();
+    else
+        /* should never happen */
+        g_return_if_reached ();
+
+    g_dbus_method_invocation_return_value (invocation,
+            g_variant_new_tuple (&counters, 1));
+}
+
+static void
+host_sizes_free (HostSizes *host)
+{
+    g_bus_unwatch_name (host->watch_id);
+    g_free (host->sizes);
+    g_slice_free (HostSizes, host);
+}
+
+static void
+host_vanished (GDBusConnection  *conn _UNUSED_,
+               const gchar      *name,
+               gpointer          data)
+{
+    StatusNotifierItem *sn = (StatusNotifierItem *) data;
+
+    g_hash_table_remove (sn->priv->host_sizes, name);
+}
+
+#define HOST_MAX_SIZES      16
+#define HOST_MAX_SIZE       1024
+
+/* returns the revision of @pixmap (taken), the current one of @icon, adding it
+ * to the history (dropping the oldest) if new; Pixmaps being immutable, a new
+ * one is a new revision, and the history holding refs no address gets reused */
+static guint
+icon_revision (StatusNotifierItem *sn, StatusNotifierIcon icon, GVariant *pixmap)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    IconRevision *rev;
+
+    rev = &priv->icon[icon].history[(priv->icon[icon].history_next + ICON_HISTORY - 1)
+        % ICON_HISTORY];
+    if (rev->pixmap == pixmap)
+    {
+        g_variant_unref (pixmap);
+        return rev->revision;
+    }
+
+    rev = &priv->icon[icon].history[priv->icon[icon].history_next];
+    if (rev->pixmap)
+        g_variant_unref (rev->pixmap);
+    rev->pixmap = pixmap;
+    /* (0 is never one, so a host can ask for everything) */
+    if (++priv->icon[icon].revision == 0)
+        ++priv->icon[icon].revision;
+    rev->revision = priv->icon[icon].revision;
+    priv->icon[icon].history_next = (priv->icon[icon].history_next + 1) % ICON_HISTORY;
+    return rev->revision;
+}
+
+/* forgets all revisions sent (the counters go on), so GetIconDelta sends
+ * everything again at a new revision; for when sizes served change */
+static void
+icon_history_clear (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierIcon icon;
+    guint i;
+
+    for (icon = 0; icon < _NB_STATUS_NOTIFIER_ICONS; ++icon)
+        for (i = 0; i < ICON_HISTORY; ++i)
+            if (priv->icon[icon].history[i].pixmap)
+            {
+                g_variant_unref (priv->icon[icon].history[i].pixmap);
+                priv->icon[icon].history[i].pixmap = NULL;
+            }
 }
 
-static GVariantBuilder *
-get_builder_for_icon_pixmap (StatusNotifierItem *sn, StatusNotifierIcon icon)
+/* returns a new reference to the pixmap of @icon at @revision, if still in the
+ * history */
+static GVariant *
+icon_revision_pixmap (StatusNotifierItem *sn, StatusNotifierIcon icon, guint revision)
 {
     StatusNotifierItemPrivate *priv = sn->priv;
-    GVariantBuilder *builder;
-    cairo_surface_t *surface;
-    cairo_t *cr;
-    gint width, height, stride;
-    guint *data;
+    guint i;
+
+    if (revision == 0)
+        return NULL;
+    for (i = 0; i < ICON_HISTORY; ++i)
+        if (priv->icon[icon].history[i].pixmap
+                && priv->icon[icon].history[i].revision == revision)
+            return g_variant_ref (priv->icon[icon].history[i].pixmap);
+    return NULL;
+}
+
+/* returns a new reference to the a(iiay) served for @property (before
+ * fit_pixmap()), i.e. IconPixmap, OverlayIconPixmap or AttentionIconPixmap,
+ * and sets @icon; NULL for any other property */
+static GVariant *
+get_served_pixmap (StatusNotifierItem   *sn,
+                   const gchar          *property,
+                   StatusNotifierIcon   *icon,
+                   GError              **error)
+{
+    if (!g_strcmp0 (property, "IconPixmap"))
+    {
+        *icon = STATUS_NOTIFIER_ICON;
+        return get_main_pixmap (sn);
+    }
+    else if (!g_strcmp0 (property, "OverlayIconPixmap"))
+        *icon = STATUS_NOTIFIER_OVERLAY_ICON;
+    else if (!g_strcmp0 (property, "AttentionIconPixmap"))
+        *icon = STATUS_NOTIFIER_ATTENTION_ICON;
+    else
+    {
+        g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                "Unknown icon property: %s", property);
+        return NULL;
+    }
+    return get_icon_pixmap (sn, *icon);
+}
 
-    if (G_UNLIKELY (!priv->icon[icon].has_pixbuf))
+/* GetIconDelta: (revision, full, a(iia(iiiiay))) for @property since @since,
+ * i.e. only the tiles that changed, or everything (full) if @since isn't known
+ * (anymore) or sizes changed. Diffs are done on what @sender gets, see
+ * fit_pixmap() */
+static GVariant *
+get_icon_delta (StatusNotifierItem  *sn,
+                const gchar         *property,
+                guint                since,
+                const gchar         *sender,
+                GError             **error)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierIcon icon;
+    GVariant *cur, *old, *delta = NULL;
+    HostSizes *host = NULL;
+    RenderStats stats;
+    gboolean full = FALSE;
+    guint revision;
+    gint64 start;
+
+    cur = get_served_pixmap (sn, property, &icon, error);
+    if (!cur)
         return NULL;
+    revision = icon_revision (sn, icon, g_variant_ref (cur));
+    counters_add (priv->counters, COUNTER_DELTA_REQUESTS, 1);
+
+    /* @sender changed sizes since: what it has is at the previous ones */
+    if (priv->host_sizes && sender)
+        host = g_hash_table_lookup (priv->host_sizes, sender);
+    if (host && (host->full & (1U << icon)))
+    {
+        host->full &= ~(1U << icon);
+        since = 0;
+    }
+
+    if (since == revision)
+    {
+        g_variant_unref (cur);
+        return g_variant_new ("(ub@a(iia(iiiiay)))", revision, FALSE,
+                g_variant_new_array (G_VARIANT_TYPE ("(iia(iiiiay))"), NULL, 0));
+    }
+
+    start = g_get_monotonic_time ();
+    cur = fit_pixmap (sn, cur, sender);
+    old = icon_revision_pixmap (sn, icon, since);
+    if (old)
+    {
+        old = fit_pixmap (sn, old, sender);
+        delta = render_delta (old, cur, &stats);
+        g_variant_unref (old);
+    }
+    if (!delta)
+    {
+        full = TRUE;
+        delta = render_delta (NULL, cur, &stats);
+        counters_add (priv->counters, COUNTER_DELTA_FULL, 1);
+    }
+    g_variant_unref (cur);
+
+    counters_add (priv->counters, COUNTER_DELTA_BYTES, stats.bytes);
+    counters_add (priv->counters, COUNTER_TIME_RENDER,
+            (guint64) (g_get_monotonic_time () - start));
+    return g_variant_new ("(ub@a(iia(iiiiay)))", revision, full, delta);
+}
+
+/* GetIconPixmapFd: (h, a(iit)) for @property, i.e. what @sender gets from it,
+ * as a sealed memfd (see pixmapfd.c) with the width, height and offset of each
+ * size (only @invocation is used without memfd support) */
+static void
+get_icon_pixmap_fd (StatusNotifierItem      *sn _UNUSED_,
+                    GDBusConnection         *conn _UNUSED_,
+                    const gchar             *property _UNUSED_,
+                    const gchar             *sender _UNUSED_,
+                    GDBusMethodInvocation   *invocation)
+{
+#if USE_MEMFD
+    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierIcon icon;
+    GUnixFDList *fd_list;
+    GVariant *pixmap, *layout;
+    PixmapFdStats stats;
+    GError *err = NULL;
+    gint fd, idx;
 
-    width = gdk_pixbuf_get_width (priv->icon[icon].pixbuf);
-    height = gdk_pixbuf_get_height (priv->icon[icon].pixbuf);
+    if (!(g_dbus_connection_get_capabilities (conn)
+                & G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING))
+    {
+        g_dbus_method_invocation_return_error (invocation,
+                G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                "Connection can't pass file descriptors");
+        return;
+    }
 
-    surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
-    cr = cairo_create (surface);
-    gdk_cairo_set_source_pixbuf (cr, priv->icon[icon].pixbuf, 0, 0);
-    cairo_paint (cr);
-    cairo_destroy (cr);
+    pixmap = get_served_pixmap (sn, property, &icon, &err);
+    if (!pixmap)
+    {
+        g_dbus_method_invocation_take_error (invocation, err);
+        return;
+    }
+    pixmap = fit_pixmap (sn, pixmap, sender);
+    fd = pixmap_fd_get (pixmap, &layout, &stats, &err);
+    g_variant_unref (pixmap);
+    if (fd < 0)
+    {
+        g_dbus_method_invocation_take_error (invocation, err);
+        return;
+    }
 
-    stride = cairo_image_surface_get_stride (surface);
-    cairo_surface_flush (surface);
-    data = (guint *) cairo_image_surface_get_data (surface);
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-    guint i, max;
+    if (stats.cached)
+        counters_add (priv->counters, COUNTER_FD_CACHE_HITS, 1);
+    else
+    {
+        counters_add (priv->counters, COUNTER_FD_EXPORTS, 1);
+        counters_add (priv->counters, COUNTER_FD_BYTES, stats.bytes);
+    }
 
-    max = (guint) (stride * height) / sizeof (guint);
-    for (i = 0; i < max; ++i)
-        data[i] = GUINT_TO_BE (data[i]);
+    /* (the fd is dup-ed, the cache keeping its own) */
+    fd_list = g_unix_fd_list_new ();
+    idx = g_unix_fd_list_append (fd_list, fd, &err);
+    if (idx < 0)
+    {
+        g_variant_unref (layout);
+        g_object_unref (fd_list);
+        g_dbus_method_invocation_take_error (invocation, err);
+        return;
+    }
+    g_dbus_method_invocation_return_value_with_unix_fd_list (invocation,
+            g_variant_new ("(h@a(iit))", idx, layout), fd_list);
+    g_variant_unref (layout);
+    g_object_unref (fd_list);
+#else
+    g_dbus_method_invocation_return_error (invocation,
+            G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+            "Built without memfd support");
 #endif
-
-    builder = g_variant_builder_new (G_VARIANT_TYPE ("a(iiay)"));
-    g_variant_builder_open (builder, G_VARIANT_TYPE ("(iiay)"));
-    g_variant_builder_add (builder, "i", width);
-    g_variant_builder_add (builder, "i", height);
-    g_variant_builder_add_value (builder,
-            g_variant_new_from_data (G_VARIANT_TYPE ("ay"),
-                data,
-                (gsize) (stride * height),
-                TRUE,
-                (GDestroyNotify) cairo_surface_destroy,
-                surface));
-    g_variant_builder_close (builder);
-    return builder;
 }
 
-static GVariant *
-get_prop (GDBusConnection        *conn _UNUSED_,
-          const gchar            *sender _UNUSED_,
-          const gchar            *object _UNUSED_,
-          const gchar            *interface _UNUSED_,
-          const gchar            *property,
-          GError                **error _UNUSED_,
-          gpointer                data)
+static void
+extension_method_call (GDBusConnection        *conn,
+                       const gchar            *sender,
+                       const gchar            *object _UNUSED_,
+                       const gchar            *interface _UNUSED_,
+                       const gchar            *method,
+                       GVariant               *params,
+                       GDBusMethodInvocation  *invocation,
+                       gpointer                data)
 {
     StatusNotifierItem *sn = (StatusNotifierItem *) data;
     StatusNotifierItemPrivate *priv = sn->priv;
 
-    if (!g_strcmp0 (property, "Id"))
-        return g_variant_new ("s", priv->id);
-    else if (!g_strcmp0 (property, "Category"))
+    if (!g_strcmp0 (method, "SetIconSizes"))
     {
-        const gchar const *s_category[] = {
-            "ApplicationStatus",
-            "Communications",
-            "SystemServices",
-            "Hardware"
-        };
-        return g_variant_new ("s", s_category[priv->category]);
+        GVariant *variant;
+        const gint32 *sizes;
+        HostSizes *host;
+        gsize nb, i;
+
+        variant = g_variant_get_child_value (params, 0);
+        sizes = g_variant_get_fixed_array (variant, &nb, sizeof (gint32));
+        for (i = 0; i < nb; ++i)
+            if (sizes[i] <= 0 || sizes[i] > HOST_MAX_SIZE)
+                break;
+        if (i < nb || nb > HOST_MAX_SIZES)
+        {
+            g_variant_unref (variant);
+            g_dbus_method_invocation_return_error (invocation,
+                    G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+                    "Up to %d sizes, of 1 to %d pixels, expected",
+                    HOST_MAX_SIZES, HOST_MAX_SIZE);
+            return;
+        }
+
+        if (!priv->host_sizes)
+            priv->host_sizes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                    g_free, (GDestroyNotify) host_sizes_free);
+        host = g_hash_table_lookup (priv->host_sizes, sender);
+        if (!host)
+        {
+            /* (kept even with no sizes, for its deltas to be full once) */
+            host = g_slice_new0 (HostSizes);
+            host->watch_id = g_bus_watch_name_on_connection (conn, sender,
+                    G_BUS_NAME_WATCHER_FLAGS_NONE,
+                    NULL, host_vanished,
+                    sn, NULL);
+            g_hash_table_insert (priv->host_sizes, g_strdup (sender), host);
+        }
+        if (host->nb_sizes != nb || (nb > 0
+                    && memcmp (host->sizes, sizes, nb * sizeof (gint32)) != 0))
+        {
+            g_free (host->sizes);
+            host->sizes = NULL;
+            /* none: back to all sizes */
+            if (nb > 0)
+            {
+                host->sizes = g_new (gint, nb);
+                memcpy (host->sizes, sizes, nb * sizeof (gint32));
+            }
+            host->nb_sizes = (guint) nb;
+            /* what it got is at its previous sizes, no delta against it (for
+             * it only, others' sizes are unchanged) */
+            host->full = (1U << _NB_STATUS_NOTIFIER_ICONS) - 1;
+        }
+        g_variant_unref (variant);
+        g_dbus_method_invocation_return_value (invocation, NULL);
     }
-    else if (!g_strcmp0 (property, "Title"))
-        return g_variant_new ("s", (priv->title) ? priv->title : "");
-    else if (!g_strcmp0 (property, "Status"))
+    else if (!g_strcmp0 (method, "GetIconDelta"))
     {
-        const gchar const *s_status[] = {
-            "Passive",
-            "Active",
-            "NeedsAttention"
-        };
-        return g_variant_new ("s", s_status[priv->status]);
+        const gchar *property;
+        GVariant *ret;
+        GError *err = NULL;
+        guint32 since;
+
+        g_variant_get (params, "(&su)", &property, &since);
+        ret = get_icon_delta (sn, property, since, sender, &err);
+        if (ret)
+            g_dbus_method_invocation_return_value (invocation, ret);
+        else
+            g_dbus_method_invocation_take_error (invocation, err);
     }
-    else if (!g_strcmp0 (property, "WindowId"))
-        return g_variant_new ("i", priv->window_id);
-    else if (!g_strcmp0 (property, "IconName"))
-        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_ICON].has_pixbuf)
-                ? ((priv->icon[STATUS_NOTIFIER_ICON].icon_name)
-                    ? priv->icon[STATUS_NOTIFIER_ICON].icon_name : "") : "");
-    else if (!g_strcmp0 (property, "IconPixmap"))
-        return g_variant_new ("a(iiay)",
-                get_builder_for_icon_pixmap (sn, STATUS_NOTIFIER_ICON));
-    else if (!g_strcmp0 (property, "OverlayIconName"))
-        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].has_pixbuf)
-                ? ((priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].icon_name)
-                    ? priv->icon[STATUS_NOTIFIER_OVERLAY_ICON].icon_name : "") : "");
-    else if (!g_strcmp0 (property, "OverlayIconPixmap"))
-        return g_variant_new ("a(iiay)",
-                get_builder_for_icon_pixmap (sn, STATUS_NOTIFIER_OVERLAY_ICON));
-    else if (!g_strcmp0 (property, "AttentionIconName"))
-        return g_variant_new ("s", (!priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].has_pixbuf)
-                ? ((priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].icon_name)
-                    ? priv->icon[STATUS_NOTIFIER_ATTENTION_ICON].icon_name : "") : "");
-    else if (!g_strcmp0 (property, "AttentionIconPixmap"))
-        return g_variant_new ("a(iiay)",
-                get_builder_for_icon_pixmap (sn, STATUS_NOTIFIER_ATTENTION_ICON));
-    else if (!g_strcmp0 (property, "AttentionMovieName"))
-        return g_variant_new ("s", (priv->attention_movie_name)
-                ? priv->attention_movie_name : "");
-    else if (!g_strcmp0 (property, "ToolTip"))
+    else if (!g_strcmp0 (method, "GetIconPixmapFd"))
     {
-        GVariant *variant;
-        GVariantBuilder *builder;
+        const gchar *property;
 
-        if (!priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].has_pixbuf)
-        {
-            variant = g_variant_new ("(sa(iiay)ss)",
-                    (priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].icon_name)
-                    ? priv->icon[STATUS_NOTIFIER_TOOLTIP_ICON].icon_name : "",
-                    NULL,
-                    (priv->tooltip_title) ? priv->tooltip_title : "",
-                    (priv->tooltip_body) ? priv->tooltip_body : "");
-            return variant;
-        }
+        g_variant_get (params, "(&s)", &property);
+        get_icon_pixmap_fd (sn, conn, property, sender, invocation);
+    }
+    else
+        /* should never happen */
+        g_return_if_reached ();
+}
 
-        builder = get_builder_for_icon_pixmap (sn, STATUS_NOTIFIER_TOOLTIP_ICON);
-        variant = g_variant_new ("(sa(iiay)ss)",
-                "",
-                builder,
-                (priv->tooltip_title) ? priv->tooltip_title : "",
-                (priv->tooltip_body) ? priv->tooltip_body : "");
-        g_variant_builder_unref (builder);
+static gboolean
+debug_interface_wanted (void)
+{
+    static gint wanted = -1;
 
-        return variant;
-    }
-    else if (!g_strcmp0 (property, "ItemIsMenu"))
-        return g_variant_new ("b", priv->item_is_menu);
-    else if (!g_strcmp0 (property, "Menu"))
+    if (wanted < 0)
     {
-#if USE_DBUSMENU
-        if (priv->menu_service != NULL)
-        {
-            GValue strval = { 0 };
-            GVariant *var;
+        const gchar *env = g_getenv (DEBUG_INTERFACE_ENV);
 
-            g_value_init (&strval, G_TYPE_STRING);
-            g_object_get_property (G_OBJECT (priv->menu_service),
-                    DBUSMENU_SERVER_PROP_DBUS_OBJECT, &strval);
-            var = g_variant_new ("o", g_value_get_string (&strval));
-            g_value_unset (&strval);
-            return var;
-        }
-        else
-#endif
-            return g_variant_new ("o", "/NO_DBUSMENU");
+        wanted = (env && *env && g_strcmp0 (env, "0")) ? 1 : 0;
     }
-
-    g_return_val_if_reached (NULL);
+    return wanted == 1;
 }
 
 static void
@@ -1741,7 +4593,9 @@ dbus_failed (StatusNotifierItem *sn, GError *error, gboolean fatal)
 {
     StatusNotifierItemPrivate *priv = sn->priv;
 
+    counters_add (priv->counters, COUNTER_REGISTRATION_FAILURES, 1);
     dbus_free (sn);
+    animation_update (sn);
     if (fatal)
     {
         priv->state = STATUS_NOTIFIER_STATE_FAILED;
@@ -1763,15 +4617,37 @@ bus_acquired (GDBusConnection *conn, const gchar *name _UNUSED_, gpointer data)
         .get_property = get_prop,
         .set_property = NULL
     };
+    GDBusInterfaceVTable extension_vtable = {
+        .method_call = extension_method_call,
+        .get_property = NULL,
+        .set_property = NULL
+    };
     GDBusNodeInfo *info;
 
     info = g_dbus_node_info_new_for_xml (item_xml, NULL);
+    priv->object_path = g_strdup (ITEM_OBJECT);
     priv->dbus_reg_id = g_dbus_connection_register_object (conn,
-            ITEM_OBJECT,
+            priv->object_path,
             info->interfaces[0],
             &interface_vtable,
             sn, NULL,
             &err);
+    if (priv->dbus_reg_id == 0 && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_EXISTS))
+    {
+        /* another item is already exported on this (shared) connection, so
+         * use an object path of our own; We'll then register using it instead
+         * of our bus name, which watchers resolve as sender + path (as done by
+         * KDE's, and for libappindicator's items) */
+        g_clear_error (&err);
+        g_free (priv->object_path);
+        priv->object_path = g_strdup_printf (ITEM_OBJECT "/Item%u", priv->dbus_uniq_id);
+        priv->dbus_reg_id = g_dbus_connection_register_object (conn,
+                priv->object_path,
+                info->interfaces[0],
+                &interface_vtable,
+                sn, NULL,
+                &err);
+    }
     g_dbus_node_info_unref (info);
     if (priv->dbus_reg_id == 0)
     {
@@ -1780,6 +4656,43 @@ bus_acquired (GDBusConnection *conn, const gchar *name _UNUSED_, gpointer data)
     }
 
     priv->dbus_conn = g_object_ref (conn);
+
+    info = g_dbus_node_info_new_for_xml (extension_xml, NULL);
+    priv->dbus_ext_reg_id = g_dbus_connection_register_object (conn,
+            priv->object_path,
+            info->interfaces[0],
+            &extension_vtable,
+            sn, NULL,
+            &err);
+    g_dbus_node_info_unref (info);
+    if (priv->dbus_ext_reg_id == 0)
+    {
+        g_warning ("Failed to register extension interface: %s", err->message);
+        g_clear_error (&err);
+    }
+
+    if (debug_interface_wanted ())
+    {
+        GDBusInterfaceVTable debug_vtable = {
+            .method_call = debug_method_call,
+            .get_property = NULL,
+            .set_property = NULL
+        };
+
+        info = g_dbus_node_info_new_for_xml (debug_xml, NULL);
+        priv->dbus_debug_reg_id = g_dbus_connection_register_object (conn,
+                priv->object_path,
+                info->interfaces[0],
+                &debug_vtable,
+                sn, NULL,
+                &err);
+        g_dbus_node_info_unref (info);
+        if (priv->dbus_debug_reg_id == 0)
+        {
+            g_warning ("Failed to register debug interface: %s", err->message);
+            g_clear_error (&err);
+        }
+    }
 }
 
 static void
@@ -1791,6 +4704,7 @@ register_item_cb (GObject *sce, GAsyncResult *result, gpointer data)
     GVariant *variant;
 
     variant = g_dbus_proxy_call_finish ((GDBusProxy *) sce, result, &err);
+    TRACE (register_item_cb, priv->id, variant != NULL);
     if (!variant)
     {
         dbus_failed (sn, err, TRUE);
@@ -1798,8 +4712,15 @@ register_item_cb (GObject *sce, GAsyncResult *result, gpointer data)
     }
     g_variant_unref (variant);
 
+    counters_add (priv->counters, COUNTER_TIME_REGISTRATION,
+            (guint64) (g_get_monotonic_time () - priv->reg_start));
     priv->state = STATUS_NOTIFIER_STATE_REGISTERED;
+    /* hosts get everything as is now anyways */
+    priv->passive_signals = 0;
+    priv->inactive_signals = 0;
+    priv->host_present = TRUE;
     notify (sn, PROP_STATE);
+    animation_update (sn);
 }
 
 static void
@@ -1808,9 +4729,11 @@ name_acquired (GDBusConnection *conn _UNUSED_, const gchar *name, gpointer data)
     StatusNotifierItem *sn = (StatusNotifierItem *) data;
     StatusNotifierItemPrivate *priv = sn->priv;
 
+    TRACE (name_acquired, priv->id, name);
     g_dbus_proxy_call (priv->dbus_proxy,
             "RegisterStatusNotifierItem",
-            g_variant_new ("(s)", name),
+            g_variant_new ("(s)", (!g_strcmp0 (priv->object_path, ITEM_OBJECT))
+                ? name : priv->object_path),
             G_DBUS_CALL_FLAGS_NONE,
             -1,
             NULL,
@@ -1843,8 +4766,9 @@ dbus_reg_item (StatusNotifierItem *sn)
     StatusNotifierItemPrivate *priv = sn->priv;
     gchar buf[64], *b = buf;
 
+    priv->dbus_uniq_id = ++uniq_id;
     if (G_UNLIKELY (g_snprintf (buf, 64, "org.kde.StatusNotifierItem-%u-%u",
-                    getpid (), ++uniq_id) >= 64))
+                    getpid (), uniq_id) >= 64))
         b = g_strdup_printf ("org.kde.StatusNotifierItem-%u-%u",
             getpid (), uniq_id);
     priv->dbus_owner_id = g_bus_own_name (G_BUS_TYPE_SESSION,
@@ -1887,51 +4811,230 @@ proxy_cb (GObject *sce _UNUSED_, GAsyncResult *result, gpointer data)
     priv->dbus_proxy = g_dbus_proxy_new_for_bus_finish (result, &err);
     if (!priv->dbus_proxy)
     {
+        TRACE (proxy_cb, priv->id, -1);
         dbus_failed (sn, err, TRUE);
         return;
     }
 
     variant = g_dbus_proxy_get_cached_property (priv->dbus_proxy,
             "IsStatusNotifierHostRegistered");
+    TRACE (proxy_cb, priv->id, (variant) ? g_variant_get_boolean (variant) : 0);
     if (!variant || !g_variant_get_boolean (variant))
     {
-        GDBusProxy *proxy;
+        GDBusProxy *proxy;
+
+        g_set_error (&err, STATUS_NOTIFIER_ERROR,
+                STATUS_NOTIFIER_ERROR_NO_HOST,
+                "No Host registered on the Watcher");
+        if (variant)
+            g_variant_unref (variant);
+
+        /* keep the proxy, we'll wait for the signal when a host registers */
+        proxy = priv->dbus_proxy;
+        /* (so dbus_free() from dbus_failed() doesn't unref) */
+        priv->dbus_proxy = NULL;
+        dbus_failed (sn, err, FALSE);
+        priv->dbus_proxy = proxy;
+
+        priv->dbus_sid = g_signal_connect (priv->dbus_proxy, "g-signal",
+                (GCallback) watcher_signal, sn);
+        return;
+    }
+    g_variant_unref (variant);
+
+    dbus_reg_item (sn);
+}
+
+static void
+watcher_appeared (GDBusConnection   *conn _UNUSED_,
+                  const gchar       *name _UNUSED_,
+                  const gchar       *owner _UNUSED_,
+                  gpointer           data)
+{
+    StatusNotifierItem *sn = data;
+    StatusNotifierItemPrivate *priv = sn->priv;
+    GDBusNodeInfo *info;
+
+    TRACE (watcher_appeared, priv->id);
+    g_bus_unwatch_name (priv->dbus_watch_id);
+    priv->dbus_watch_id = 0;
+
+    info = g_dbus_node_info_new_for_xml (watcher_xml, NULL);
+    g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+            G_DBUS_PROXY_FLAGS_NONE,
+            info->interfaces[0],
+            WATCHER_NAME,
+            WATCHER_OBJECT,
+            WATCHER_INTERFACE,
+            NULL,
+            proxy_cb,
+            sn);
+    g_dbus_node_info_unref (info);
+}
+
+static void
+watcher_vanished (GDBusConnection   *conn _UNUSED_,
+                  const gchar       *name _UNUSED_,
+                  gpointer           data)
+{
+    GError *err = NULL;
+    StatusNotifierItem *sn = data;
+    StatusNotifierItemPrivate *priv = sn->priv;
+    guint id;
+
+    /* keep the watch active, so if a watcher shows up we'll resume the
+     * registering automatically */
+    id = priv->dbus_watch_id;
+    /* (so dbus_free() from dbus_failed() doesn't unwatch) */
+    priv->dbus_watch_id = 0;
+
+    g_set_error (&err, STATUS_NOTIFIER_ERROR,
+            STATUS_NOTIFIER_ERROR_NO_WATCHER,
+            "No Watcher found");
+    dbus_failed (sn, err, FALSE);
+
+    priv->dbus_watch_id = id;
+}
+
+static gboolean
+reg_begin (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    if (priv->state == STATUS_NOTIFIER_STATE_REGISTERING
+            || priv->state == STATUS_NOTIFIER_STATE_REGISTERED)
+        return FALSE;
+    priv->state = STATUS_NOTIFIER_STATE_REGISTERING;
+    priv->reg_start = g_get_monotonic_time ();
+    counters_add (priv->counters, COUNTER_REGISTRATION_ATTEMPTS, 1);
+    return TRUE;
+}
+
+/* Items of a group share the watching of the watcher, and the proxy to it.
+ * Once there's a host, all pending items request their names at once, so
+ * it's all pipelined over the connection. */
+
+static void
+group_fail_pending (StatusNotifierItemGroup *group, GError *error, gboolean fatal)
+{
+    GPtrArray *items;
+    guint i;
+
+    /* handlers might remove items from the group */
+    items = g_ptr_array_new_with_free_func (g_object_unref);
+    for (i = 0; i < group->priv->items->len; ++i)
+    {
+        StatusNotifierItem *sn = group->priv->items->pdata[i];
+
+        if (sn->priv->group_pending)
+            g_ptr_array_add (items, g_object_ref (sn));
+    }
+
+    for (i = 0; i < items->len; ++i)
+    {
+        StatusNotifierItem *sn = items->pdata[i];
+
+        if (fatal)
+            sn->priv->group_pending = FALSE;
+        dbus_failed (sn, g_error_copy (error), fatal);
+    }
+
+    g_ptr_array_unref (items);
+    g_error_free (error);
+}
+
+static void
+group_reg_pending (StatusNotifierItemGroup *group)
+{
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
+    guint i;
+
+    TRACE (group_register, gpriv->items->len);
+    for (i = 0; i < gpriv->items->len; ++i)
+    {
+        StatusNotifierItem *sn = gpriv->items->pdata[i];
+
+        if (!sn->priv->group_pending)
+            continue;
+        sn->priv->group_pending = FALSE;
+        /* used (then unref-d) from name_acquired() */
+        sn->priv->dbus_proxy = g_object_ref (gpriv->dbus_proxy);
+        dbus_reg_item (sn);
+    }
+}
+
+static void
+group_watcher_signal (GDBusProxy                *proxy _UNUSED_,
+                      const gchar               *sender _UNUSED_,
+                      const gchar               *signal,
+                      GVariant                  *params _UNUSED_,
+                      StatusNotifierItemGroup   *group)
+{
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
+
+    if (!g_strcmp0 (signal, "StatusNotifierHostRegistered"))
+    {
+        g_signal_handler_disconnect (gpriv->dbus_proxy, gpriv->dbus_sid);
+        gpriv->dbus_sid = 0;
+        gpriv->host_registered = TRUE;
+
+        group_reg_pending (group);
+    }
+}
+
+static void
+group_proxy_cb (GObject *sce _UNUSED_, GAsyncResult *result, gpointer data)
+{
+    GError *err = NULL;
+    StatusNotifierItemGroup *group = data;
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
+    GVariant *variant;
+
+    gpriv->dbus_proxy_pending = FALSE;
+    gpriv->dbus_proxy = g_dbus_proxy_new_for_bus_finish (result, &err);
+    if (!gpriv->dbus_proxy)
+    {
+        group_fail_pending (group, err, TRUE);
+        g_object_unref (group);
+        return;
+    }
+
+    variant = g_dbus_proxy_get_cached_property (gpriv->dbus_proxy,
+            "IsStatusNotifierHostRegistered");
+    gpriv->host_registered = variant && g_variant_get_boolean (variant);
+    if (variant)
+        g_variant_unref (variant);
+
+    if (gpriv->host_registered)
+        group_reg_pending (group);
+    else
+    {
+        /* keep the proxy, we'll wait for the signal when a host registers */
+        gpriv->dbus_sid = g_signal_connect (gpriv->dbus_proxy, "g-signal",
+                (GCallback) group_watcher_signal, group);
 
         g_set_error (&err, STATUS_NOTIFIER_ERROR,
                 STATUS_NOTIFIER_ERROR_NO_HOST,
                 "No Host registered on the Watcher");
-        if (variant)
-            g_variant_unref (variant);
-
-        /* keep the proxy, we'll wait for the signal when a host registers */
-        proxy = priv->dbus_proxy;
-        /* (so dbus_free() from dbus_failed() doesn't unref) */
-        priv->dbus_proxy = NULL;
-        dbus_failed (sn, err, FALSE);
-        priv->dbus_proxy = proxy;
-
-        priv->dbus_sid = g_signal_connect (priv->dbus_proxy, "g-signal",
-                (GCallback) watcher_signal, sn);
-        return;
+        group_fail_pending (group, err, FALSE);
     }
-    g_variant_unref (variant);
-
-    dbus_reg_item (sn);
+    g_object_unref (group);
 }
 
 static void
-watcher_appeared (GDBusConnection   *conn _UNUSED_,
-                  const gchar       *name _UNUSED_,
-                  const gchar       *owner _UNUSED_,
-                  gpointer           data)
+group_watcher_appeared (GDBusConnection   *conn _UNUSED_,
+                        const gchar       *name _UNUSED_,
+                        const gchar       *owner _UNUSED_,
+                        gpointer           data)
 {
-    StatusNotifierItem *sn = data;
-    StatusNotifierItemPrivate *priv = sn->priv;
+    StatusNotifierItemGroup *group = data;
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
     GDBusNodeInfo *info;
 
-    g_bus_unwatch_name (priv->dbus_watch_id);
-    priv->dbus_watch_id = 0;
+    g_bus_unwatch_name (gpriv->dbus_watch_id);
+    gpriv->dbus_watch_id = 0;
 
+    gpriv->dbus_proxy_pending = TRUE;
     info = g_dbus_node_info_new_for_xml (watcher_xml, NULL);
     g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
             G_DBUS_PROXY_FLAGS_NONE,
@@ -1940,33 +5043,55 @@ watcher_appeared (GDBusConnection   *conn _UNUSED_,
             WATCHER_OBJECT,
             WATCHER_INTERFACE,
             NULL,
-            proxy_cb,
-            sn);
+            group_proxy_cb,
+            g_object_ref (group));
     g_dbus_node_info_unref (info);
 }
 
 static void
-watcher_vanished (GDBusConnection   *conn _UNUSED_,
-                  const gchar       *name _UNUSED_,
-                  gpointer           data)
+group_watcher_vanished (GDBusConnection   *conn _UNUSED_,
+                        const gchar       *name _UNUSED_,
+                        gpointer           data)
 {
     GError *err = NULL;
-    StatusNotifierItem *sn = data;
-    StatusNotifierItemPrivate *priv = sn->priv;
-    guint id;
 
     /* keep the watch active, so if a watcher shows up we'll resume the
      * registering automatically */
-    id = priv->dbus_watch_id;
-    /* (so dbus_free() from dbus_failed() doesn't unwatch) */
-    priv->dbus_watch_id = 0;
-
     g_set_error (&err, STATUS_NOTIFIER_ERROR,
             STATUS_NOTIFIER_ERROR_NO_WATCHER,
             "No Watcher found");
-    dbus_failed (sn, err, FALSE);
+    group_fail_pending ((StatusNotifierItemGroup *) data, err, FALSE);
+}
 
-    priv->dbus_watch_id = id;
+static void
+group_dbus_start (StatusNotifierItemGroup *group)
+{
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
+
+    if (gpriv->dbus_proxy)
+    {
+        if (gpriv->host_registered)
+            group_reg_pending (group);
+        else
+        {
+            GError *err = NULL;
+
+            g_set_error (&err, STATUS_NOTIFIER_ERROR,
+                    STATUS_NOTIFIER_ERROR_NO_HOST,
+                    "No Host registered on the Watcher");
+            group_fail_pending (group, err, FALSE);
+        }
+        return;
+    }
+    else if (gpriv->dbus_watch_id > 0 || gpriv->dbus_proxy_pending)
+        return;
+
+    gpriv->dbus_watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION,
+            WATCHER_NAME,
+            G_BUS_NAME_WATCHER_FLAGS_AUTO_START,
+            group_watcher_appeared,
+            group_watcher_vanished,
+            group, NULL);
 }
 
 /**
@@ -2006,6 +5131,9 @@ watcher_vanished (GDBusConnection   *conn _UNUSED_,
  * Note that you can call status_notifier_item_register() after a fatal error
  * occured, to try again. You can also unref @sn while it is
  * %STATUS_NOTIFIER_STATE_REGISTERING safely.
+ *
+ * If @sn was added to a #StatusNotifierItemGroup, it is registered as part of
+ * the group, see status_notifier_item_group_register()
  */
 void
 status_notifier_item_register (StatusNotifierItem      *sn)
@@ -2016,10 +5144,15 @@ status_notifier_item_register (StatusNotifierItem      *sn)
     g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
     priv = sn->priv;
 
-    if (priv->state == STATUS_NOTIFIER_STATE_REGISTERING
-            || priv->state == STATUS_NOTIFIER_STATE_REGISTERED)
+    if (!reg_begin (sn))
         return;
-    priv->state = STATUS_NOTIFIER_STATE_REGISTERING;
+
+    if (priv->group)
+    {
+        priv->group_pending = TRUE;
+        group_dbus_start (priv->group);
+        return;
+    }
 
     priv->dbus_watch_id = g_bus_watch_name (G_BUS_TYPE_SESSION,
             WATCHER_NAME,
@@ -2045,6 +5178,59 @@ status_notifier_item_get_state (StatusNotifierItem      *sn)
     return sn->priv->state;
 }
 
+/**
+ * status_notifier_item_get_counters:
+ * @sn: A #StatusNotifierItem
+ *
+ * Returns the performance counters of @sn, as a dictionary mapping counter
+ * names to their values. Counters include the number of DBus property reads
+ * ("get-prop.&lt;Property&gt;"), of pixbufs converted to pixmaps and bytes
+ * produced, of DBus signals emitted ("signal.&lt;Signal&gt;") or dropped
+ * because the item wasn't registered, of registration attempts and failures,
+ * as well as the time (in microseconds) spent doing those ("time-us.*").
+ *
+ * If environment variable STATUS_NOTIFIER_DEBUG_INTERFACE is set (to anything
+ * but "0") when the item is registered, those are also available via DBus,
+ * using method GetCounters of interface org.statusnotifier.Debug on the
+ * item's object.
+ *
+ * Returns: (transfer full): A new #GVariant of type a{st} with all counters
+ *
+ * Since: @NEXT_VERSION@
+ */
+GVariant *
+status_notifier_item_get_counters (StatusNotifierItem      *sn)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), NULL);
+    return g_variant_ref_sink (counters_to_variant (sn->priv->counters));
+}
+
+/**
+ * status_notifier_item_get_global_counters:
+ *
+ * Returns the process-wide performance counters, i.e. the sum of the counters
+ * of all items there ever was in the process. See
+ * status_notifier_item_get_counters() for more.
+ *
+ * Icons set from pixbufs are kept (in wire format) in a process-wide store,
+ * shared by all slots & items with the same pixels. Its current state is
+ * included as well: the number of distinct icons ("icon-store.entries"), of
+ * slots using them ("icon-store.refs"), and the bytes of pixel data held
+ * ("icon-store.bytes").
+ *
+ * They are also available via method GetGlobalCounters of the DBus debug
+ * interface.
+ *
+ * Returns: (transfer full): A new #GVariant of type a{st} with all counters
+ *
+ * Since: @NEXT_VERSION@
+ */
+GVariant *
+status_notifier_item_get_global_counters (void)
+{
+    return g_variant_ref_sink (counters_global_to_variant ());
+}
+
 /**
  * status_notifier_item_set_item_is_menu:
  * @sn: A #StatusNotifierItem
@@ -2086,6 +5272,53 @@ status_notifier_item_get_item_is_menu (StatusNotifierItem      *sn)
     return sn->priv->item_is_menu;
 }
 
+#if USE_DBUSMENU
+static gboolean
+load_dbusmenu (void)
+{
+    const gchar *dir;
+    gchar *path;
+
+    if (dbusmenu.tried)
+        return dbusmenu.module != NULL;
+    dbusmenu.tried = TRUE;
+
+    if (G_UNLIKELY (!g_module_supported ()))
+    {
+        g_warning ("Cannot load dbusmenu support: modules not supported");
+        return FALSE;
+    }
+
+    dir = g_getenv (DBUSMENU_MODULE_DIR_ENV);
+    path = g_module_build_path ((dir && *dir) ? dir : MODULEDIR,
+            DBUSMENU_MODULE_NAME);
+    dbusmenu.module = g_module_open (path, G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+    g_free (path);
+    if (!dbusmenu.module)
+    {
+        g_warning ("Cannot load dbusmenu support: %s", g_module_error ());
+        return FALSE;
+    }
+
+    if (!g_module_symbol (dbusmenu.module, DBUSMENU_SYM_IS_MENU,
+                (gpointer *) &dbusmenu.is_menu)
+            || !g_module_symbol (dbusmenu.module, DBUSMENU_SYM_SERVER_NEW,
+                (gpointer *) &dbusmenu.server_new)
+            || !g_module_symbol (dbusmenu.module, DBUSMENU_SYM_SET_MENU,
+                (gpointer *) &dbusmenu.set_menu))
+    {
+        g_warning ("Cannot load dbusmenu support: %s", g_module_error ());
+        g_module_close (dbusmenu.module);
+        dbusmenu.module = NULL;
+        return FALSE;
+    }
+
+    /* servers we created use code from the module */
+    g_module_make_resident (dbusmenu.module);
+    return TRUE;
+}
+#endif
+
 /**
  * status_notifier_item_set_context_menu:
  * @sn: A #StatusNotifierItem
@@ -2102,6 +5335,9 @@ status_notifier_item_get_item_is_menu (StatusNotifierItem      *sn)
  * function does nothing but returning %FALSE, thus allowing you to fallback on
  * handling the #StatusNotifierItem::context_menu signal.
  *
+ * Support for dbusmenu is provided by a module, only loaded the first time a
+ * menu is set; If it cannot be loaded, %FALSE is returned as well.
+ *
  * Returns: %TRUE is dbusmenu support is available, else %FALSE
  *
  * Since: 1.0.0
@@ -2112,12 +5348,14 @@ status_notifier_item_set_context_menu (StatusNotifierItem      *sn,
 {
 #if USE_DBUSMENU
     StatusNotifierItemPrivate *priv;
-    DbusmenuMenuitem *root = NULL;
 
     g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM (sn), FALSE);
-    g_return_val_if_fail (!menu || GTK_IS_MENU (menu), FALSE);
     priv = sn->priv;
 
+    if (menu && !load_dbusmenu ())
+        return FALSE;
+    g_return_val_if_fail (!menu || dbusmenu.is_menu (menu), FALSE);
+
     if (priv->menu)
         g_object_unref (priv->menu);
 
@@ -2127,16 +5365,10 @@ status_notifier_item_set_context_menu (StatusNotifierItem      *sn,
     {
         g_object_ref_sink (priv->menu);
 
-        root = dbusmenu_gtk_parse_menu_structure (GTK_WIDGET (priv->menu));
-
         if (priv->menu_service == NULL)
-            priv->menu_service = dbusmenu_server_new ("/MenuBar");
-
-        dbusmenu_server_set_root (priv->menu_service, root);
+            priv->menu_service = dbusmenu.server_new (DBUSMENU_OBJECT);
 
-        /* Drop our local ref as set_root should get it's own. */
-        if (root != NULL)
-            g_object_unref (root);
+        dbusmenu.set_menu (priv->menu_service, priv->menu);
     }
     else if (priv->menu_service)
     {
@@ -2179,3 +5411,325 @@ status_notifier_item_get_context_menu (StatusNotifierItem      *sn)
     return NULL;
 #endif
 }
+
+
+/* StatusNotifierItemGroup */
+
+static void     status_notifier_item_group_dispose  (GObject            *object);
+
+G_DEFINE_TYPE (StatusNotifierItemGroup, status_notifier_item_group, G_TYPE_OBJECT)
+
+static void
+status_notifier_item_group_class_init (StatusNotifierItemGroupClass *klass)
+{
+    GObjectClass *o_class;
+
+    o_class = G_OBJECT_CLASS (klass);
+    o_class->dispose        = status_notifier_item_group_dispose;
+
+    g_type_class_add_private (klass, sizeof (StatusNotifierItemGroupPrivate));
+}
+
+static void
+status_notifier_item_group_init (StatusNotifierItemGroup *group)
+{
+    group->priv = G_TYPE_INSTANCE_GET_PRIVATE (group,
+            STATUS_NOTIFIER_TYPE_ITEM_GROUP, StatusNotifierItemGroupPrivate);
+    group->priv->items = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+/* emits all DBus signals pending while the group was frozen */
+static void
+group_flush_item (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+    guint pending = priv->pending_signals;
+    guint i;
+
+    priv->pending_signals = 0;
+    if (pending == 0 || priv->state != STATUS_NOTIFIER_STATE_REGISTERED)
+        return;
+
+    for (i = 0; i < NB_DBUS_SIGNALS; ++i)
+        if (pending & (1U << i))
+            dbus_notify_signal (sn, i);
+}
+
+static void
+group_detach_item (StatusNotifierItem *sn)
+{
+    StatusNotifierItemPrivate *priv = sn->priv;
+
+    priv->group = NULL;
+    group_flush_item (sn);
+
+    /* was waiting on the group, carry on on its own */
+    if (priv->group_pending)
+    {
+        priv->group_pending = FALSE;
+        priv->state = STATUS_NOTIFIER_STATE_NOT_REGISTERED;
+        status_notifier_item_register (sn);
+    }
+}
+
+static void
+status_notifier_item_group_dispose (GObject *object)
+{
+    StatusNotifierItemGroup *group = (StatusNotifierItemGroup *) object;
+    StatusNotifierItemGroupPrivate *gpriv = group->priv;
+
+    if (gpriv->items)
+    {
+        guint i;
+
+        for (i = 0; i < gpriv->items->len; ++i)
+            group_detach_item (gpriv->items->pdata[i]);
+        g_ptr_array_unref (gpriv->items);
+        gpriv->items = NULL;
+    }
+    if (gpriv->dbus_watch_id > 0)
+    {
+        g_bus_unwatch_name (gpriv->dbus_watch_id);
+        gpriv->dbus_watch_id = 0;
+    }
+    if (gpriv->dbus_sid > 0)
+    {
+        g_signal_handler_disconnect (gpriv->dbus_proxy, gpriv->dbus_sid);
+        gpriv->dbus_sid = 0;
+    }
+    if (gpriv->dbus_proxy)
+    {
+        g_object_unref (gpriv->dbus_proxy);
+        gpriv->dbus_proxy = NULL;
+    }
+
+    G_OBJECT_CLASS (status_notifier_item_group_parent_class)->dispose (object);
+}
+
+/**
+ * status_notifier_item_group_new:
+ *
+ * Creates a new, empty, group of items.
+ *
+ * A group is useful when an application has many items: they can be registered
+ * all at once, sharing the watching of the StatusNotifierWatcher and the proxy
+ * to it, and updated in bulk with all the resulting DBus signals sent together
+ * (see status_notifier_item_group_update()).
+ *
+ * Returns: (transfer full): A new #StatusNotifierItemGroup
+ *
+ * Since: @NEXT_VERSION@
+ */
+StatusNotifierItemGroup *
+status_notifier_item_group_new (void)
+{
+    return (StatusNotifierItemGroup *) g_object_new (STATUS_NOTIFIER_TYPE_ITEM_GROUP, NULL);
+}
+
+/**
+ * status_notifier_item_group_add:
+ * @group: A #StatusNotifierItemGroup
+ * @sn: The #StatusNotifierItem to add to @group
+ *
+ * Adds @sn to @group, which will hold a reference on it. An item can only be
+ * part of one group.
+ *
+ * If @sn isn't registered yet, it will be when calling
+ * status_notifier_item_group_register() (or status_notifier_item_register() on
+ * @sn).
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_add (StatusNotifierItemGroup *group,
+                                StatusNotifierItem      *sn)
+{
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (sn->priv->group == NULL);
+
+    g_ptr_array_add (group->priv->items, g_object_ref (sn));
+    sn->priv->group = group;
+}
+
+/**
+ * status_notifier_item_group_remove:
+ * @group: A #StatusNotifierItemGroup
+ * @sn: The #StatusNotifierItem to remove from @group
+ *
+ * Removes @sn from @group, releasing the reference held on it. If @group was
+ * frozen, DBus signals pending for @sn are emitted right away.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_remove (StatusNotifierItemGroup *group,
+                                   StatusNotifierItem      *sn)
+{
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM (sn));
+    g_return_if_fail (sn->priv->group == group);
+
+    group_detach_item (sn);
+    g_ptr_array_remove (group->priv->items, sn);
+}
+
+/**
+ * status_notifier_item_group_get_n_items:
+ * @group: A #StatusNotifierItemGroup
+ *
+ * Returns the number of items in @group
+ *
+ * Returns: The number of items in @group
+ *
+ * Since: @NEXT_VERSION@
+ */
+guint
+status_notifier_item_group_get_n_items (StatusNotifierItemGroup *group)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group), 0);
+    return group->priv->items->len;
+}
+
+/**
+ * status_notifier_item_group_get_item:
+ * @group: A #StatusNotifierItemGroup
+ * @index: Index of the item
+ *
+ * Returns the item at position @index in @group (in the order they were added)
+ *
+ * Returns: (transfer none): The #StatusNotifierItem at @index
+ *
+ * Since: @NEXT_VERSION@
+ */
+StatusNotifierItem *
+status_notifier_item_group_get_item (StatusNotifierItemGroup *group,
+                                     guint                    index)
+{
+    g_return_val_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group), NULL);
+    g_return_val_if_fail (index < group->priv->items->len, NULL);
+    return group->priv->items->pdata[index];
+}
+
+/**
+ * status_notifier_item_group_register:
+ * @group: A #StatusNotifierItemGroup
+ *
+ * Registers all items of @group not yet registered (or registering). This works
+ * as status_notifier_item_register() does, except that the StatusNotifierWatcher
+ * is only looked up once for the whole group, and once a host is registered,
+ * all items request their bus names at once, so registrations are pipelined
+ * over the connection.
+ *
+ * Items added to @group later on can be registered by calling this again, or
+ * status_notifier_item_register() on them.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_register (StatusNotifierItemGroup *group)
+{
+    StatusNotifierItemGroupPrivate *gpriv;
+    gboolean any = FALSE;
+    guint i;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    gpriv = group->priv;
+
+    for (i = 0; i < gpriv->items->len; ++i)
+    {
+        StatusNotifierItem *sn = gpriv->items->pdata[i];
+
+        if (reg_begin (sn))
+        {
+            sn->priv->group_pending = TRUE;
+            any = TRUE;
+        }
+    }
+
+    if (any)
+        group_dbus_start (group);
+}
+
+/**
+ * status_notifier_item_group_freeze_notify:
+ * @group: A #StatusNotifierItemGroup
+ *
+ * Increases the freeze count for @group. While it is non-zero, DBus signals
+ * for hosts to refresh properties of the items in @group are not emitted, but
+ * remembered (once per signal & item) until the freeze count drops back to
+ * zero (via status_notifier_item_group_thaw_notify()), at which point they're
+ * all emitted together.
+ *
+ * Every call to status_notifier_item_group_freeze_notify() should later be
+ * followed by a call to status_notifier_item_group_thaw_notify()
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_freeze_notify (StatusNotifierItemGroup *group)
+{
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    ++group->priv->freeze;
+}
+
+/**
+ * status_notifier_item_group_thaw_notify:
+ * @group: A #StatusNotifierItemGroup
+ *
+ * Reverts the effect of a previous call to
+ * status_notifier_item_group_freeze_notify(). If the freeze count drops back to
+ * zero, all DBus signals pending for items of @group are emitted.
+ *
+ * It is an error to call this function when the freeze count is zero.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_thaw_notify (StatusNotifierItemGroup *group)
+{
+    StatusNotifierItemGroupPrivate *gpriv;
+    guint i;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    gpriv = group->priv;
+    g_return_if_fail (gpriv->freeze > 0);
+
+    if (--gpriv->freeze > 0)
+        return;
+
+    for (i = 0; i < gpriv->items->len; ++i)
+        group_flush_item (gpriv->items->pdata[i]);
+}
+
+/**
+ * status_notifier_item_group_update:
+ * @group: A #StatusNotifierItemGroup
+ * @func: (scope call): Function to call on each item
+ * @data: (closure): User data for @func
+ *
+ * Calls @func on every item of @group, with notifications frozen: i.e. any DBus
+ * signals resulting from the changes made will only be emitted once all items
+ * have been updated, together, and once per item & signal.
+ *
+ * @func must not add or remove items from @group.
+ *
+ * Since: @NEXT_VERSION@
+ */
+void
+status_notifier_item_group_update (StatusNotifierItemGroup *group,
+                                   StatusNotifierItemGroupFunc func,
+                                   gpointer                 data)
+{
+    StatusNotifierItemGroupPrivate *gpriv;
+    guint i;
+
+    g_return_if_fail (STATUS_NOTIFIER_IS_ITEM_GROUP (group));
+    g_return_if_fail (func != NULL);
+    gpriv = group->priv;
+
+    status_notifier_item_group_freeze_notify (group);
+    for (i = 0; i < gpriv->items->len; ++i)
+        func (gpriv->items->pdata[i], data);
+    status_notifier_item_group_thaw_notify (group);
+}
@@ -242,10 +242,67 @@ void                    status_notifier_item_set_from_pixbuf (
                                             StatusNotifierItem      *sn,
                                             StatusNotifierIcon       icon,
                                             GdkPixbuf               *pixbuf);
+void                    status_notifier_item_set_from_file_async (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            const gchar             *filename,
+                                            gint                     size,
+                                            GCancellable            *cancellable,
+                                            GAsyncReadyCallback      callback,
+                                            gpointer                 user_data);
+gboolean                status_notifier_item_set_from_file_finish (
+                                            StatusNotifierItem      *sn,
+                                            GAsyncResult            *result,
+                                            GError                 **error);
 void                    status_notifier_item_set_from_icon_name (
                                             StatusNotifierItem      *sn,
                                             StatusNotifierIcon       icon,
                                             const gchar             *icon_name);
+gboolean                status_notifier_item_set_from_resource (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            const gchar             *path,
+                                            GError                 **error);
+void                    status_notifier_item_set_from_text (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            const gchar             *text,
+                                            guint32                  fg,
+                                            guint32                  bg,
+                                            gint                     size);
+void                    status_notifier_item_set_from_badge (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            guint                    count,
+                                            guint32                  fg,
+                                            guint32                  bg,
+                                            gint                     size);
+void                    status_notifier_item_set_from_progress (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            gdouble                  fraction,
+                                            guint32                  fg,
+                                            guint32                  bg,
+                                            gint                     size);
+void                    status_notifier_item_set_graph (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            gdouble                  min,
+                                            gdouble                  max,
+                                            guint32                  fg,
+                                            guint32                  bg,
+                                            gint                     size,
+                                            guint                    interval);
+void                    status_notifier_item_push_sample (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            gdouble                  value);
+void                    status_notifier_item_set_animation (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierIcon       icon,
+                                            GdkPixbuf              **frames,
+                                            const guint             *durations,
+                                            guint                    n_frames);
 gboolean                status_notifier_item_has_pixbuf (
                                             StatusNotifierItem      *sn,
                                             StatusNotifierIcon       icon);
@@ -270,11 +327,56 @@ void                    status_notifier_item_set_status (
                                             StatusNotifierStatus     status);
 StatusNotifierStatus    status_notifier_item_get_status (
                                             StatusNotifierItem      *sn);
+void                    status_notifier_item_set_status_icon (
+                                            StatusNotifierItem      *sn,
+                                            StatusNotifierStatus     status,
+                                            GdkPixbuf              **pixbufs,
+                                            guint                    n_pixbufs);
 void                    status_notifier_item_set_window_id (
                                             StatusNotifierItem      *sn,
                                             guint32                  window_id);
 guint32                 status_notifier_item_get_window_id (
                                             StatusNotifierItem      *sn);
+void                    status_notifier_item_set_scroll_coalescing (
+                                            StatusNotifierItem      *sn,
+                                            gint                     window);
+gint                    status_notifier_item_get_scroll_coalescing (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_batch_signals (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 batch);
+gboolean                status_notifier_item_get_batch_signals (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_defer_when_passive (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 defer);
+gboolean                status_notifier_item_get_defer_when_passive (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_throttle_when_inactive (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 throttle);
+gboolean                status_notifier_item_get_throttle_when_inactive (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_background_conversion (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 background);
+gboolean                status_notifier_item_get_background_conversion (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_disk_cache (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 disk_cache);
+gboolean                status_notifier_item_get_disk_cache (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_composite_overlay (
+                                            StatusNotifierItem      *sn,
+                                            gboolean                 composite_overlay);
+gboolean                status_notifier_item_get_composite_overlay (
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_set_max_icon_size (
+                                            StatusNotifierItem      *sn,
+                                            gint                     max_icon_size);
+gint                    status_notifier_item_get_max_icon_size (
+                                            StatusNotifierItem      *sn);
 void                    status_notifier_item_freeze_tooltip (
                                             StatusNotifierItem      *sn);
 void                    status_notifier_item_thaw_tooltip (
@@ -308,6 +410,71 @@ gboolean                status_notifier_item_set_context_menu (
                                             GObject                 *menu);
 GObject *               status_notifier_item_get_context_menu (
                                             StatusNotifierItem      *sn);
+GVariant *              status_notifier_item_get_counters (
+                                            StatusNotifierItem      *sn);
+GVariant *              status_notifier_item_get_global_counters (void);
+
+
+typedef struct _StatusNotifierItemGroup         StatusNotifierItemGroup;
+typedef struct _StatusNotifierItemGroupPrivate  StatusNotifierItemGroupPrivate;
+typedef struct _StatusNotifierItemGroupClass    StatusNotifierItemGroupClass;
+
+#define STATUS_NOTIFIER_TYPE_ITEM_GROUP             (status_notifier_item_group_get_type ())
+#define STATUS_NOTIFIER_ITEM_GROUP(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), STATUS_NOTIFIER_TYPE_ITEM_GROUP, StatusNotifierItemGroup))
+#define STATUS_NOTIFIER_ITEM_GROUP_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), STATUS_NOTIFIER_TYPE_ITEM_GROUP, StatusNotifierItemGroupClass))
+#define STATUS_NOTIFIER_IS_ITEM_GROUP(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), STATUS_NOTIFIER_TYPE_ITEM_GROUP))
+#define STATUS_NOTIFIER_IS_ITEM_GROUP_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), STATUS_NOTIFIER_TYPE_ITEM_GROUP))
+#define STATUS_NOTIFIER_ITEM_GROUP_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), STATUS_NOTIFIER_TYPE_ITEM_GROUP, StatusNotifierItemGroupClass))
+
+GType                   status_notifier_item_group_get_type         (void) G_GNUC_CONST;
+
+struct _StatusNotifierItemGroup
+{
+    /*< private >*/
+    GObject parent;
+    StatusNotifierItemGroupPrivate *priv;
+};
+
+/**
+ * StatusNotifierItemGroupClass:
+ * @parent_class: Parent class
+ */
+struct _StatusNotifierItemGroupClass
+{
+    GObjectClass parent_class;
+};
+
+/**
+ * StatusNotifierItemGroupFunc:
+ * @sn: A #StatusNotifierItem of the group
+ * @data: User data passed to status_notifier_item_group_update()
+ *
+ * Function called on each item by status_notifier_item_group_update()
+ */
+typedef void (*StatusNotifierItemGroupFunc) (StatusNotifierItem *sn, gpointer data);
+
+StatusNotifierItemGroup * status_notifier_item_group_new (void);
+void                    status_notifier_item_group_add (
+                                            StatusNotifierItemGroup *group,
+                                            StatusNotifierItem      *sn);
+void                    status_notifier_item_group_remove (
+                                            StatusNotifierItemGroup *group,
+                                            StatusNotifierItem      *sn);
+guint                   status_notifier_item_group_get_n_items (
+                                            StatusNotifierItemGroup *group);
+StatusNotifierItem *    status_notifier_item_group_get_item (
+                                            StatusNotifierItemGroup *group,
+                                            guint                    index);
+void                    status_notifier_item_group_register (
+                                            StatusNotifierItemGroup *group);
+void                    status_notifier_item_group_freeze_notify (
+                                            StatusNotifierItemGroup *group);
+void                    status_notifier_item_group_thaw_notify (
+                                            StatusNotifierItemGroup *group);
+void                    status_notifier_item_group_update (
+                                            StatusNotifierItemGroup *group,
+                                            StatusNotifierItemGroupFunc func,
+                                            gpointer                 data);
 
 G_END_DECLS
 
@@ -0,0 +1,72 @@
+/*
+ * statusnotifier - Copyright (C) 2014-2017 Olivier Brunel
+ *
+ * trace.h
+ * Copyright (C) 2017 Olivier Brunel <jjk@jjacky.com>
+ *
+ * This file is part of statusnotifier.
+ *
+ * statusnotifier is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * statusnotifier is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * statusnotifier. If not, see http://www.gnu.org/licenses/
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/* Static tracepoints:
+ *
+ * - TRACE (probe, args...) is a USDT probe statusnotifier:probe, i.e. a single
+ *   nop unless something (bpftrace, perf, systemtap...) is attached to it.
+ *   E.g: bpftrace -e 'usdt:/usr/lib/libstatusnotifier.so:get_prop_exit
+ *   { printf("%s %s %d\n", str(arg0), str(arg1), arg2); }'
+ *   Each probe has a semaphore (defined once via TRACE_PROBE (probe)), which
+ *   tracers increment when attaching, so arguments are only evaluated then.
+ *
+ * - TRACE_MARK_BEGIN (var) & TRACE_MARK_END (var, name, fmt, args...) add a
+ *   mark for sysprof, covering from begin to end, only if sysprof is actually
+ *   recording. TRACE_MARK_BEGIN is a declaration, to be put with those at the
+ *   top of a block.
+ *
+ * All those are no-ops when built without support (--disable-tracing).
+ */
+
+#if HAVE_USDT
+#define _SDT_HAS_SEMAPHORES     1
+#include <sys/sdt.h>
+#define TRACE_PROBE(probe)                                                  \
+    __extension__ unsigned short statusnotifier_##probe##_semaphore         \
+    __attribute__ ((unused, section (".probes"), visibility ("hidden")))
+#define TRACE(probe, ...) G_STMT_START {                                    \
+    if (G_UNLIKELY (statusnotifier_##probe##_semaphore))                    \
+        STAP_PROBEV (statusnotifier, probe, __VA_ARGS__);                   \
+} G_STMT_END
+#else
+#define TRACE_PROBE(probe)      extern gint statusnotifier_##probe##_semaphore
+#define TRACE(...)              G_STMT_START { } G_STMT_END
+#endif
+
+#if HAVE_SYSPROF
+#include <sysprof-capture.h>
+#define TRACE_MARK_BEGIN(var) \
+    gint64 var = (sysprof_collector_is_active ()) ? SYSPROF_CAPTURE_CURRENT_TIME : 0
+#define TRACE_MARK_END(var, name, ...) G_STMT_START {                       \
+    if (var > 0)                                                            \
+        sysprof_collector_mark (var, SYSPROF_CAPTURE_CURRENT_TIME - var,    \
+                "statusnotifier", name, __VA_ARGS__);                       \
+} G_STMT_END
+#else
+#define TRACE_MARK_BEGIN(var)           G_GNUC_UNUSED gint64 var = 0
+#define TRACE_MARK_END(var, name, ...)  G_STMT_START { } G_STMT_END
+#endif
+
+#endif /* __TRACE_H__ */